@@ -0,0 +1,50 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+// see cull.comp
+struct ObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  vec4 boundingSphere;
+  uint drawIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+  ObjectData objects[];
+};
+
+// indices of the objects that survived culling, a draw's instances start at its firstInstance
+layout(std430, set = 1, binding = 1) readonly buffer Visible {
+  uint visible[];
+};
+
+void main() {
+  ObjectData object = objects[visible[gl_InstanceIndex]];
+  vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+}
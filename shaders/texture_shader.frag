@@ -23,11 +23,6 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 
 layout(set = 1,binding =0) uniform sampler2D texSampler;
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
-
 void main() {
   vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
   vec3 specularLight = vec3(0.0);
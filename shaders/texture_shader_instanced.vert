@@ -0,0 +1,39 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+// per instance, see CjhModel::Instance
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragTexCoord;
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+layout(set = 1,binding =0) uniform sampler2D texSampler;
+
+void main() {
+  vec4 positionWorld = modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(normalMatrix) * normal);
+  fragPosWorld = positionWorld.xyz;
+  fragColor = color;
+  fragTexCoord = uv;
+}
@@ -2,7 +2,11 @@
 
 #include "vk/keyboard_movement_controller.hpp"
 #include "vk/cjh_buffer.hpp"
+#include "vk/cjh_staging_ring.hpp"
 #include "vk/cjh_camera.hpp"
+#include "vk/cjh_scene.hpp"
+#include "vk/cjh_vfs.hpp"
+#include "systems/gpu_driven_render_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "systems/simple_render_system.hpp"
 #include "systems/Texture_render_system.hpp"
@@ -17,6 +21,8 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <iostream>
+#include <limits>
 #include <stdexcept>
 
 #include <string>
@@ -70,17 +76,54 @@ namespace cjh
 
 		SimpleRenderSystem simpleRenderSystem{
 			cjhDevice,
+			pipelineManager,
 			cjhRenderer.getSwapChainRenderPass(),
 			globalSetLayout->getDescriptorSetLayout()};
 		PointLightSystem pointLightSystem{
 			cjhDevice,
+			pipelineManager,
 			cjhRenderer.getSwapChainRenderPass(),
 			globalSetLayout->getDescriptorSetLayout()};
 		TextureRenderSystem textureRenderSystem{
 			cjhDevice,
+			pipelineManager,
 			cjhRenderer.getSwapChainRenderPass(),
 			globalSetLayout->getDescriptorSetLayout(),
-			"../resources/texture/texture.jpg"};
+			assetManager.loadImage("resources/texture/texture.jpg"),
+			simpleRenderSystem.getPipelineId()};
+		std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem;
+		if (cjhDevice.supportsDrawIndirectFirstInstance())
+		{
+			gpuDrivenRenderSystem = std::make_unique<GpuDrivenRenderSystem>(
+				cjhDevice,
+				pipelineManager,
+				cjhRenderer.getSwapChainRenderPass(),
+				globalSetLayout->getDescriptorSetLayout());
+		}
+		// the GPU driven path keeps its objects in persistent buffers and is only told about changes,
+		// the objects it does not draw go through the render queue when it is on
+		std::vector<CjhGameObject *> queuedObjects;
+		auto registerObject = [&](CjhGameObject &object)
+		{
+			if (object.model != nullptr && (!gpuDrivenRenderSystem || !gpuDrivenRenderSystem->setObject(object)))
+			{
+				queuedObjects.push_back(&object);
+			}
+		};
+		for (auto &kv : gameObjects)
+		{
+			registerObject(kv.second);
+		}
+		bool gpuCulling = gpuDrivenRenderSystem != nullptr;
+		bool occlusionCulling = gpuCulling && cjhRenderer.isDepthSampleable();
+		bool cpuCulling = true;
+		bool bvhCulling = true;
+		bool mouseWasDown = false;
+		bool hasPickedObject = false;
+		CjhGameObject::id_t pickedObject = 0;
+
+		// startup models and textures are drawn right away, make sure they are resident
+		cjhDevice.stagingRing().finish();
 
 		CjhCamera camera{};
 
@@ -95,6 +138,30 @@ namespace cjh
 		{
 			glfwPollEvents();
 
+			auto addImportedObject = [&](std::shared_ptr<CjhModel> model)
+			{
+				auto object = CjhGameObject::createGameObject();
+				object.model = std::move(model);
+				object.renderSystem = CjhModel::RenderSystem::Simple;
+				object.transform.setIsVulkanModel(true);
+				registerObject(gameObjects.emplace(object.getId(), std::move(object)).first->second);
+			};
+			for (auto &path : cjhWindow.takeDroppedPaths())
+			{
+				// a file dropped again shares the model that is already loaded
+				if (auto model = assetManager.findModel(path))
+				{
+					addImportedObject(std::move(model));
+					continue;
+				}
+				cjhModelImporter.request(path);
+			}
+			for (auto &imported : cjhModelImporter.poll())
+			{
+				assetManager.addModel(imported.filepath, imported.model);
+				addImportedObject(std::move(imported.model));
+			}
+
 			cjhUI.NewFrame();
 
 			auto newTime = std::chrono::high_resolution_clock::now();
@@ -108,8 +175,21 @@ namespace cjh
 			float aspect = cjhRenderer.getAspectRatio();
 			camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
+			bool mouseDown = glfwGetMouseButton(cjhWindow.getGLFWwindow(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+			if (mouseDown && !mouseWasDown && !ImGui::GetIO().WantCaptureMouse)
+			{
+				hasPickedObject = pickObject(camera, pickedObject);
+			}
+			mouseWasDown = mouseDown;
+
+			// submit the uploads recorded so far and hand finished ones over to the graphics queue
+			cjhDevice.stagingRing().flush();
+
 			if (auto commandBuffer = cjhRenderer.beginFrame())
 			{
+				geometryArena.beginFrame();
+				pipelineManager.beginFrame();
+				assetManager.beginFrame();
 				int frameIndex = cjhRenderer.getFrameIndex();
 				FrameInfo frameInfo{
 					frameIndex,
@@ -117,7 +197,37 @@ namespace cjh
 					commandBuffer,
 					camera,
 					globalDescriptorSets[frameIndex],
-					gameObjects};
+					gameObjects,
+					renderQueue};
+
+				renderQueue.clear();
+				if (gpuCulling)
+				{
+					// the GPU culls its own objects, the few others are drawn as they are
+					renderQueue.submitObjects(queuedObjects, camera);
+				}
+				else if (cpuCulling && bvhCulling)
+				{
+					updateSceneBvh();
+					sceneBvh.queryFrustum(camera.getFrustumPlanes(), visibleIds);
+					visibleObjects.clear();
+					for (uint32_t id : visibleIds)
+					{
+						visibleObjects.push_back(&gameObjects.at(id));
+					}
+					renderQueue.submitObjects(visibleObjects, camera);
+				}
+				else if (cpuCulling)
+				{
+					frustumCuller.gather(gameObjects);
+					frustumCuller.cull(camera.getFrustumPlanes());
+					renderQueue.submitObjects(frustumCuller.visibleObjects(), camera);
+				}
+				else
+				{
+					renderQueue.submitObjects(gameObjects, camera);
+				}
+				renderQueue.sort();
 
 				// update
 				GlobalUbo ubo{};
@@ -128,11 +238,37 @@ namespace cjh
 				uboBuffers[frameIndex]->writeToBuffer(&ubo);
 				uboBuffers[frameIndex]->flush();
 
+				// compute work has to be recorded outside of the render pass
+				bool drawGpuDriven = gpuCulling;
+				bool splitFrame = drawGpuDriven && occlusionCulling;
+				if (drawGpuDriven)
+				{
+					gpuDrivenRenderSystem->cull(frameInfo, cjhRenderer.getSwapChainExtent(), occlusionCulling);
+				}
+
 				// render
-				cjhRenderer.beginSwapChainRenderPass(commandBuffer);
+				cjhRenderer.beginSwapChainRenderPass(
+					commandBuffer,
+					splitFrame ? CjhSwapChain::PassPart::BeforeDepthRead : CjhSwapChain::PassPart::Whole);
 
 				// order here matters
-				simpleRenderSystem.renderGameObjects(frameInfo);
+				if (drawGpuDriven)
+				{
+					gpuDrivenRenderSystem->render(frameInfo);
+				}
+				else
+				{
+					simpleRenderSystem.renderGameObjects(frameInfo);
+				}
+				// the occluders are what the first culling phase let through, the rest of the frame
+				// is drawn after the disoccluded objects
+				if (splitFrame)
+				{
+					cjhRenderer.endSwapChainRenderPass(commandBuffer);
+					gpuDrivenRenderSystem->cullDisoccluded(frameInfo, cjhRenderer.getDepthImageView());
+					cjhRenderer.beginSwapChainRenderPass(commandBuffer, CjhSwapChain::PassPart::AfterDepthRead);
+					gpuDrivenRenderSystem->renderDisoccluded(frameInfo);
+				}
 				textureRenderSystem.renderGameObjects(frameInfo);
 				pointLightSystem.render(frameInfo);
 
@@ -143,6 +279,94 @@ namespace cjh
 				ImGui::Checkbox("Demo Window", cjhUI.getShowDemoWindow()); // Edit bools storing our window open/close state
 				ImGui::Checkbox("Another Window", cjhUI.getShowAnotherWindow());
 				ImGui::Checkbox("Imgui Hello World Window", cjhUI.getShowHelloWorldWindow());
+				auto memoryStats = cjhDevice.allocator().getStats();
+				ImGui::Text("GPU memory: %.1f / %.1f MB in %u blocks (+%u dedicated), %u allocations",
+							memoryStats.usedBytes / (1024.0 * 1024.0),
+							memoryStats.reservedBytes / (1024.0 * 1024.0),
+							memoryStats.blockCount,
+							memoryStats.dedicatedAllocationCount,
+							memoryStats.allocationCount);
+				if (gpuDrivenRenderSystem)
+				{
+					ImGui::Checkbox("GPU culling", &gpuCulling);
+				}
+				if (gpuCulling && cjhRenderer.isDepthSampleable())
+				{
+					ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+				}
+				if (!gpuCulling)
+				{
+					ImGui::Checkbox("CPU frustum culling", &cpuCulling);
+				}
+				if (!gpuCulling && cpuCulling)
+				{
+					ImGui::Checkbox("BVH culling", &bvhCulling);
+				}
+				if (!gpuCulling && cpuCulling && bvhCulling)
+				{
+					const auto &bvhStats = sceneBvh.stats();
+					ImGui::Text("BVH: %u of %u objects visible, height %u, %u wide nodes, %llu refits, %llu rotations",
+								static_cast<uint32_t>(visibleIds.size()),
+								bvhStats.proxyCount,
+								bvhStats.height,
+								bvhStats.wideNodeCount,
+								static_cast<unsigned long long>(bvhStats.refits),
+								static_cast<unsigned long long>(bvhStats.rotations));
+				}
+				else if (!gpuCulling && cpuCulling)
+				{
+					const auto &cullStats = frustumCuller.stats();
+					ImGui::Text("CPU culling: %u of %u objects visible, %.2f ns per object (%u lanes)",
+								cullStats.visibleCount,
+								cullStats.testedCount,
+								cullStats.nanosecondsPerObject,
+								CjhFrustumCuller::laneCount());
+				}
+				uint32_t simpleDrawCount =
+					drawGpuDriven ? gpuDrivenRenderSystem->getDrawCount() : simpleRenderSystem.getDrawCount();
+				ImGui::Text("%u draws for %u objects",
+							simpleDrawCount + textureRenderSystem.getDrawCount(),
+							static_cast<uint32_t>(renderQueue.size()) +
+								(drawGpuDriven ? gpuDrivenRenderSystem->getObjectCount() : 0));
+				if (drawGpuDriven)
+				{
+					ImGui::Text("GPU culling: %u indirect commands, %u of %u objects visible",
+								gpuDrivenRenderSystem->getIndirectCount(),
+								gpuDrivenRenderSystem->getVisibleCount(),
+								gpuDrivenRenderSystem->getObjectCount());
+					if (occlusionCulling)
+					{
+						ImGui::Text("Occlusion culling: %u objects drawn by the second phase",
+									gpuDrivenRenderSystem->getDisoccludedCount());
+					}
+				}
+				const auto &assetStats = assetManager.stats();
+				ImGui::Text("Assets: %u resident, %.1f / %.1f MB, %llu hits, %llu misses, %llu evicted",
+							assetStats.residentCount,
+							assetStats.residentBytes / (1024.0 * 1024.0),
+							assetManager.getBudget() / (1024.0 * 1024.0),
+							static_cast<unsigned long long>(assetStats.hits),
+							static_cast<unsigned long long>(assetStats.misses),
+							static_cast<unsigned long long>(assetStats.evictions));
+				if (pipelineManager.pendingCount() > 0)
+				{
+					ImGui::Text("Compiling %u pipeline(s)...", pipelineManager.pendingCount());
+				}
+				if (cjhModelImporter.pendingCount() > 0)
+				{
+					ImGui::Text("Importing %d model(s)...", static_cast<int>(cjhModelImporter.pendingCount()));
+				}
+				const auto &importStats = cjhModelImporter.stats();
+				if (importStats.stagedBytes > 0)
+				{
+					ImGui::Text("Imported %.1f MB, %.2f bytes copied per byte",
+								importStats.stagedBytes / (1024.0 * 1024.0),
+								static_cast<double>(importStats.copiedBytes) / importStats.stagedBytes);
+				}
+				if (hasPickedObject)
+				{
+					ImGui::Text("Picked object %u", pickedObject);
+				}
 				for (auto &kv : frameInfo.gameObjects)
 				{
 					auto &obj = kv.second;
@@ -164,35 +388,125 @@ namespace cjh
 		vkDeviceWaitIdle(cjhDevice.device());
 	}
 
+	void FirstApp::updateSceneBvh()
+	{
+		auto worldBox = [](CjhGameObject &obj)
+		{
+			CjhModel::Bounds bounds = obj.model->getBounds().transformed(obj.transform.mat4());
+			return CjhAabb{bounds.min, bounds.max};
+		};
+
+		if (bvhProxies.empty())
+		{
+			std::vector<std::pair<CjhAabb, uint32_t>> items;
+			for (auto &kv : gameObjects)
+			{
+				if (kv.second.model != nullptr)
+				{
+					items.push_back({worldBox(kv.second), kv.first});
+				}
+			}
+			auto proxies = sceneBvh.build(items);
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				bvhProxies[items[i].second] = proxies[i];
+			}
+			return;
+		}
+
+		// objects that did not leave their enlarged box cost one containment test
+		for (auto &kv : gameObjects)
+		{
+			if (kv.second.model == nullptr)
+				continue;
+			auto proxy = bvhProxies.find(kv.first);
+			if (proxy == bvhProxies.end())
+			{
+				bvhProxies[kv.first] = sceneBvh.createProxy(worldBox(kv.second), kv.first);
+				continue;
+			}
+			sceneBvh.moveProxy(proxy->second, worldBox(kv.second));
+		}
+	}
+
+	bool FirstApp::pickObject(const CjhCamera &camera, CjhGameObject::id_t &id)
+	{
+		int width, height;
+		double cursorX, cursorY;
+		glfwGetWindowSize(cjhWindow.getGLFWwindow(), &width, &height);
+		glfwGetCursorPos(cjhWindow.getGLFWwindow(), &cursorX, &cursorY);
+		if (width == 0 || height == 0)
+		{
+			return false;
+		}
+
+		// the cursor's points on the near and far plane, Vulkan clip space y points down
+		glm::vec2 ndc{2.f * static_cast<float>(cursorX) / width - 1.f, 2.f * static_cast<float>(cursorY) / height - 1.f};
+		glm::mat4 inverseViewProjection = glm::inverse(camera.getProjection() * camera.getView());
+		glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, 0.f, 1.f);
+		glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.f, 1.f);
+		glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+		glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+		updateSceneBvh();
+		// box hits are refined against the object's bounding sphere
+		auto hitSphere = [&](uint32_t objectId)
+		{
+			auto &obj = gameObjects.at(objectId);
+			glm::vec4 sphere = obj.model->getBounds().transformed(obj.transform.mat4()).sphere;
+			glm::vec3 offset = origin - glm::vec3(sphere);
+			float b = glm::dot(offset, direction);
+			float c = glm::dot(offset, offset) - sphere.w * sphere.w;
+			float discriminant = b * b - c;
+			if (discriminant < 0.f)
+			{
+				return -1.f;
+			}
+			float root = std::sqrt(discriminant);
+			return -b - root >= 0.f ? -b - root : -b + root;
+		};
+		CjhBvh::RayHit hit;
+		if (!sceneBvh.raycast(origin, direction, std::numeric_limits<float>::max(), hit, hitSphere))
+		{
+			return false;
+		}
+		id = hit.id;
+		return true;
+	}
+
 	void FirstApp::loadGameObjects()
 	{
-		std::shared_ptr<CjhModel> model =
-			CjhModel::createModelFromFile(cjhDevice, "models/bunny.obj");
-
-		auto bunny = CjhGameObject::createGameObject();
-		model->m_render_system = "Simple";
-		bunny.model = model;
-		bunny.transform.translation = glm::vec3(-.5f, .5f, 0.5f);
-		bunny.transform.scale = glm::vec3(.3f) * glm::vec3(1.0f, 1.0f, 1.0f);
-		bunny.transform.setIsVulkanModel(true);
-		gameObjects.emplace(bunny.getId(), std::move(bunny));
-
-		model = CjhModel::createModelFromFile(cjhDevice, "models/dragon.obj");
-		model->m_render_system = "Simple";
-		auto dragon = CjhGameObject::createGameObject();
-		dragon.model = model;
-		dragon.transform.translation = glm::vec3(.5f, .2f, 0.5f);
-		dragon.transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
-		dragon.transform.setIsVulkanModel(true);
-		gameObjects.emplace(dragon.getId(), std::move(dragon));
-
-		model = CjhModel::createModelFromFile(cjhDevice, "models/quad.obj");
-		model->m_render_system = "Texture";
-		auto floor = CjhGameObject::createGameObject();
-		floor.model = model;
-		floor.transform.translation = {0.f, .5f, 0.f};
-		floor.transform.scale = {3.f, 1.f, 3.f};
-		gameObjects.emplace(floor.getId(), std::move(floor));
+		CjhVfs &vfs = CjhVfs::shared();
+		if (!vfs.exists(DEFAULT_SCENE))
+		{
+			writeDefaultScene(vfs.getLooseRoot() + DEFAULT_SCENE);
+		}
+
+		auto stats = CjhScene::load(DEFAULT_SCENE, gameObjects, assetManager);
+		std::cout << DEFAULT_SCENE << ": " << stats.objectCount << " objects, " << stats.modelCount
+				  << " models in " << stats.seconds * 1000.f << " ms" << std::endl;
+	}
+
+	void FirstApp::writeDefaultScene(const std::string &diskPath)
+	{
+		CjhScene::Writer scene;
+
+		uint32_t bunny = scene.addModel("models/bunny.obj", scene_format::RenderSystem::Simple);
+		TransformComponent transform{};
+		transform.translation = glm::vec3(-.5f, .5f, 0.5f);
+		transform.scale = glm::vec3(.3f);
+		scene.addObject(bunny, transform, true);
+
+		uint32_t dragon = scene.addModel("models/dragon.obj", scene_format::RenderSystem::Simple);
+		transform = {};
+		transform.translation = glm::vec3(.5f, .2f, 0.5f);
+		scene.addObject(dragon, transform, true);
+
+		uint32_t floor = scene.addModel("models/quad.obj", scene_format::RenderSystem::Texture);
+		transform = {};
+		transform.translation = {0.f, .5f, 0.f};
+		transform.scale = {3.f, 1.f, 3.f};
+		scene.addObject(floor, transform);
 
 		std::vector<glm::vec3> lightColors{
 			{1.f, .1f, .1f},
@@ -205,15 +519,14 @@ namespace cjh
 
 		for (int i = 0; i < lightColors.size(); i++)
 		{
-			auto pointLight = CjhGameObject::makePointLight(0.2f);
-			pointLight.color = lightColors[i];
 			auto rotateLight = glm::rotate(
 				glm::mat4(1.f),
 				(i * glm::two_pi<float>()) / lightColors.size(),
 				{0.f, -1.f, 0.f});
-			pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
-			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+			scene.addPointLight(glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f)), 0.2f, 0.1f, lightColors[i]);
 		}
+
+		scene.save(diskPath);
 	}
 
 } // namespace lve
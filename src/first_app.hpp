@@ -1,14 +1,23 @@
 #pragma once
 
+#include "vk/cjh_asset_manager.hpp"
+#include "vk/cjh_bvh.hpp"
 #include "vk/cjh_descriptors.hpp"
 #include "vk/cjh_device.hpp"
+#include "vk/cjh_frustum_culler.hpp"
 #include "vk/cjh_game_object.hpp"
+#include "vk/cjh_geometry_arena.hpp"
+#include "vk/cjh_model_importer.hpp"
+#include "vk/cjh_pipeline_manager.hpp"
+#include "vk/cjh_render_queue.hpp"
 #include "vk/cjh_renderer.hpp"
 #include "vk/cjh_window.hpp"
 #include "vk/cjh_ui.hpp"
 
 // std
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace cjh
@@ -18,6 +27,7 @@ namespace cjh
   public:
     static constexpr int WIDTH = 800;
     static constexpr int HEIGHT = 600;
+    static constexpr const char *DEFAULT_SCENE = "scenes/default.cscene";
 
     FirstApp();
     ~FirstApp();
@@ -29,15 +39,31 @@ namespace cjh
 
   private:
     void loadGameObjects();
+    // the scene the engine shipped with before scenes were data, written when the file is missing
+    void writeDefaultScene(const std::string &diskPath);
+    // brings the world boxes of the objects into sceneBvh, the first call builds it
+    void updateSceneBvh();
+    // the object under the cursor, if any
+    bool pickObject(const CjhCamera &camera, CjhGameObject::id_t &id);
 
     CjhWindow cjhWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
     CjhDevice cjhDevice{cjhWindow};
     CjhRenderer cjhRenderer{cjhWindow, cjhDevice};
     std::unique_ptr<CjhDescriptorPool> globalPool{};
     CjhUI cjhUI{&cjhDevice, &cjhWindow, &cjhRenderer};
+    CjhGeometryArena geometryArena{cjhDevice};
+    CjhAssetManager assetManager{cjhDevice, &geometryArena};
+    CjhModelImporter cjhModelImporter{cjhDevice, &geometryArena};
+    CjhPipelineManager pipelineManager{cjhDevice};
 
     // note: order of declarations matters
 
     CjhGameObject::Map gameObjects;
+    CjhFrustumCuller frustumCuller;
+    CjhBvh sceneBvh;
+    std::unordered_map<CjhGameObject::id_t, int32_t> bvhProxies;
+    std::vector<uint32_t> visibleIds;
+    std::vector<CjhGameObject *> visibleObjects;
+    CjhRenderQueue renderQueue;
   };
 } // namespace lve
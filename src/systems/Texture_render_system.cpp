@@ -14,21 +14,17 @@
 namespace cjh
 {
 
-  struct TexturePushConstantData
-  {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat4 normalMatrix{1.f};
-  };
-
-  TextureRenderSystem::TextureRenderSystem(CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, std::string path)
-      : cjhDevice{device}, m_cjhImage(device, path)
+  TextureRenderSystem::TextureRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, std::shared_ptr<CjhImage> image, CjhPipelineManager::Id fallbackPipeline)
+      : m_cjhImage{std::move(image)}, cjhDevice{device}, pipelineManager{pipelineManager}, instanceBuffer{device}
   {
     createPipelineLayout(globalSetLayout);
-    createPipeline(renderPass);
+    createPipeline(renderPass, fallbackPipeline);
   }
 
   TextureRenderSystem::~TextureRenderSystem()
   {
+    // waits for a compile that still uses the layout
+    pipelineManager.release(pipelineId);
     vkDestroyPipelineLayout(cjhDevice.device(), m_PipelineLayout, nullptr);
   }
 
@@ -49,17 +45,12 @@ namespace cjh
     imageSampleSets.resize(CjhSwapChain::MAX_FRAMES_IN_FLIGHT);
     for (int i = 0; i < imageSampleSets.size(); i++)
     {
-      auto imageInfo = m_cjhImage.descriptorInfo();
+      auto imageInfo = m_cjhImage->descriptorInfo();
       CjhDescriptorWriter(*imageSampleSetLayout, *m_textureRenderSystemPool)
           .writeImage(0, &imageInfo)
           .build(imageSampleSets[i]);
     }
 
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(TexturePushConstantData);
-
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout,
                                                             imageSampleSetLayout->getDescriptorSetLayout()};
 
@@ -67,8 +58,6 @@ namespace cjh
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     if (vkCreatePipelineLayout(cjhDevice.device(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) !=
         VK_SUCCESS)
     {
@@ -76,19 +65,20 @@ namespace cjh
     }
   }
 
-  void TextureRenderSystem::createPipeline(VkRenderPass renderPass)
+  void TextureRenderSystem::createPipeline(VkRenderPass renderPass, CjhPipelineManager::Id fallbackPipeline)
   {
     assert(m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
-    CjhPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = m_PipelineLayout;
-    cjhPipeline = std::make_unique<CjhPipeline>(
-        cjhDevice,
-        "shaders/spv/texture_shader.vert.spv",
+    auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+    CjhPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+    CjhPipeline::enableInstancing(*pipelineConfig);
+    pipelineConfig->renderPass = renderPass;
+    pipelineConfig->pipelineLayout = m_PipelineLayout;
+    pipelineId = pipelineManager.request(
+        "shaders/spv/texture_shader_instanced.vert.spv",
         "shaders/spv/texture_shader.frag.spv",
-        pipelineConfig);
+        std::move(pipelineConfig),
+        fallbackPipeline);
   }
 
   void TextureRenderSystem::createImages(std::vector<std::string> path)
@@ -104,8 +94,27 @@ namespace cjh
   void TextureRenderSystem::renderGameObjects(
       FrameInfo &frameInfo)
   {
-    cjhPipeline->bind(frameInfo.commandBuffer);
+    drawCount = 0;
+    auto packets = frameInfo.renderQueue.range(static_cast<uint32_t>(CjhModel::RenderSystem::Texture));
+    CjhPipeline *pipeline = pipelineManager.get(pipelineId);
+    if (packets.empty() || pipeline == nullptr)
+    {
+      // nothing to draw or still compiling
+      return;
+    }
 
+    // one instance per packet, in queue order, so every run of one mesh is a contiguous range
+    CjhModel::Instance *instances = instanceBuffer.map(frameInfo.frameIndex, static_cast<uint32_t>(packets.size()));
+    for (const auto &packet : packets)
+    {
+      auto &obj = *packet.object;
+      instances->modelMatrix = obj.transform.mat4();
+      instances->normalMatrix = obj.transform.normalMatrix();
+      instances++;
+    }
+    instanceBuffer.flush(frameInfo.frameIndex);
+
+    pipeline->bind(frameInfo.commandBuffer);
     vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             m_PipelineLayout,
@@ -114,36 +123,48 @@ namespace cjh
                             &frameInfo.globalDescriptorSet,
                             0,
                             nullptr);
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            m_PipelineLayout,
-                            1,
-                            1,
-                            &imageSampleSets[frameInfo.frameIndex],
-                            0,
-                            nullptr);
-
-    for (auto &kv : frameInfo.gameObjects)
+    instanceBuffer.bind(frameInfo.commandBuffer, frameInfo.frameIndex);
+
+    // packets are sorted by material, then mesh; each run of one model with one material is a
+    // single instanced draw, and bindings only change when the key does
+    uint32_t boundMaterial = UINT32_MAX;
+    CjhGeometryArena *boundArena = nullptr;
+    const auto *first = packets.begin();
+    while (first != packets.end())
     {
-      auto &obj = kv.second;
-      if (obj.model == nullptr)
-        continue;
-      if (obj.model->m_render_system == "Texture")
+      CjhModel *model = first->object->model.get();
+      uint32_t material = CjhRenderQueue::materialOf(first->key);
+      const auto *last = first + 1;
+      while (last != packets.end() && last->object->model.get() == model &&
+             CjhRenderQueue::materialOf(last->key) == material)
+      {
+        ++last;
+      }
+
+      if (material != boundMaterial)
+      {
+        // every material samples the system's one image for now
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                m_PipelineLayout,
+                                1,
+                                1,
+                                &imageSampleSets[frameInfo.frameIndex],
+                                0,
+                                nullptr);
+        boundMaterial = material;
+      }
+      if (model->getGeometryArena() == nullptr || model->getGeometryArena() != boundArena)
       {
-        TexturePushConstantData push{};
-        push.modelMatrix = obj.transform.mat4();
-        push.normalMatrix = obj.transform.normalMatrix();
-
-        vkCmdPushConstants(
-            frameInfo.commandBuffer,
-            m_PipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(TexturePushConstantData),
-            &push);
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
+        model->bind(frameInfo.commandBuffer);
+        boundArena = model->getGeometryArena();
       }
+      model->draw(
+          frameInfo.commandBuffer,
+          static_cast<uint32_t>(last - first),
+          static_cast<uint32_t>(first - packets.begin()));
+      drawCount++;
+      first = last;
     }
   }
 
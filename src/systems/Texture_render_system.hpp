@@ -4,7 +4,8 @@
 #include "vk/cjh_device.hpp"
 #include "vk/cjh_frame_info.hpp"
 #include "vk/cjh_game_object.hpp"
-#include "vk/cjh_pipeline.hpp"
+#include "vk/cjh_instance_buffer.hpp"
+#include "vk/cjh_pipeline_manager.hpp"
 
 #include "vk/cjh_image.hpp"
 #include "vk/cjh_descriptors.hpp"
@@ -19,23 +20,30 @@ namespace cjh
   class TextureRenderSystem
   {
   public:
-    TextureRenderSystem(CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, std::string paths);
+    // fallbackPipeline draws the objects while the textured pipeline compiles, it has to be an
+    // instanced pipeline whose layout only uses the global set (e.g. the simple render system's)
+    TextureRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, std::shared_ptr<CjhImage> image, CjhPipelineManager::Id fallbackPipeline = CjhPipelineManager::NO_PIPELINE);
     ~TextureRenderSystem();
 
     TextureRenderSystem(const TextureRenderSystem &) = delete;
     TextureRenderSystem &operator=(const TextureRenderSystem &) = delete;
 
     void renderGameObjects(FrameInfo &frameInfo);
+    // draw calls recorded by the last renderGameObjects()
+    uint32_t getDrawCount() const { return drawCount; }
 
   private:
     void createImages(std::vector<std::string> path);
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void createPipeline(VkRenderPass renderPass);
-    CjhImage m_cjhImage;
+    void createPipeline(VkRenderPass renderPass, CjhPipelineManager::Id fallbackPipeline);
+    std::shared_ptr<CjhImage> m_cjhImage;
     std::vector<CjhImage> m_cjhImages;
     CjhDevice &cjhDevice;
 
-    std::unique_ptr<CjhPipeline> cjhPipeline;
+    CjhPipelineManager &pipelineManager;
+    CjhPipelineManager::Id pipelineId = CjhPipelineManager::NO_PIPELINE;
+    CjhInstanceBuffer instanceBuffer;
+    uint32_t drawCount = 0;
     std::vector<VkDescriptorSet> imageSampleSets;
     std::unique_ptr<CjhDescriptorPool> m_textureRenderSystemPool;
     VkPipelineLayout m_PipelineLayout;
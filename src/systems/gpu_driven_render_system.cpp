@@ -0,0 +1,682 @@
+#include "gpu_driven_render_system.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace cjh
+{
+
+  // std140 block shared with cull.comp
+  struct CullData
+  {
+    glm::mat4 viewProjection{1.f};
+    glm::mat4 pyramidViewProjection{1.f};
+    glm::vec2 pyramidSize{0.f};
+    uint32_t objectCount = 0;
+    uint32_t drawCount = 0;
+  };
+
+  struct CullPushConstantData
+  {
+    uint32_t phase = 0;
+    uint32_t occlusionCulling = 0;
+  };
+
+  namespace
+  {
+    constexpr uint32_t CULL_GROUP_SIZE = 64;
+    constexpr uint32_t INITIAL_OBJECT_CAPACITY = 1024;
+    constexpr uint32_t INITIAL_DRAW_CAPACITY = 64;
+    constexpr VkDeviceSize INITIAL_UPLOAD_BYTES = 64 * 1024;
+
+    uint32_t grownCapacity(uint32_t capacity, uint32_t initialCapacity, uint32_t count)
+    {
+      uint32_t newCapacity = capacity > 0 ? capacity : initialCapacity;
+      while (newCapacity < count)
+      {
+        newCapacity *= 2;
+      }
+      return newCapacity;
+    }
+  } // namespace
+
+  GpuDrivenRenderSystem::GpuDrivenRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+      : cjhDevice{device}, pipelineManager{pipelineManager}
+  {
+    createDescriptors();
+    createPipelineLayouts(globalSetLayout);
+    createPipelines(renderPass);
+  }
+
+  GpuDrivenRenderSystem::~GpuDrivenRenderSystem()
+  {
+    // waits for a compile that still uses the layout
+    pipelineManager.release(pipelineId);
+    cullPipeline.reset();
+    vkDestroyPipelineLayout(cjhDevice.device(), drawPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(cjhDevice.device(), cullPipelineLayout, nullptr);
+  }
+
+  void GpuDrivenRenderSystem::createDescriptors()
+  {
+    descriptorPool =
+        CjhDescriptorPool::Builder(cjhDevice)
+            .setMaxSets(2 * CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+            .build();
+    cullSetLayout =
+        CjhDescriptorSetLayout::Builder(cjhDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+    drawSetLayout =
+        CjhDescriptorSetLayout::Builder(cjhDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+  }
+
+  void GpuDrivenRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout)
+  {
+    VkPushConstantRange cullPushConstantRange{};
+    cullPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullPushConstantRange.offset = 0;
+    cullPushConstantRange.size = sizeof(CullPushConstantData);
+
+    VkDescriptorSetLayout cullSetLayouts[] = {cullSetLayout->getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = cullSetLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &cullPushConstantRange;
+    if (vkCreatePipelineLayout(cjhDevice.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) !=
+        VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout,
+                                                            drawSetLayout->getDescriptorSetLayout()};
+
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    // the draws read everything per object from the storage buffers
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    if (vkCreatePipelineLayout(cjhDevice.device(), &pipelineLayoutInfo, nullptr, &drawPipelineLayout) !=
+        VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline layout!");
+    }
+  }
+
+  void GpuDrivenRenderSystem::createPipelines(VkRenderPass renderPass)
+  {
+    assert(drawPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+    cullPipeline = std::make_unique<CjhComputePipeline>(cjhDevice, "shaders/spv/cull.comp.spv", cullPipelineLayout);
+
+    auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+    CjhPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+    pipelineConfig->renderPass = renderPass;
+    pipelineConfig->pipelineLayout = drawPipelineLayout;
+    pipelineId = pipelineManager.request(
+        "shaders/spv/simple_shader_indirect.vert.spv",
+        "shaders/spv/simple_shader.frag.spv",
+        std::move(pipelineConfig));
+  }
+
+  uint32_t GpuDrivenRenderSystem::acquireMesh(const std::shared_ptr<CjhModel> &model)
+  {
+    auto it = meshOf.find(model.get());
+    uint32_t mesh;
+    if (it != meshOf.end())
+    {
+      mesh = it->second;
+    }
+    else
+    {
+      if (freeMeshes.empty())
+      {
+        mesh = static_cast<uint32_t>(meshes.size());
+        meshes.emplace_back();
+      }
+      else
+      {
+        mesh = freeMeshes.back();
+        freeMeshes.pop_back();
+      }
+      meshes[mesh].model = model;
+      meshOf[model.get()] = mesh;
+    }
+    meshes[mesh].objectCount++;
+    meshesChanged = true;
+    return mesh;
+  }
+
+  void GpuDrivenRenderSystem::releaseMesh(uint32_t mesh)
+  {
+    meshesChanged = true;
+    if (--meshes[mesh].objectCount > 0)
+    {
+      return;
+    }
+    meshOf.erase(meshes[mesh].model.get());
+    meshes[mesh].model.reset();
+    freeMeshes.push_back(mesh);
+  }
+
+  void GpuDrivenRenderSystem::markDirty(uint32_t slot)
+  {
+    if (!slotDirty[slot])
+    {
+      slotDirty[slot] = true;
+      dirtySlots.push_back(slot);
+    }
+  }
+
+  bool GpuDrivenRenderSystem::setObject(CjhGameObject &object)
+  {
+    const auto &model = object.model;
+    if (model == nullptr || !model->isIndexed() || object.renderSystem != CjhModel::RenderSystem::Simple)
+    {
+      removeObject(object.getId());
+      return false;
+    }
+
+    uint32_t slot;
+    auto it = slotOf.find(object.getId());
+    if (it == slotOf.end())
+    {
+      slot = static_cast<uint32_t>(slots.size());
+      slots.push_back({object.getId(), acquireMesh(model)});
+      records.emplace_back();
+      slotDirty.push_back(false);
+      slotOf[object.getId()] = slot;
+    }
+    else
+    {
+      slot = it->second;
+      if (meshes[slots[slot].mesh].model != model)
+      {
+        releaseMesh(slots[slot].mesh);
+        slots[slot].mesh = acquireMesh(model);
+      }
+    }
+
+    ObjectData &record = records[slot];
+    record.modelMatrix = object.transform.mat4();
+    record.normalMatrix = object.transform.normalMatrix();
+    record.boundingSphere = model->getBoundingSphere();
+    record.drawIndex = slots[slot].mesh;
+    markDirty(slot);
+    return true;
+  }
+
+  void GpuDrivenRenderSystem::removeObject(CjhGameObject::id_t id)
+  {
+    auto it = slotOf.find(id);
+    if (it == slotOf.end())
+    {
+      return;
+    }
+    uint32_t slot = it->second;
+    slotOf.erase(it);
+    releaseMesh(slots[slot].mesh);
+
+    // the last slot moves into the hole
+    uint32_t last = static_cast<uint32_t>(slots.size() - 1);
+    if (slot != last)
+    {
+      slots[slot] = slots[last];
+      records[slot] = records[last];
+      slotOf[slots[slot].id] = slot;
+      markDirty(slot);
+    }
+    slots.pop_back();
+    records.pop_back();
+    slotDirty.pop_back();
+  }
+
+  void GpuDrivenRenderSystem::reservePersistent(int frameIndex)
+  {
+    uint32_t capacity = objects ? objects->getInstanceCount() : 0;
+    if (capacity < slots.size())
+    {
+      // in flight frames may still read the old buffer, the new one gets every record
+      if (objects)
+      {
+        retiredBuffers[frameIndex].push_back(std::move(objects));
+      }
+      objects = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(ObjectData),
+          grownCapacity(capacity, INITIAL_OBJECT_CAPACITY, static_cast<uint32_t>(slots.size())),
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      for (uint32_t slot = 0; slot < slots.size(); slot++)
+      {
+        markDirty(slot);
+      }
+    }
+    capacity = commandTemplates ? commandTemplates->getInstanceCount() / 2 : 0;
+    if (capacity < meshes.size())
+    {
+      if (commandTemplates)
+      {
+        retiredBuffers[frameIndex].push_back(std::move(commandTemplates));
+      }
+      commandTemplates = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(VkDrawIndexedIndirectCommand),
+          2 * grownCapacity(capacity, INITIAL_DRAW_CAPACITY, static_cast<uint32_t>(meshes.size())),
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      meshesChanged = true;
+    }
+  }
+
+  void GpuDrivenRenderSystem::reserve(FrameResources &frame)
+  {
+    bool changed = frame.objects != objects.get() || frame.depthPyramid != depthPyramid.get();
+    if (!frame.cullData)
+    {
+      frame.cullData = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(CullData),
+          1,
+          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      frame.cullData->map();
+    }
+    // the frame fence was waited on, nothing reads this frame's buffers anymore
+    uint32_t capacity = objects->getInstanceCount();
+    if (!frame.occluded || frame.occluded->getInstanceCount() < capacity)
+    {
+      // each phase has a slot for every object
+      frame.visible = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(uint32_t),
+          2 * capacity,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      frame.occluded = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(uint32_t),
+          capacity,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      changed = true;
+    }
+    capacity = commandTemplates->getInstanceCount();
+    if (!frame.draws || frame.draws->getInstanceCount() < capacity)
+    {
+      frame.draws = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(VkDrawIndexedIndirectCommand),
+          capacity,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      frame.draws->map();
+      changed = true;
+    }
+    if (!changed)
+    {
+      return;
+    }
+
+    auto objectsInfo = objects->descriptorInfo();
+    auto drawsInfo = frame.draws->descriptorInfo();
+    auto visibleInfo = frame.visible->descriptorInfo();
+    auto cullDataInfo = frame.cullData->descriptorInfo();
+    auto pyramidInfo = depthPyramid->descriptorInfo();
+    auto occludedInfo = frame.occluded->descriptorInfo();
+    frame.objects = objects.get();
+    frame.depthPyramid = depthPyramid.get();
+    CjhDescriptorWriter cullWriter{*cullSetLayout, *descriptorPool};
+    cullWriter.writeBuffer(0, &objectsInfo)
+        .writeBuffer(1, &drawsInfo)
+        .writeBuffer(2, &visibleInfo)
+        .writeBuffer(3, &cullDataInfo)
+        .writeImage(4, &pyramidInfo)
+        .writeBuffer(5, &occludedInfo);
+    CjhDescriptorWriter drawWriter{*drawSetLayout, *descriptorPool};
+    drawWriter.writeBuffer(0, &objectsInfo).writeBuffer(1, &visibleInfo);
+    if (frame.cullSet == VK_NULL_HANDLE)
+    {
+      if (!cullWriter.build(frame.cullSet) || !drawWriter.build(frame.drawSet))
+      {
+        throw std::runtime_error("failed to allocate gpu driven descriptor sets!");
+      }
+      return;
+    }
+    cullWriter.overwrite(frame.cullSet);
+    drawWriter.overwrite(frame.drawSet);
+  }
+
+  void GpuDrivenRenderSystem::recordUploads(VkCommandBuffer commandBuffer, FrameResources &frame)
+  {
+    constexpr VkDeviceSize commandSize = sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize commandBytes = 2 * indirectCount * commandSize;
+    // slots that were removed since they were marked are gone
+    dirtySlots.erase(
+        std::remove_if(dirtySlots.begin(), dirtySlots.end(), [&](uint32_t slot)
+                       { return slot >= slots.size(); }),
+        dirtySlots.end());
+    // sorted, so neighbouring slots become one copy region
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    VkDeviceSize recordBytes = dirtySlots.size() * sizeof(ObjectData);
+    VkDeviceSize uploadBytes = recordBytes + (meshesChanged ? commandBytes : 0);
+
+    if (uploadBytes > 0 && (!frame.uploads || frame.uploads->getBufferSize() < uploadBytes))
+    {
+      frame.uploads = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          1,
+          static_cast<uint32_t>(std::max<VkDeviceSize>(uploadBytes, INITIAL_UPLOAD_BYTES)),
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      frame.uploads->map();
+    }
+
+    std::vector<VkBufferCopy> recordCopies;
+    auto *staging = uploadBytes > 0 ? static_cast<uint8_t *>(frame.uploads->getMappedMemory()) : nullptr;
+    for (size_t i = 0; i < dirtySlots.size(); i++)
+    {
+      uint32_t slot = dirtySlots[i];
+      slotDirty[slot] = false;
+      VkDeviceSize offset = i * sizeof(ObjectData);
+      memcpy(staging + offset, &records[slot], sizeof(ObjectData));
+      if (i > 0 && dirtySlots[i - 1] + 1 == slot)
+      {
+        recordCopies.back().size += sizeof(ObjectData);
+        continue;
+      }
+      recordCopies.push_back({offset, slot * sizeof(ObjectData), sizeof(ObjectData)});
+    }
+    dirtySlots.clear();
+
+    if (meshesChanged)
+    {
+      // the meshes' slots in visible follow each other, the second phase's after all of the first's
+      auto *commands = reinterpret_cast<VkDrawIndexedIndirectCommand *>(staging + recordBytes);
+      uint32_t firstInstance = 0;
+      for (uint32_t i = 0; i < indirectCount; i++)
+      {
+        const Mesh &mesh = meshes[i];
+        VkDrawIndexedIndirectCommand command = mesh.model ? mesh.model->getIndirectCommand() : VkDrawIndexedIndirectCommand{};
+        command.instanceCount = 0;
+        command.firstInstance = firstInstance;
+        commands[i] = command;
+        command.firstInstance += objectCount;
+        commands[indirectCount + i] = command;
+        firstInstance += mesh.objectCount;
+      }
+    }
+    if (uploadBytes > 0)
+    {
+      frame.uploads->flush();
+    }
+
+    // Earlier frames may still read the persistent buffers, and their copies into them have to land
+    // before this frame's; the copies only wait for the shaders when records are overwritten.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    if (!recordCopies.empty())
+    {
+      srcStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer, srcStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (!recordCopies.empty())
+    {
+      vkCmdCopyBuffer(commandBuffer,
+                      frame.uploads->getBuffer(),
+                      objects->getBuffer(),
+                      static_cast<uint32_t>(recordCopies.size()),
+                      recordCopies.data());
+    }
+    // fresh commands go to the templates and straight into the frame, which otherwise starts
+    // from the templates
+    if (meshesChanged)
+    {
+      VkBufferCopy copy{recordBytes, 0, commandBytes};
+      vkCmdCopyBuffer(commandBuffer, frame.uploads->getBuffer(), commandTemplates->getBuffer(), 1, &copy);
+      vkCmdCopyBuffer(commandBuffer, frame.uploads->getBuffer(), frame.draws->getBuffer(), 1, &copy);
+      meshesChanged = false;
+    }
+    else
+    {
+      VkBufferCopy copy{0, 0, commandBytes};
+      vkCmdCopyBuffer(commandBuffer, commandTemplates->getBuffer(), frame.draws->getBuffer(), 1, &copy);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  void GpuDrivenRenderSystem::cull(FrameInfo &frameInfo, VkExtent2D depthExtent, bool occlusionCulling)
+  {
+    FrameResources &frame = frames[frameInfo.frameIndex];
+    secondPhase = false;
+    retiredPyramids[frameInfo.frameIndex].reset();
+    retiredBuffers[frameInfo.frameIndex].clear();
+    // the cull set samples a pyramid even when occlusion culling is off
+    if (depthPyramid == nullptr || depthPyramid->getDepthExtent().width != depthExtent.width ||
+        depthPyramid->getDepthExtent().height != depthExtent.height)
+    {
+      retiredPyramids[frameInfo.frameIndex] = std::move(depthPyramid);
+      depthPyramid = std::make_unique<CjhDepthPyramid>(cjhDevice, depthExtent);
+      pyramidValid = false;
+    }
+    if (!occlusionCulling)
+    {
+      pyramidValid = false;
+    }
+
+    // the counts the GPU wrote when this frame's buffers were last used, made available to the
+    // host by the barrier after each cull dispatch
+    visibleCount = 0;
+    disoccludedCount = 0;
+    if (frame.drawCount > 0)
+    {
+      frame.draws->invalidate();
+      auto *commands = static_cast<const VkDrawIndexedIndirectCommand *>(frame.draws->getMappedMemory());
+      for (uint32_t i = 0; i < frame.drawCount; i++)
+      {
+        visibleCount += commands[i].instanceCount;
+        disoccludedCount += commands[frame.drawCount + i].instanceCount;
+      }
+      visibleCount += disoccludedCount;
+    }
+
+    objectCount = static_cast<uint32_t>(slots.size());
+    indirectCount = static_cast<uint32_t>(meshes.size());
+    frame.drawCount = 0;
+    if (objectCount == 0)
+    {
+      indirectCount = 0;
+      return;
+    }
+
+    reservePersistent(frameInfo.frameIndex);
+    reserve(frame);
+    recordUploads(frameInfo.commandBuffer, frame);
+    frame.drawCount = indirectCount;
+
+    CullData cullData{};
+    cullData.viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+    cullData.pyramidViewProjection = pyramidViewProjection;
+    cullData.pyramidSize = glm::vec2(depthPyramid->width(), depthPyramid->height());
+    cullData.objectCount = objectCount;
+    cullData.drawCount = indirectCount;
+    frame.cullData->writeToBuffer(&cullData);
+    frame.cullData->flush();
+
+    dispatchCull(frameInfo, 0, occlusionCulling && pyramidValid);
+    secondPhase = occlusionCulling;
+  }
+
+  void GpuDrivenRenderSystem::cullDisoccluded(FrameInfo &frameInfo, VkImageView depthView)
+  {
+    if (!secondPhase)
+    {
+      return;
+    }
+    // the pyramid barriers also make the first phase's occluded flags visible
+    depthPyramid->build(frameInfo.commandBuffer, frameInfo.frameIndex, depthView);
+    pyramidViewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+    pyramidValid = true;
+    dispatchCull(frameInfo, 1, true);
+  }
+
+  void GpuDrivenRenderSystem::dispatchCull(FrameInfo &frameInfo, uint32_t phase, bool occlusionCulling)
+  {
+    FrameResources &frame = frames[frameInfo.frameIndex];
+    CullPushConstantData push{};
+    push.phase = phase;
+    push.occlusionCulling = occlusionCulling ? 1 : 0;
+
+    cullPipeline->bind(frameInfo.commandBuffer);
+    vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            cullPipelineLayout,
+                            0,
+                            1,
+                            &frame.cullSet,
+                            0,
+                            nullptr);
+    vkCmdPushConstants(
+        frameInfo.commandBuffer,
+        cullPipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(CullPushConstantData),
+        &push);
+    vkCmdDispatch(frameInfo.commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // the counts feed the indirect draws and are read back once the frame is done, the visible
+    // list feeds the vertex shader
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  void GpuDrivenRenderSystem::render(FrameInfo &frameInfo)
+  {
+    drawCount = 0;
+    drawCommands(frameInfo, 0);
+  }
+
+  void GpuDrivenRenderSystem::renderDisoccluded(FrameInfo &frameInfo)
+  {
+    if (secondPhase)
+    {
+      drawCommands(frameInfo, indirectCount);
+    }
+  }
+
+  void GpuDrivenRenderSystem::drawCommands(FrameInfo &frameInfo, uint32_t firstCommand)
+  {
+    FrameResources &frame = frames[frameInfo.frameIndex];
+    CjhPipeline *pipeline = pipelineManager.get(pipelineId);
+    if (frame.drawCount == 0 || pipeline == nullptr)
+    {
+      // nothing to draw or still compiling
+      return;
+    }
+
+    pipeline->bind(frameInfo.commandBuffer);
+    VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, frame.drawSet};
+    vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            drawPipelineLayout,
+                            0,
+                            2,
+                            descriptorSets,
+                            0,
+                            nullptr);
+
+    // commands of models in one geometry arena share the bound buffers, so with multi draw
+    // indirect each arena is a single call however many meshes it holds
+    bool multiDraw = cjhDevice.supportsMultiDrawIndirect();
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    uint32_t first = 0;
+    while (first < indirectCount)
+    {
+      CjhModel *model = meshes[first].model.get();
+      if (model == nullptr)
+      {
+        // unused mesh slot
+        first++;
+        continue;
+      }
+      CjhGeometryArena *arena = model->getGeometryArena();
+      uint32_t last = first + 1;
+      while (arena != nullptr && last < indirectCount && meshes[last].model != nullptr &&
+             meshes[last].model->getGeometryArena() == arena)
+      {
+        ++last;
+      }
+
+      model->bind(frameInfo.commandBuffer);
+      if (multiDraw)
+      {
+        vkCmdDrawIndexedIndirect(
+            frameInfo.commandBuffer, frame.draws->getBuffer(), (firstCommand + first) * stride, last - first, stride);
+        drawCount++;
+      }
+      else
+      {
+        for (uint32_t i = first; i < last; i++)
+        {
+          vkCmdDrawIndexedIndirect(
+              frameInfo.commandBuffer, frame.draws->getBuffer(), (firstCommand + i) * stride, 1, stride);
+          drawCount++;
+        }
+      }
+      first = last;
+    }
+  }
+
+} // namespace cjh
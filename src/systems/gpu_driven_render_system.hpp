@@ -0,0 +1,174 @@
+#pragma once
+
+#include "vk/cjh_buffer.hpp"
+#include "vk/cjh_depth_pyramid.hpp"
+#include "vk/cjh_descriptors.hpp"
+#include "vk/cjh_device.hpp"
+#include "vk/cjh_frame_info.hpp"
+#include "vk/cjh_game_object.hpp"
+#include "vk/cjh_pipeline.hpp"
+#include "vk/cjh_pipeline_manager.hpp"
+#include "vk/cjh_swap_chain.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace cjh
+{
+  // Draws the objects of the simple render system without a CPU draw loop. Objects are registered
+  // through setObject(), their transforms and model bounds live in a persistent storage buffer and
+  // only the records that changed are copied into it, so a frame costs the same however many objects
+  // there are. A compute pass frustum culls every registered object and counts the survivors into
+  // one indexed indirect command per mesh, and the vertex shader fetches its object through the
+  // compacted list of visible indices. Needs drawIndirectFirstInstance; draws are merged into one
+  // vkCmdDrawIndexedIndirect per geometry arena when multiDrawIndirect is there too.
+  //
+  // With occlusion culling the frame is culled in two phases. The first also tests the objects
+  // against a depth pyramid of the previous frame and draws what passes; the pyramid is then
+  // rebuilt from that depth and the objects the first phase found occluded are tested again, so
+  // anything that came into view since is drawn by the second phase instead of popping in late.
+  class GpuDrivenRenderSystem
+  {
+  public:
+    // layout shared with cull.comp and simple_shader_indirect.vert
+    struct ObjectData
+    {
+      glm::mat4 modelMatrix{1.f};
+      glm::mat4 normalMatrix{1.f};
+      glm::vec4 boundingSphere{0.f};
+      uint32_t drawIndex = 0;
+      uint32_t padding[3]{};
+    };
+
+    GpuDrivenRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    ~GpuDrivenRenderSystem();
+
+    GpuDrivenRenderSystem(const GpuDrivenRenderSystem &) = delete;
+    GpuDrivenRenderSystem &operator=(const GpuDrivenRenderSystem &) = delete;
+
+    // Registers the object, or updates it after its transform or model changed. Returns false, and
+    // forgets the object, when this system does not draw it: no model, a non indexed one, or one of
+    // another render system. The object has to stay where it is until it is removed.
+    bool setObject(CjhGameObject &object);
+    void removeObject(CjhGameObject::id_t id);
+
+    // Copies the records that changed since the last frame and records the first culling phase,
+    // outside of the render pass. depthExtent is the size of the depth attachment cullDisoccluded()
+    // will read.
+    void cull(FrameInfo &frameInfo, VkExtent2D depthExtent, bool occlusionCulling = false);
+    // inside the render pass, after cull() in the same frame
+    void render(FrameInfo &frameInfo);
+    // Between the two parts of a split frame, when cull() was asked for occlusion culling: builds
+    // the depth pyramid from the depth render() left and records the second culling phase.
+    void cullDisoccluded(FrameInfo &frameInfo, VkImageView depthView);
+    // inside the second part of the frame, draws what cullDisoccluded() found visible
+    void renderDisoccluded(FrameInfo &frameInfo);
+
+    // indirect commands per phase and draw calls recorded by the last frame
+    uint32_t getIndirectCount() const { return indirectCount; }
+    uint32_t getDrawCount() const { return drawCount; }
+    // objects the GPU found visible, read back from the frame that last used the same buffers;
+    // the disoccluded ones were drawn by the second phase
+    uint32_t getVisibleCount() const { return visibleCount; }
+    uint32_t getDisoccludedCount() const { return disoccludedCount; }
+    uint32_t getObjectCount() const { return objectCount; }
+
+  private:
+    // one indirect command per phase, shared by the objects of a model
+    struct Mesh
+    {
+      std::shared_ptr<CjhModel> model; // empty while the mesh is unused
+      uint32_t objectCount = 0;
+    };
+
+    struct Slot
+    {
+      CjhGameObject::id_t id;
+      uint32_t mesh;
+    };
+
+    struct FrameResources
+    {
+      // the commands of both phases, copied from the templates every frame; host visible so the
+      // counts can be read back
+      std::unique_ptr<CjhBuffer> draws;
+      // the slots of both phases
+      std::unique_ptr<CjhBuffer> visible;
+      std::unique_ptr<CjhBuffer> occluded;
+      std::unique_ptr<CjhBuffer> cullData;
+      // changed records on their way into the persistent buffers
+      std::unique_ptr<CjhBuffer> uploads;
+      VkDescriptorSet cullSet = VK_NULL_HANDLE;
+      VkDescriptorSet drawSet = VK_NULL_HANDLE;
+      // what the descriptor sets point at
+      CjhBuffer *objects = nullptr;
+      CjhDepthPyramid *depthPyramid = nullptr;
+      uint32_t drawCount = 0;
+    };
+
+    void createDescriptors();
+    void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+    void createPipelines(VkRenderPass renderPass);
+    uint32_t acquireMesh(const std::shared_ptr<CjhModel> &model);
+    void releaseMesh(uint32_t mesh);
+    void markDirty(uint32_t slot);
+    // grows the persistent buffers to the registered objects and meshes, old ones are retired
+    void reservePersistent(int frameIndex);
+    // grows the frame's buffers to the persistent ones and points its descriptor sets at them
+    void reserve(FrameResources &frame);
+    // records the copies of the changed records and the frame's fresh indirect commands
+    void recordUploads(VkCommandBuffer commandBuffer, FrameResources &frame);
+    void dispatchCull(FrameInfo &frameInfo, uint32_t phase, bool occlusionCulling);
+    void drawCommands(FrameInfo &frameInfo, uint32_t firstCommand);
+
+    CjhDevice &cjhDevice;
+
+    CjhPipelineManager &pipelineManager;
+    CjhPipelineManager::Id pipelineId = CjhPipelineManager::NO_PIPELINE;
+    std::unique_ptr<CjhComputePipeline> cullPipeline;
+    VkPipelineLayout cullPipelineLayout;
+    VkPipelineLayout drawPipelineLayout;
+
+    std::unique_ptr<CjhDescriptorPool> descriptorPool;
+    std::unique_ptr<CjhDescriptorSetLayout> cullSetLayout;
+    std::unique_ptr<CjhDescriptorSetLayout> drawSetLayout;
+    std::array<FrameResources, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+
+    // persistent: one record per registered object, and the commands of both phases with
+    // instanceCount 0 that every frame starts from
+    std::unique_ptr<CjhBuffer> objects;
+    std::unique_ptr<CjhBuffer> commandTemplates;
+    std::array<std::vector<std::unique_ptr<CjhBuffer>>, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> retiredBuffers;
+    // CPU copies of the records, slots are kept dense by moving the last one into a removed one
+    std::vector<ObjectData> records;
+    std::vector<Slot> slots;
+    std::unordered_map<CjhGameObject::id_t, uint32_t> slotOf;
+    std::vector<uint32_t> dirtySlots;
+    std::vector<bool> slotDirty;
+    std::vector<Mesh> meshes;
+    std::unordered_map<const CjhModel *, uint32_t> meshOf;
+    std::vector<uint32_t> freeMeshes;
+    bool meshesChanged = false;
+
+    std::unique_ptr<CjhDepthPyramid> depthPyramid;
+    // replaced on resize, destroyed once the frames that sampled them are done
+    std::array<std::unique_ptr<CjhDepthPyramid>, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> retiredPyramids;
+    glm::mat4 pyramidViewProjection{1.f};
+    bool pyramidValid = false;
+    bool secondPhase = false;
+
+    uint32_t objectCount = 0;
+    uint32_t indirectCount = 0;
+    uint32_t drawCount = 0;
+    uint32_t visibleCount = 0;
+    uint32_t disoccludedCount = 0;
+  };
+} // namespace cjh
@@ -23,8 +23,8 @@ namespace cjh
   };
 
   PointLightSystem::PointLightSystem(
-      CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-      : cjhDevice{device}
+      CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+      : cjhDevice{device}, pipelineManager{pipelineManager}
   {
     createPipelineLayout(globalSetLayout);
     createPipeline(renderPass);
@@ -32,6 +32,8 @@ namespace cjh
 
   PointLightSystem::~PointLightSystem()
   {
+    // waits for a compile that still uses the layout
+    pipelineManager.release(pipelineId);
     vkDestroyPipelineLayout(cjhDevice.device(), m_PipelineLayout, nullptr);
   }
 
@@ -61,18 +63,17 @@ namespace cjh
   {
     assert(m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
-    CjhPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    CjhPipeline::enableAlphaBlending(pipelineConfig);
-    pipelineConfig.attributeDescriptions.clear();
-    pipelineConfig.bindingDescriptions.clear();
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = m_PipelineLayout;
-    cjhPipeline = std::make_unique<CjhPipeline>(
-        cjhDevice,
+    auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+    CjhPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+    CjhPipeline::enableAlphaBlending(*pipelineConfig);
+    pipelineConfig->attributeDescriptions.clear();
+    pipelineConfig->bindingDescriptions.clear();
+    pipelineConfig->renderPass = renderPass;
+    pipelineConfig->pipelineLayout = m_PipelineLayout;
+    pipelineId = pipelineManager.request(
         "shaders/spv/point_light.vert.spv",
         "shaders/spv/point_light.frag.spv",
-        pipelineConfig);
+        std::move(pipelineConfig));
   }
 
   void PointLightSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo)
@@ -115,7 +116,13 @@ namespace cjh
       sorted[disSquared] = obj.getId();
     }
 
-    cjhPipeline->bind(frameInfo.commandBuffer);
+    CjhPipeline *pipeline = pipelineManager.get(pipelineId);
+    if (pipeline == nullptr)
+    {
+      // still compiling
+      return;
+    }
+    pipeline->bind(frameInfo.commandBuffer);
 
     vkCmdBindDescriptorSets(
         frameInfo.commandBuffer,
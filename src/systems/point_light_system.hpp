@@ -4,7 +4,7 @@
 #include "vk/cjh_device.hpp"
 #include "vk/cjh_frame_info.hpp"
 #include "vk/cjh_game_object.hpp"
-#include "vk/cjh_pipeline.hpp"
+#include "vk/cjh_pipeline_manager.hpp"
 
 // std
 #include <memory>
@@ -15,7 +15,7 @@ namespace cjh
   class PointLightSystem
   {
   public:
-    PointLightSystem(CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    PointLightSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
     ~PointLightSystem();
 
     PointLightSystem(const PointLightSystem &) = delete;
@@ -30,7 +30,8 @@ namespace cjh
 
     CjhDevice &cjhDevice;
 
-    std::unique_ptr<CjhPipeline> cjhPipeline;
+    CjhPipelineManager &pipelineManager;
+    CjhPipelineManager::Id pipelineId = CjhPipelineManager::NO_PIPELINE;
     VkPipelineLayout m_PipelineLayout;
   };
 } // namespace lve
@@ -14,14 +14,8 @@
 namespace cjh
 {
 
-  struct SimplePushConstantData
-  {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat4 normalMatrix{1.f};
-  };
-
-  SimpleRenderSystem::SimpleRenderSystem(CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-      : cjhDevice{device}
+  SimpleRenderSystem::SimpleRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+      : cjhDevice{device}, pipelineManager{pipelineManager}, instanceBuffer{device}
   {
     createPipelineLayout(globalSetLayout);
     createPipeline(renderPass);
@@ -29,24 +23,19 @@ namespace cjh
 
   SimpleRenderSystem::~SimpleRenderSystem()
   {
+    // waits for a compile that still uses the layout
+    pipelineManager.release(pipelineId);
     vkDestroyPipelineLayout(cjhDevice.device(), m_PipelineLayout, nullptr);
   }
 
   void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
   {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(SimplePushConstantData);
-
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     if (vkCreatePipelineLayout(cjhDevice.device(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) !=
         VK_SUCCESS)
     {
@@ -58,22 +47,41 @@ namespace cjh
   {
     assert(m_PipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
-    CjhPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = m_PipelineLayout;
-    cjhPipeline = std::make_unique<CjhPipeline>(
-        cjhDevice,
-        "shaders/spv/simple_shader.vert.spv",
+    auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+    CjhPipeline::defaultPipelineConfigInfo(*pipelineConfig);
+    CjhPipeline::enableInstancing(*pipelineConfig);
+    pipelineConfig->renderPass = renderPass;
+    pipelineConfig->pipelineLayout = m_PipelineLayout;
+    pipelineId = pipelineManager.request(
+        "shaders/spv/simple_shader_instanced.vert.spv",
         "shaders/spv/simple_shader.frag.spv",
-        pipelineConfig);
+        std::move(pipelineConfig));
   }
 
   void SimpleRenderSystem::renderGameObjects(
       FrameInfo &frameInfo)
   {
-    cjhPipeline->bind(frameInfo.commandBuffer);
+    drawCount = 0;
+    auto packets = frameInfo.renderQueue.range(static_cast<uint32_t>(CjhModel::RenderSystem::Simple));
+    CjhPipeline *pipeline = pipelineManager.get(pipelineId);
+    if (packets.empty() || pipeline == nullptr)
+    {
+      // nothing to draw or still compiling
+      return;
+    }
 
+    // one instance per packet, in queue order, so every run of one mesh is a contiguous range
+    CjhModel::Instance *instances = instanceBuffer.map(frameInfo.frameIndex, static_cast<uint32_t>(packets.size()));
+    for (const auto &packet : packets)
+    {
+      auto &obj = *packet.object;
+      instances->modelMatrix = obj.transform.mat4();
+      instances->normalMatrix = obj.transform.normalMatrix();
+      instances++;
+    }
+    instanceBuffer.flush(frameInfo.frameIndex);
+
+    pipeline->bind(frameInfo.commandBuffer);
     vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                             VK_PIPELINE_BIND_POINT_GRAPHICS,
                             m_PipelineLayout,
@@ -82,28 +90,32 @@ namespace cjh
                             &frameInfo.globalDescriptorSet,
                             0,
                             nullptr);
+    instanceBuffer.bind(frameInfo.commandBuffer, frameInfo.frameIndex);
 
-    for (auto &kv : frameInfo.gameObjects)
+    // packets are sorted by mesh, each run of one model is a single instanced draw; models living
+    // in the same geometry arena share their buffer bindings
+    CjhGeometryArena *boundArena = nullptr;
+    const auto *first = packets.begin();
+    while (first != packets.end())
     {
-      auto &obj = kv.second;
-      if (obj.model == nullptr)
-        continue;
-      if (obj.model->m_render_system == "Simple")
+      CjhModel *model = first->object->model.get();
+      const auto *last = first + 1;
+      while (last != packets.end() && last->object->model.get() == model)
       {
-        SimplePushConstantData push{};
-        push.modelMatrix = obj.transform.mat4();
-        push.normalMatrix = obj.transform.normalMatrix();
+        ++last;
+      }
 
-        vkCmdPushConstants(
-            frameInfo.commandBuffer,
-            m_PipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(SimplePushConstantData),
-            &push);
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
+      if (model->getGeometryArena() == nullptr || model->getGeometryArena() != boundArena)
+      {
+        model->bind(frameInfo.commandBuffer);
+        boundArena = model->getGeometryArena();
       }
+      model->draw(
+          frameInfo.commandBuffer,
+          static_cast<uint32_t>(last - first),
+          static_cast<uint32_t>(first - packets.begin()));
+      drawCount++;
+      first = last;
     }
   }
 
@@ -4,7 +4,8 @@
 #include "vk/cjh_device.hpp"
 #include "vk/cjh_frame_info.hpp"
 #include "vk/cjh_game_object.hpp"
-#include "vk/cjh_pipeline.hpp"
+#include "vk/cjh_instance_buffer.hpp"
+#include "vk/cjh_pipeline_manager.hpp"
 
 // std
 #include <memory>
@@ -15,13 +16,17 @@ namespace cjh
   class SimpleRenderSystem
   {
   public:
-    SimpleRenderSystem(CjhDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    SimpleRenderSystem(CjhDevice &device, CjhPipelineManager &pipelineManager, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem &) = delete;
     SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
     void renderGameObjects(FrameInfo &frameInfo);
+    // draw calls recorded by the last renderGameObjects()
+    uint32_t getDrawCount() const { return drawCount; }
+    // compatible with any instanced pipeline layout that starts with the global set
+    CjhPipelineManager::Id getPipelineId() const { return pipelineId; }
 
   private:
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
@@ -29,7 +34,10 @@ namespace cjh
 
     CjhDevice &cjhDevice;
 
-    std::unique_ptr<CjhPipeline> cjhPipeline;
+    CjhPipelineManager &pipelineManager;
+    CjhPipelineManager::Id pipelineId = CjhPipelineManager::NO_PIPELINE;
+    CjhInstanceBuffer instanceBuffer;
+    uint32_t drawCount = 0;
     VkPipelineLayout m_PipelineLayout;
   };
 } // namespace lve
@@ -0,0 +1,253 @@
+#include "cjh_asset_manager.hpp"
+
+#include "cjh_pak_format.hpp"
+#include "cjh_swap_chain.hpp"
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <filesystem>
+#include <stdexcept>
+
+namespace cjh
+{
+  CjhAssetManager::CjhAssetManager(CjhDevice &device, CjhGeometryArena *geometryArena, VkDeviceSize budget)
+      : cjhDevice{device}, geometryArena{geometryArena}, budget{budget} {}
+
+  CjhAssetManager::~CjhAssetManager() = default;
+
+  std::shared_ptr<CjhModel> CjhAssetManager::loadModel(const std::string &path, uint64_t contentHash)
+  {
+    std::vector<std::string> errors;
+    auto models = loadModels({{path, contentHash}}, &errors);
+    if (!models[0])
+    {
+      throw std::runtime_error(errors[0]);
+    }
+    return models[0];
+  }
+
+  std::vector<std::shared_ptr<CjhModel>> CjhAssetManager::loadModels(
+      const std::vector<ModelRequest> &requests, std::vector<std::string> *errors)
+  {
+    struct Miss
+    {
+      std::string key;
+      std::string path;
+      uint64_t contentHash;
+      std::vector<size_t> requests;
+      CjhModel::StagedData staged;
+      std::string error;
+    };
+
+    std::vector<std::shared_ptr<CjhModel>> models(requests.size());
+    std::vector<Miss> misses;
+    std::unordered_map<std::string, size_t> missByKey;
+    std::unordered_map<uint64_t, size_t> missByHash;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+      std::string key = canonicalPath(requests[i].path);
+      uint64_t contentHash = requests[i].contentHash;
+      if (Entry *entry = find(key, contentHash))
+      {
+        assetStats.hits++;
+        touch(*entry);
+        models[i] = entry->model;
+        continue;
+      }
+
+      auto byKey = missByKey.find(key);
+      auto byHash = contentHash != 0 ? missByHash.find(contentHash) : missByHash.end();
+      if (byKey != missByKey.end() || byHash != missByHash.end())
+      {
+        // a duplicate of a load in this batch
+        assetStats.hits++;
+        misses[byKey != missByKey.end() ? byKey->second : byHash->second].requests.push_back(i);
+        continue;
+      }
+      assetStats.misses++;
+      missByKey[key] = misses.size();
+      if (contentHash != 0)
+      {
+        missByHash[contentHash] = misses.size();
+      }
+      misses.push_back({key, requests[i].path, contentHash, {i}, {}, {}});
+    }
+
+    CjhThreadPool::shared().parallelFor(
+        static_cast<uint32_t>(misses.size()),
+        [&](uint32_t i)
+        {
+          try
+          {
+            misses[i].staged = CjhModel::stageFromFile(cjhDevice, misses[i].path);
+          }
+          catch (const std::exception &e)
+          {
+            misses[i].error = e.what();
+          }
+        });
+
+    if (errors)
+    {
+      errors->assign(requests.size(), {});
+    }
+    for (auto &miss : misses)
+    {
+      if (!miss.error.empty())
+      {
+        for (size_t request : miss.requests)
+        {
+          if (errors)
+          {
+            (*errors)[request] = miss.error;
+          }
+        }
+        continue;
+      }
+      auto model = std::make_shared<CjhModel>(cjhDevice, std::move(miss.staged), geometryArena);
+      insert(miss.key, miss.contentHash, model->getMemorySize()).model = model;
+      for (size_t request : miss.requests)
+      {
+        models[request] = model;
+      }
+    }
+    return models;
+  }
+
+  std::shared_ptr<CjhImage> CjhAssetManager::loadImage(const std::string &path)
+  {
+    std::string key = canonicalPath(path);
+    if (Entry *entry = find(key, 0))
+    {
+      if (!entry->image)
+      {
+        throw std::runtime_error("asset is not an image: " + path);
+      }
+      assetStats.hits++;
+      touch(*entry);
+      return entry->image;
+    }
+
+    assetStats.misses++;
+    auto image = std::make_shared<CjhImage>(cjhDevice, path);
+    insert(key, 0, image->memorySize()).image = image;
+    return image;
+  }
+
+  std::shared_ptr<CjhModel> CjhAssetManager::findModel(const std::string &path)
+  {
+    Entry *entry = find(canonicalPath(path), 0);
+    if (!entry || !entry->model)
+    {
+      assetStats.misses++;
+      return nullptr;
+    }
+    assetStats.hits++;
+    touch(*entry);
+    return entry->model;
+  }
+
+  void CjhAssetManager::addModel(const std::string &path, std::shared_ptr<CjhModel> model)
+  {
+    std::string key = canonicalPath(path);
+    if (find(key, 0))
+    {
+      return;
+    }
+    VkDeviceSize size = model->getMemorySize();
+    insert(key, 0, size).model = std::move(model);
+  }
+
+  void CjhAssetManager::beginFrame()
+  {
+    frameCounter++;
+    // frames recorded more than MAX_FRAMES_IN_FLIGHT frames ago have finished on the GPU
+    for (auto it = retired.begin(); it != retired.end();)
+    {
+      if (frameCounter - it->frame <= CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+      {
+        ++it;
+        continue;
+      }
+      it = retired.erase(it);
+    }
+    evict();
+  }
+
+  std::string CjhAssetManager::canonicalPath(const std::string &path)
+  {
+    std::filesystem::path filePath{path};
+    if (filePath.is_absolute())
+    {
+      std::error_code ec;
+      std::filesystem::path canonical = std::filesystem::weakly_canonical(filePath, ec);
+      return (ec ? filePath.lexically_normal() : canonical).generic_string();
+    }
+    return pak_format::normalizePath(filePath.lexically_normal().generic_string());
+  }
+
+  CjhAssetManager::Entry *CjhAssetManager::find(const std::string &key, uint64_t contentHash)
+  {
+    auto it = entries.find(key);
+    if (it == entries.end() && contentHash != 0)
+    {
+      auto byHash = keysByHash.find(contentHash);
+      if (byHash != keysByHash.end())
+      {
+        it = entries.find(byHash->second);
+      }
+    }
+    return it != entries.end() ? &it->second : nullptr;
+  }
+
+  CjhAssetManager::Entry &CjhAssetManager::insert(const std::string &key, uint64_t contentHash, VkDeviceSize size)
+  {
+    Entry &entry = entries[key];
+    entry.size = size;
+    entry.contentHash = contentHash;
+    lru.push_front(key);
+    entry.lruPosition = lru.begin();
+    if (contentHash != 0)
+    {
+      keysByHash[contentHash] = key;
+    }
+    assetStats.residentCount++;
+    assetStats.residentBytes += size;
+    return entry;
+  }
+
+  void CjhAssetManager::touch(Entry &entry)
+  {
+    lru.splice(lru.begin(), lru, entry.lruPosition);
+  }
+
+  void CjhAssetManager::evict()
+  {
+    auto it = lru.end();
+    while (assetStats.residentBytes > budget && it != lru.begin())
+    {
+      --it;
+      auto entryIt = entries.find(*it);
+      Entry &entry = entryIt->second;
+      // still referenced outside the manager
+      long users = entry.model ? entry.model.use_count() : entry.image.use_count();
+      if (users > 1)
+      {
+        continue;
+      }
+
+      auto byHash = keysByHash.find(entry.contentHash);
+      if (byHash != keysByHash.end() && byHash->second == *it)
+      {
+        keysByHash.erase(byHash);
+      }
+      assetStats.residentCount--;
+      assetStats.residentBytes -= entry.size;
+      assetStats.evictions++;
+      retired.push_back({std::move(entry.model), std::move(entry.image), frameCounter});
+      entries.erase(entryIt);
+      it = lru.erase(it);
+    }
+  }
+
+} // namespace cjh
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "cjh_device.hpp"
+#include "cjh_geometry_arena.hpp"
+#include "cjh_image.hpp"
+#include "cjh_model.hpp"
+
+// std
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cjh
+{
+  // Shared models and images. Assets are keyed by canonical path, and by content hash when the
+  // caller knows it, so every user of a file gets the same handle and a cached load returns right
+  // away. The manager holds a reference of its own; assets nobody else references stay cached
+  // until the resident GPU memory exceeds the budget, then they are evicted least recently used
+  // first and destroyed once no frame in flight can use them. Render thread only.
+  class CjhAssetManager
+  {
+  public:
+    static constexpr VkDeviceSize DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+    struct ModelRequest
+    {
+      std::string path;
+      uint64_t contentHash = 0; // 0 when unknown, see scene_format::contentHash
+    };
+
+    struct Stats
+    {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t evictions = 0;
+      uint32_t residentCount = 0;
+      VkDeviceSize residentBytes = 0;
+    };
+
+    // loaded models are placed in geometryArena when it is given and has room
+    CjhAssetManager(CjhDevice &device, CjhGeometryArena *geometryArena = nullptr, VkDeviceSize budget = DEFAULT_BUDGET);
+    ~CjhAssetManager();
+
+    CjhAssetManager(const CjhAssetManager &) = delete;
+    CjhAssetManager &operator=(const CjhAssetManager &) = delete;
+
+    // throws when the file cannot be loaded
+    std::shared_ptr<CjhModel> loadModel(const std::string &path, uint64_t contentHash = 0);
+    // Misses are parsed and staged in parallel on the shared pool, requests for the same asset
+    // load it once. Failed loads come back as nullptr, with the reason in errors when given.
+    std::vector<std::shared_ptr<CjhModel>> loadModels(
+        const std::vector<ModelRequest> &requests, std::vector<std::string> *errors = nullptr);
+    std::shared_ptr<CjhImage> loadImage(const std::string &path);
+    // cached model or nullptr, without loading anything
+    std::shared_ptr<CjhModel> findModel(const std::string &path);
+    // shares a model that was loaded elsewhere, e.g. by the background importer
+    void addModel(const std::string &path, std::shared_ptr<CjhModel> model);
+
+    void setBudget(VkDeviceSize bytes) { budget = bytes; }
+    VkDeviceSize getBudget() const { return budget; }
+    const Stats &stats() const { return assetStats; }
+
+    // call once per frame after the frame fence was waited on; evicts down to the budget
+    void beginFrame();
+
+  private:
+    struct Entry
+    {
+      std::shared_ptr<CjhModel> model;
+      std::shared_ptr<CjhImage> image;
+      VkDeviceSize size = 0;
+      uint64_t contentHash = 0;
+      std::list<std::string>::iterator lruPosition;
+    };
+
+    struct Retired
+    {
+      std::shared_ptr<CjhModel> model;
+      std::shared_ptr<CjhImage> image;
+      uint64_t frame;
+    };
+
+    // relative paths are VFS names, absolute ones are resolved on disk
+    static std::string canonicalPath(const std::string &path);
+
+    Entry *find(const std::string &key, uint64_t contentHash);
+    Entry &insert(const std::string &key, uint64_t contentHash, VkDeviceSize size);
+    void touch(Entry &entry);
+    void evict();
+
+    CjhDevice &cjhDevice;
+    CjhGeometryArena *geometryArena;
+    VkDeviceSize budget;
+    Stats assetStats{};
+
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<uint64_t, std::string> keysByHash;
+    std::list<std::string> lru; // most recently used first
+    std::vector<Retired> retired;
+    uint64_t frameCounter = 0;
+  };
+} // namespace cjh
@@ -0,0 +1,610 @@
+#include "cjh_async_io.hpp"
+
+// std
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CJH_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    // positional reads for the fallback path, with errno style error codes
+#ifdef _WIN32
+    using FileHandle = HANDLE;
+
+    FileHandle openFile(const std::string &filepath)
+    {
+      HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+      {
+        throw std::runtime_error("failed to open file: " + filepath);
+      }
+      return file;
+    }
+
+    void closeFile(FileHandle file)
+    {
+      CloseHandle(file);
+    }
+
+    int64_t readAt(FileHandle file, void *destination, uint64_t size, uint64_t offset, int &error)
+    {
+      OVERLAPPED overlapped{};
+      overlapped.Offset = static_cast<DWORD>(offset);
+      overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD bytesRead = 0;
+      if (!ReadFile(file, destination, static_cast<DWORD>(size), &bytesRead, &overlapped))
+      {
+        error = static_cast<int>(GetLastError());
+        return error == ERROR_HANDLE_EOF ? 0 : -1;
+      }
+      return bytesRead;
+    }
+#else
+    using FileHandle = int;
+
+    FileHandle openFile(const std::string &filepath)
+    {
+      int file = open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+      if (file < 0)
+      {
+        throw std::runtime_error("failed to open file: " + filepath);
+      }
+      return file;
+    }
+
+    void closeFile(FileHandle file)
+    {
+      close(file);
+    }
+
+    int64_t readAt(FileHandle file, void *destination, uint64_t size, uint64_t offset, int &error)
+    {
+      ssize_t result;
+      do
+      {
+        result = pread(file, destination, size, static_cast<off_t>(offset));
+      } while (result < 0 && errno == EINTR);
+      error = result < 0 ? errno : 0;
+      return result;
+    }
+#endif
+
+    // a few threads are enough to keep a drive busy, the parts themselves are large
+    constexpr uint32_t FALLBACK_THREAD_COUNT = 4;
+    // user data of the request that wakes the completion thread for shutdown
+    constexpr uint64_t STOP_REQUEST = 0;
+  } // namespace
+
+  struct CjhAsyncIo::Operation
+  {
+    FileHandle file;
+    Callback callback;
+    std::atomic<uint32_t> remainingParts{0};
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<int> error{0};
+  };
+
+  struct CjhAsyncIo::Part
+  {
+    std::shared_ptr<Operation> operation;
+    uint64_t offset;
+    uint64_t size;
+    uint8_t *destination;
+    uint64_t done = 0;
+#ifdef CJH_IO_URING
+    iovec target{};
+#endif
+  };
+
+#ifdef CJH_IO_URING
+  // The submission and completion queues shared with the kernel. Only the thread holding the
+  // CjhAsyncIo mutex writes submissions, only the completion thread consumes completions.
+  struct CjhAsyncIo::Ring
+  {
+    int fd = -1;
+    uint32_t entries = 0;
+    // submissions the kernel has not consumed yet
+    uint32_t unsubmitted = 0;
+
+    void *sqMapping = MAP_FAILED;
+    size_t sqMappingSize = 0;
+    void *cqMapping = MAP_FAILED;
+    size_t cqMappingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    io_uring_cqe *cqes;
+
+    ~Ring()
+    {
+      if (sqes != MAP_FAILED)
+      {
+        munmap(sqes, sqesSize);
+      }
+      if (cqMapping != MAP_FAILED && cqMapping != sqMapping)
+      {
+        munmap(cqMapping, cqMappingSize);
+      }
+      if (sqMapping != MAP_FAILED)
+      {
+        munmap(sqMapping, sqMappingSize);
+      }
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+    }
+
+    // nullptr when the kernel (or a seccomp policy) does not allow io_uring
+    static std::unique_ptr<Ring> create(uint32_t queueDepth)
+    {
+      io_uring_params params{};
+      int fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+      if (fd < 0)
+      {
+        return nullptr;
+      }
+      auto ring = std::make_unique<Ring>();
+      ring->fd = fd;
+      ring->entries = params.sq_entries;
+
+      ring->sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      ring->cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (singleMapping)
+      {
+        ring->sqMappingSize = ring->cqMappingSize = std::max(ring->sqMappingSize, ring->cqMappingSize);
+      }
+      ring->sqMapping = mmap(nullptr, ring->sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             fd, IORING_OFF_SQ_RING);
+      if (ring->sqMapping == MAP_FAILED)
+      {
+        return nullptr;
+      }
+      ring->cqMapping = singleMapping
+                            ? ring->sqMapping
+                            : mmap(nullptr, ring->cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                   fd, IORING_OFF_CQ_RING);
+      if (ring->cqMapping == MAP_FAILED)
+      {
+        return nullptr;
+      }
+      ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      ring->sqes = static_cast<io_uring_sqe *>(mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+      if (ring->sqes == MAP_FAILED)
+      {
+        return nullptr;
+      }
+
+      auto *sq = static_cast<uint8_t *>(ring->sqMapping);
+      ring->sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+      ring->sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+      ring->sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+      ring->sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+      auto *cq = static_cast<uint8_t *>(ring->cqMapping);
+      ring->cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+      ring->cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+      ring->cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+      ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+      return ring;
+    }
+
+    int enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    // nullptr when the submission queue is full
+    io_uring_sqe *nextSqe()
+    {
+      unsigned tail = *sqTail;
+      if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= entries)
+      {
+        return nullptr;
+      }
+      io_uring_sqe *sqe = &sqes[tail & *sqMask];
+      memset(sqe, 0, sizeof(*sqe));
+      sqArray[tail & *sqMask] = tail & *sqMask;
+      return sqe;
+    }
+
+    void commitSqe()
+    {
+      __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+      unsubmitted++;
+    }
+
+    void submit()
+    {
+      if (unsubmitted == 0)
+      {
+        return;
+      }
+      int submitted = enter(unsubmitted, 0, 0);
+      // on EAGAIN / EBUSY the entries stay queued and go out with the next submit
+      if (submitted > 0)
+      {
+        unsubmitted -= static_cast<uint32_t>(submitted);
+      }
+    }
+  };
+#else
+  struct CjhAsyncIo::Ring
+  {
+  };
+#endif
+
+  CjhAsyncIo::CjhAsyncIo(uint32_t queueDepth)
+  {
+#ifdef CJH_IO_URING
+    ring = Ring::create(queueDepth);
+    if (ring)
+    {
+      completionThread = std::thread{[this]()
+                                     { completionLoop(); }};
+      return;
+    }
+#endif
+    fallbackWorkers = std::make_unique<CjhThreadPool>(FALLBACK_THREAD_COUNT);
+  }
+
+  CjhAsyncIo::~CjhAsyncIo()
+  {
+    wait();
+#ifdef CJH_IO_URING
+    if (ring)
+    {
+      {
+        std::unique_lock<std::mutex> lock{mutex};
+        io_uring_sqe *sqe;
+        while ((sqe = ring->nextSqe()) == nullptr)
+        {
+          // only possible while old entries are still being consumed
+          lock.unlock();
+          std::this_thread::yield();
+          lock.lock();
+        }
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = STOP_REQUEST;
+        ring->commitSqe();
+        ring->submit();
+      }
+      completionThread.join();
+    }
+#endif
+  }
+
+  CjhAsyncIo &CjhAsyncIo::shared()
+  {
+    static CjhAsyncIo io{};
+    return io;
+  }
+
+  void CjhAsyncIo::read(
+      const std::string &filepath, uint64_t offset, uint64_t size, void *destination, Callback callback)
+  {
+    auto operation = std::make_shared<Operation>();
+    operation->file = openFile(filepath);
+    operation->callback = std::move(callback);
+
+    uint64_t partCount = std::max<uint64_t>(1, (size + PART_SIZE - 1) / PART_SIZE);
+    operation->remainingParts = static_cast<uint32_t>(partCount);
+    outstanding++;
+
+    std::lock_guard<std::mutex> lock{mutex};
+    for (uint64_t i = 0; i < partCount; i++)
+    {
+      auto part = std::make_unique<Part>();
+      part->operation = operation;
+      part->offset = offset + i * PART_SIZE;
+      part->size = std::min(PART_SIZE, size - i * PART_SIZE);
+      part->destination = static_cast<uint8_t *>(destination) + i * PART_SIZE;
+      queued.push_back(std::move(part));
+    }
+  }
+
+  void CjhAsyncIo::flush()
+  {
+    std::vector<std::unique_ptr<Part>> parts;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (ring)
+      {
+        for (auto &part : queued)
+        {
+          ready.push_back(std::move(part));
+        }
+        queued.clear();
+        submitReady();
+        return;
+      }
+      parts.swap(queued);
+    }
+
+    for (auto &part : parts)
+    {
+      Part *released = part.release();
+      fallbackWorkers->submit([this, released]()
+                              { readPart(std::unique_ptr<Part>(released)); });
+    }
+  }
+
+  void CjhAsyncIo::wait()
+  {
+    flush();
+    std::unique_lock<std::mutex> lock{mutex};
+    idle.wait(lock, [this]()
+              { return outstanding == 0; });
+  }
+
+  void CjhAsyncIo::registerBuffer(void *data, size_t size)
+  {
+    if (!ring)
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{mutex};
+    addedBuffers.push_back({static_cast<uint8_t *>(data), size});
+    registeredBuffersChanged = true;
+    if (partsInFlight == 0)
+    {
+      updateRegisteredBuffers();
+    }
+  }
+
+  void CjhAsyncIo::unregisterBuffer(void *data)
+  {
+    if (!ring)
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{mutex};
+    auto matches = [data](const RegisteredBuffer &buffer)
+    { return buffer.data == data; };
+    auto added = std::find_if(addedBuffers.begin(), addedBuffers.end(), matches);
+    if (added != addedBuffers.end())
+    {
+      addedBuffers.erase(added);
+      return;
+    }
+    auto it = std::find_if(registeredBuffers.begin(), registeredBuffers.end(), matches);
+    if (it != registeredBuffers.end())
+    {
+      // the memory may be mapped again at the same address, never read into it through the stale pages
+      *it = RegisteredBuffer{nullptr, 0};
+      registeredBuffersChanged = true;
+      if (partsInFlight == 0)
+      {
+        updateRegisteredBuffers();
+      }
+    }
+  }
+
+  void CjhAsyncIo::updateRegisteredBuffers()
+  {
+    registeredBuffers.erase(std::remove_if(registeredBuffers.begin(), registeredBuffers.end(), [](const RegisteredBuffer &buffer)
+                                           { return buffer.data == nullptr; }),
+                            registeredBuffers.end());
+    // one at a time, a buffer the kernel refuses to pin would fail the whole table
+    for (const auto &buffer : addedBuffers)
+    {
+      registeredBuffers.push_back(buffer);
+      if (!registerBufferTable())
+      {
+        registeredBuffers.pop_back();
+      }
+    }
+    if (!registerBufferTable())
+    {
+      registeredBuffers.clear();
+    }
+    addedBuffers.clear();
+    registeredBuffersChanged = false;
+  }
+
+  bool CjhAsyncIo::registerBufferTable()
+  {
+#ifdef CJH_IO_URING
+    // the kernel only replaces the whole table, and only while nothing uses it
+    syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    if (registeredBuffers.empty())
+    {
+      return true;
+    }
+    std::vector<iovec> buffers;
+    for (const auto &buffer : registeredBuffers)
+    {
+      buffers.push_back({buffer.data, buffer.size});
+    }
+    return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, buffers.data(),
+                   static_cast<unsigned>(buffers.size())) == 0;
+#else
+    return false;
+#endif
+  }
+
+  int CjhAsyncIo::registeredIndex(const uint8_t *data, uint64_t size) const
+  {
+    for (size_t i = 0; i < registeredBuffers.size(); i++)
+    {
+      const RegisteredBuffer &buffer = registeredBuffers[i];
+      if (buffer.data && data >= buffer.data && data + size <= buffer.data + buffer.size)
+      {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  void CjhAsyncIo::submitReady()
+  {
+#ifdef CJH_IO_URING
+    if (registeredBuffersChanged && partsInFlight == 0)
+    {
+      updateRegisteredBuffers();
+    }
+    // at most one ring of parts in flight, so the completion queue (twice as large) never overflows
+    while (!ready.empty() && partsInFlight < ring->entries)
+    {
+      io_uring_sqe *sqe = ring->nextSqe();
+      if (!sqe)
+      {
+        break;
+      }
+      Part *part = ready.front().release();
+      ready.pop_front();
+
+      uint8_t *target = part->destination + part->done;
+      uint64_t remaining = part->size - part->done;
+      int bufferIndex = registeredIndex(target, remaining);
+      sqe->fd = part->operation->file;
+      sqe->off = part->offset + part->done;
+      sqe->user_data = reinterpret_cast<uint64_t>(part);
+      if (bufferIndex >= 0)
+      {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = reinterpret_cast<uint64_t>(target);
+        sqe->len = static_cast<uint32_t>(remaining);
+        sqe->buf_index = static_cast<uint16_t>(bufferIndex);
+      }
+      else
+      {
+        part->target = {target, static_cast<size_t>(remaining)};
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = reinterpret_cast<uint64_t>(&part->target);
+        sqe->len = 1;
+      }
+      ring->commitSqe();
+      partsInFlight++;
+    }
+    ring->submit();
+#endif
+  }
+
+  void CjhAsyncIo::completionLoop()
+  {
+#ifdef CJH_IO_URING
+    bool stopRequested = false;
+    while (!stopRequested)
+    {
+      if (ring->enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+      {
+        std::cerr << "io_uring wait failed: " << strerror(errno) << '\n';
+      }
+
+      unsigned head = *ring->cqHead;
+      unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+      for (; head != tail; head++)
+      {
+        io_uring_cqe cqe = ring->cqes[head & *ring->cqMask];
+        __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+        if (cqe.user_data == STOP_REQUEST)
+        {
+          stopRequested = true;
+          continue;
+        }
+
+        auto *part = reinterpret_cast<Part *>(cqe.user_data);
+        {
+          std::lock_guard<std::mutex> lock{mutex};
+          partsInFlight--;
+        }
+        bool retry = cqe.res == -EINTR || cqe.res == -EAGAIN;
+        if (cqe.res > 0)
+        {
+          part->done += static_cast<uint64_t>(cqe.res);
+          // short read in the middle of the file, ask for the rest
+          retry = part->done < part->size;
+        }
+        if (retry)
+        {
+          std::lock_guard<std::mutex> lock{mutex};
+          ready.emplace_front(part);
+          continue;
+        }
+        completePart(part, cqe.res < 0 ? -cqe.res : 0);
+      }
+
+      std::lock_guard<std::mutex> lock{mutex};
+      submitReady();
+    }
+#endif
+  }
+
+  void CjhAsyncIo::readPart(std::unique_ptr<Part> part)
+  {
+    int error = 0;
+    while (part->done < part->size)
+    {
+      int64_t result = readAt(part->operation->file, part->destination + part->done, part->size - part->done,
+                              part->offset + part->done, error);
+      if (result <= 0)
+      {
+        break;
+      }
+      part->done += static_cast<uint64_t>(result);
+    }
+    completePart(part.release(), error);
+  }
+
+  void CjhAsyncIo::completePart(Part *part, int error)
+  {
+    std::unique_ptr<Part> owned{part};
+    Operation &operation = *part->operation;
+    int noError = 0;
+    if (error != 0)
+    {
+      operation.error.compare_exchange_strong(noError, error);
+    }
+    operation.bytesRead += part->done;
+    if (--operation.remainingParts > 0)
+    {
+      return;
+    }
+
+    closeFile(operation.file);
+    Result result{operation.bytesRead, operation.error};
+    try
+    {
+      operation.callback(result);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "async read callback failed: " << e.what() << '\n';
+    }
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      outstanding--;
+    }
+    idle.notify_all();
+  }
+
+} // namespace cjh
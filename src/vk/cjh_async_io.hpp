@@ -0,0 +1,98 @@
+#pragma once
+
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cjh
+{
+  // Asynchronous file reads for asset streaming. Reads are queued with read() and go out together
+  // with the next flush(), large reads are split into parts so the drive sees many requests at
+  // once. On Linux they are submitted to an io_uring with one system call per batch, and reads
+  // into a registered buffer (e.g. persistently mapped staging memory) skip the per read page
+  // pinning. Elsewhere, or when io_uring is not available, the parts are positional reads on a
+  // few I/O threads. Callbacks run on an I/O thread and must not block. Thread safe.
+  class CjhAsyncIo
+  {
+  public:
+    static constexpr uint32_t DEFAULT_QUEUE_DEPTH = 128;
+    static constexpr uint64_t PART_SIZE = 1024 * 1024;
+
+    struct Result
+    {
+      uint64_t bytesRead = 0; // less than requested when the file ended early
+      int error = 0;          // errno (GetLastError on Windows) of the first failed part
+    };
+    using Callback = std::function<void(const Result &)>;
+
+    explicit CjhAsyncIo(uint32_t queueDepth = DEFAULT_QUEUE_DEPTH);
+    // waits for every flushed read
+    ~CjhAsyncIo();
+
+    CjhAsyncIo(const CjhAsyncIo &) = delete;
+    CjhAsyncIo &operator=(const CjhAsyncIo &) = delete;
+
+    static CjhAsyncIo &shared();
+
+    // Queues a read of size bytes at offset into destination, which has to stay valid until the
+    // callback ran. Throws if the file cannot be opened.
+    void read(const std::string &filepath, uint64_t offset, uint64_t size, void *destination, Callback callback);
+    // submits everything queued since the last flush
+    void flush();
+    // flushes and blocks until every read finished and its callback returned
+    void wait();
+
+    // Registers long lived memory that reads will target. Best effort: memory the kernel cannot pin
+    // (some device mappings) is read into like any other. Neither call blocks, so both are safe on
+    // an I/O thread; the kernel's table follows once no read is in flight.
+    void registerBuffer(void *data, size_t size);
+    void unregisterBuffer(void *data);
+
+    bool usesIoUring() const { return ring != nullptr; }
+    uint32_t pendingCount() const { return outstanding; }
+
+  private:
+    struct Ring;
+    struct Operation;
+    struct Part;
+
+    struct RegisteredBuffer
+    {
+      uint8_t *data;
+      size_t size;
+    };
+
+    int registeredIndex(const uint8_t *data, uint64_t size) const;
+    void submitReady();
+    void completionLoop();
+    void readPart(std::unique_ptr<Part> part);
+    void completePart(Part *part, int error);
+    void updateRegisteredBuffers();
+    bool registerBufferTable();
+
+    std::unique_ptr<Ring> ring;
+    std::unique_ptr<CjhThreadPool> fallbackWorkers;
+    std::thread completionThread;
+
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    std::vector<std::unique_ptr<Part>> queued;
+    std::deque<std::unique_ptr<Part>> ready; // flushed, waiting for room in the ring
+    std::vector<RegisteredBuffer> registeredBuffers; // the kernel's table, unregistered entries are null
+    std::vector<RegisteredBuffer> addedBuffers;      // waiting for the next table update
+    bool registeredBuffersChanged = false;
+    uint32_t partsInFlight = 0;
+    std::atomic<uint32_t> outstanding{0};
+  };
+} // namespace cjh
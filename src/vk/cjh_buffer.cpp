@@ -47,19 +47,21 @@ namespace cjh
     {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
     }
 
     CjhBuffer::~CjhBuffer()
     {
         unmap();
         vkDestroyBuffer(cjhDevice.device(), buffer, nullptr);
-        vkFreeMemory(cjhDevice.device(), memory, nullptr);
+        cjhDevice.allocator().free(allocation);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory blocks stay mapped by the allocator, so this only points into them
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -68,23 +70,24 @@ namespace cjh
      */
     VkResult CjhBuffer::map(VkDeviceSize size, VkDeviceSize offset)
     {
-        assert(buffer && memory && "Called map on buffer before create");
+        assert(buffer && allocation.memory && "Called map on buffer before create");
 
-        return vkMapMemory(cjhDevice.device(), memory, offset, size, 0, &mapped);
+        if (!allocation.mappedData)
+        {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char *>(allocation.mappedData) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The underlying memory block stays mapped until the allocator releases it
      */
     void CjhBuffer::unmap()
     {
-        if (mapped)
-        {
-            vkUnmapMemory(cjhDevice.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -125,12 +128,7 @@ namespace cjh
      */
     VkResult CjhBuffer::flush(VkDeviceSize size, VkDeviceSize offset)
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(cjhDevice.device(), 1, &mappedRange);
+        return cjhDevice.allocator().flush(allocation, size, offset);
     }
 
     /**
@@ -146,12 +144,7 @@ namespace cjh
      */
     VkResult CjhBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
     {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(cjhDevice.device(), 1, &mappedRange);
+        return cjhDevice.allocator().invalidate(allocation, size, offset);
     }
 
     /**
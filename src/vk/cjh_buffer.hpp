@@ -48,7 +48,7 @@ namespace cjh
 		CjhDevice &cjhDevice;
 		void *mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		CjhAllocation allocation;
 
 		VkDeviceSize bufferSize;
 		uint32_t instanceCount;
@@ -0,0 +1,781 @@
+#include "cjh_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJH_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    constexpr uint32_t SAH_BINS = 12;
+    // leaves are enlarged so small movements stay inside them and cost nothing
+    constexpr float FAT_FACTOR = 0.1f;
+    constexpr float MIN_FAT_MARGIN = 0.01f;
+
+    CjhAabb fatten(const CjhAabb &box)
+    {
+      glm::vec3 margin = glm::max((box.max - box.min) * FAT_FACTOR, glm::vec3(MIN_FAT_MARGIN));
+      return {box.min - margin, box.max + margin};
+    }
+
+    // four lanes of the wide node tests, SSE when available
+#if CJH_BVH_SSE
+    using Lanes = __m128;
+    inline Lanes load(const float *p) { return _mm_load_ps(p); }
+    inline Lanes splat(float v) { return _mm_set1_ps(v); }
+    inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+    inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+    inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+    inline Lanes lanesMin(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+    inline Lanes lanesMax(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+    inline uint32_t lessMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(a, b))); }
+    inline uint32_t lessEqualMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+    inline void store(float *p, Lanes a) { _mm_storeu_ps(p, a); }
+#else
+    struct Lanes
+    {
+      float v[4];
+    };
+    template <typename Op>
+    inline Lanes apply(const Lanes &a, const Lanes &b, Op op)
+    {
+      return {{op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3])}};
+    }
+    inline Lanes load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+    inline Lanes splat(float v) { return {{v, v, v, v}}; }
+    inline Lanes add(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+    inline Lanes sub(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+    inline Lanes mul(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+    inline Lanes lanesMin(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline Lanes lanesMax(Lanes a, Lanes b) { return apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline uint32_t lessMask(Lanes a, Lanes b)
+    {
+      uint32_t mask = 0;
+      for (uint32_t lane = 0; lane < 4; lane++)
+        mask |= (a.v[lane] < b.v[lane] ? 1u : 0u) << lane;
+      return mask;
+    }
+    inline uint32_t lessEqualMask(Lanes a, Lanes b)
+    {
+      uint32_t mask = 0;
+      for (uint32_t lane = 0; lane < 4; lane++)
+        mask |= (a.v[lane] <= b.v[lane] ? 1u : 0u) << lane;
+      return mask;
+    }
+    inline void store(float *p, Lanes a) { std::copy(a.v, a.v + 4, p); }
+#endif
+  } // namespace
+
+  std::vector<int32_t> CjhBvh::build(const std::vector<std::pair<CjhAabb, uint32_t>> &items)
+  {
+    clear();
+    std::vector<int32_t> proxies;
+    proxies.reserve(items.size());
+    nodes.reserve(2 * items.size());
+    for (const auto &item : items)
+    {
+      int32_t leaf = allocateNode();
+      nodes[leaf].box = fatten(item.first);
+      nodes[leaf].id = item.second;
+      proxies.push_back(leaf);
+    }
+    bvhStats.proxyCount = static_cast<uint32_t>(items.size());
+    if (!proxies.empty())
+    {
+      std::vector<int32_t> leaves = proxies;
+      root = buildRange(leaves, 0, leaves.size());
+      nodes[root].parent = NONE;
+    }
+    return proxies;
+  }
+
+  void CjhBvh::clear()
+  {
+    nodes.clear();
+    wideNodes.clear();
+    root = NONE;
+    freeList = NONE;
+    wideDirty = true;
+    bvhStats.proxyCount = 0;
+  }
+
+  int32_t CjhBvh::createProxy(const CjhAabb &box, uint32_t id)
+  {
+    int32_t leaf = allocateNode();
+    nodes[leaf].box = fatten(box);
+    nodes[leaf].id = id;
+    insertLeaf(leaf);
+    bvhStats.proxyCount++;
+    return leaf;
+  }
+
+  void CjhBvh::destroyProxy(int32_t proxy)
+  {
+    assert(nodes[proxy].isLeaf() && "not a proxy");
+    removeLeaf(proxy);
+    freeNode(proxy);
+    bvhStats.proxyCount--;
+  }
+
+  bool CjhBvh::moveProxy(int32_t proxy, const CjhAabb &box)
+  {
+    if (nodes[proxy].box.contains(box))
+    {
+      return false;
+    }
+    // refit instead of reinserting, the rotations on the way up repair what the move did
+    nodes[proxy].box = fatten(box);
+    updateWideSlot(proxy);
+    refitUpwards(nodes[proxy].parent);
+    bvhStats.refits++;
+    return true;
+  }
+
+  int32_t CjhBvh::allocateNode()
+  {
+    int32_t index;
+    if (freeList != NONE)
+    {
+      index = freeList;
+      freeList = nodes[index].parent;
+      nodes[index] = Node{};
+    }
+    else
+    {
+      index = static_cast<int32_t>(nodes.size());
+      nodes.emplace_back();
+    }
+    return index;
+  }
+
+  void CjhBvh::freeNode(int32_t index)
+  {
+    nodes[index].height = -1;
+    nodes[index].parent = freeList;
+    freeList = index;
+  }
+
+  // binned SAH over the leaf centroids, a median split where the bins cannot separate them
+  int32_t CjhBvh::buildRange(std::vector<int32_t> &leaves, size_t first, size_t last)
+  {
+    size_t count = last - first;
+    if (count == 1)
+    {
+      return leaves[first];
+    }
+
+    auto centroid = [this](int32_t leaf)
+    { return (nodes[leaf].box.min + nodes[leaf].box.max) * 0.5f; };
+    glm::vec3 centroidMin = centroid(leaves[first]);
+    glm::vec3 centroidMax = centroidMin;
+    for (size_t i = first + 1; i < last; i++)
+    {
+      glm::vec3 c = centroid(leaves[i]);
+      centroidMin = glm::min(centroidMin, c);
+      centroidMax = glm::max(centroidMax, c);
+    }
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    glm::vec3 extent = centroidMax - centroidMin;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      if (extent[axis] <= 1e-6f)
+      {
+        continue;
+      }
+      CjhAabb binBoxes[SAH_BINS];
+      uint32_t binCounts[SAH_BINS] = {};
+      float scale = SAH_BINS / extent[axis];
+      for (size_t i = first; i < last; i++)
+      {
+        uint32_t bin = std::min(
+            SAH_BINS - 1, static_cast<uint32_t>((centroid(leaves[i])[axis] - centroidMin[axis]) * scale));
+        binBoxes[bin] = binCounts[bin] == 0 ? nodes[leaves[i]].box : CjhAabb::merge(binBoxes[bin], nodes[leaves[i]].box);
+        binCounts[bin]++;
+      }
+
+      // areas of everything right of each split, then sweep from the left
+      float rightAreas[SAH_BINS] = {};
+      uint32_t rightCounts[SAH_BINS] = {};
+      CjhAabb rightBox{};
+      uint32_t rightCount = 0;
+      for (uint32_t bin = SAH_BINS - 1; bin > 0; bin--)
+      {
+        if (binCounts[bin] > 0)
+        {
+          rightBox = rightCount == 0 ? binBoxes[bin] : CjhAabb::merge(rightBox, binBoxes[bin]);
+          rightCount += binCounts[bin];
+        }
+        rightAreas[bin] = rightCount > 0 ? rightBox.surfaceArea() : 0.f;
+        rightCounts[bin] = rightCount;
+      }
+      CjhAabb leftBox{};
+      uint32_t leftCount = 0;
+      for (uint32_t split = 1; split < SAH_BINS; split++)
+      {
+        if (binCounts[split - 1] > 0)
+        {
+          leftBox = leftCount == 0 ? binBoxes[split - 1] : CjhAabb::merge(leftBox, binBoxes[split - 1]);
+          leftCount += binCounts[split - 1];
+        }
+        if (leftCount == 0 || rightCounts[split] == 0)
+        {
+          continue;
+        }
+        float cost = leftCount * leftBox.surfaceArea() + rightCounts[split] * rightAreas[split];
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestAxis = axis;
+          bestSplit = split;
+        }
+      }
+    }
+
+    size_t middle = first + count / 2;
+    if (bestAxis >= 0)
+    {
+      float scale = SAH_BINS / extent[bestAxis];
+      auto split = std::partition(
+          leaves.begin() + first, leaves.begin() + last, [&](int32_t leaf)
+          { return static_cast<uint32_t>((centroid(leaf)[bestAxis] - centroidMin[bestAxis]) * scale) < bestSplit; });
+      middle = static_cast<size_t>(split - leaves.begin());
+    }
+
+    int32_t left = buildRange(leaves, first, middle);
+    int32_t right = buildRange(leaves, middle, last);
+    int32_t index = allocateNode();
+    Node &node = nodes[index];
+    node.child[0] = left;
+    node.child[1] = right;
+    node.box = CjhAabb::merge(nodes[left].box, nodes[right].box);
+    node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+    nodes[left].parent = index;
+    nodes[right].parent = index;
+    return index;
+  }
+
+  void CjhBvh::insertLeaf(int32_t leaf)
+  {
+    wideDirty = true;
+    if (root == NONE)
+    {
+      root = leaf;
+      nodes[root].parent = NONE;
+      return;
+    }
+
+    // walk down to the sibling that grows the total area the least
+    CjhAabb leafBox = nodes[leaf].box;
+    int32_t index = root;
+    while (!nodes[index].isLeaf())
+    {
+      const Node &node = nodes[index];
+      float area = node.box.surfaceArea();
+      float combinedArea = CjhAabb::merge(node.box, leafBox).surfaceArea();
+      // pairing with this node, or the growth every level below has to pay for anyway
+      float cost = 2.f * combinedArea;
+      float inheritanceCost = 2.f * (combinedArea - area);
+
+      float childCosts[2];
+      for (int c = 0; c < 2; c++)
+      {
+        const Node &child = nodes[node.child[c]];
+        float grown = CjhAabb::merge(leafBox, child.box).surfaceArea();
+        childCosts[c] = (child.isLeaf() ? grown : grown - child.box.surfaceArea()) + inheritanceCost;
+      }
+      if (cost < childCosts[0] && cost < childCosts[1])
+      {
+        break;
+      }
+      index = childCosts[0] < childCosts[1] ? node.child[0] : node.child[1];
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = CjhAabb::merge(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child[0] = sibling;
+    nodes[newParent].child[1] = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == NONE)
+    {
+      root = newParent;
+    }
+    else
+    {
+      Node &parent = nodes[oldParent];
+      parent.child[parent.child[0] == sibling ? 0 : 1] = newParent;
+    }
+    refitUpwards(oldParent);
+  }
+
+  void CjhBvh::removeLeaf(int32_t leaf)
+  {
+    wideDirty = true;
+    if (leaf == root)
+    {
+      root = NONE;
+      return;
+    }
+
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child[0] == leaf ? nodes[parent].child[1] : nodes[parent].child[0];
+    freeNode(parent);
+    nodes[sibling].parent = grandParent;
+    if (grandParent == NONE)
+    {
+      root = sibling;
+      return;
+    }
+    Node &node = nodes[grandParent];
+    node.child[node.child[0] == parent ? 0 : 1] = sibling;
+    refitUpwards(grandParent);
+  }
+
+  void CjhBvh::refitUpwards(int32_t index)
+  {
+    while (index != NONE)
+    {
+      rotate(index);
+      Node &node = nodes[index];
+      const Node &left = nodes[node.child[0]];
+      const Node &right = nodes[node.child[1]];
+      node.box = CjhAabb::merge(left.box, right.box);
+      node.height = 1 + std::max(left.height, right.height);
+      updateWideSlot(index);
+      index = node.parent;
+    }
+  }
+
+  // Kopta et al. style: of the four swaps of a child with a grandchild on the other side, take the
+  // one that shrinks the swapped in node the most; the node's own box stays the same
+  bool CjhBvh::rotate(int32_t index)
+  {
+    int32_t children[2] = {nodes[index].child[0], nodes[index].child[1]};
+    float bestGain = 0.f;
+    int bestSide = -1; // the child whose children are swapped with its sibling
+    int bestGrandChild = -1;
+    for (int side = 0; side < 2; side++)
+    {
+      const Node &node = nodes[children[side]];
+      if (node.isLeaf())
+      {
+        continue;
+      }
+      const CjhAabb &sibling = nodes[children[1 - side]].box;
+      float area = node.box.surfaceArea();
+      for (int g = 0; g < 2; g++)
+      {
+        // the sibling takes grandchild g's place, next to grandchild 1 - g
+        float gain = area - CjhAabb::merge(sibling, nodes[node.child[1 - g]].box).surfaceArea();
+        if (gain > bestGain)
+        {
+          bestGain = gain;
+          bestSide = side;
+          bestGrandChild = g;
+        }
+      }
+    }
+    // ignore rounding noise, it would only make the tree flip back and forth
+    if (bestSide < 0 || bestGain <= 1e-6f * nodes[index].box.surfaceArea())
+    {
+      return false;
+    }
+
+    int32_t lower = children[bestSide];
+    int32_t raised = nodes[lower].child[bestGrandChild];
+    int32_t lowered = children[1 - bestSide];
+    nodes[index].child[1 - bestSide] = raised;
+    nodes[raised].parent = index;
+    nodes[lower].child[bestGrandChild] = lowered;
+    nodes[lowered].parent = lower;
+
+    Node &node = nodes[lower];
+    node.box = CjhAabb::merge(nodes[node.child[0]].box, nodes[node.child[1]].box);
+    node.height = 1 + std::max(nodes[node.child[0]].height, nodes[node.child[1]].height);
+    wideDirty = true;
+    bvhStats.rotations++;
+    return true;
+  }
+
+  void CjhBvh::updateWideSlot(int32_t index)
+  {
+    int32_t slot = nodes[index].wideSlot;
+    if (wideDirty || slot == NONE)
+    {
+      return;
+    }
+    WideNode &wide = wideNodes[slot / 4];
+    setLane(wide, slot % 4, nodes[index].box, wide.child[slot % 4]);
+  }
+
+  bool CjhBvh::prepareQuery()
+  {
+    if (root == NONE)
+    {
+      return false;
+    }
+    bvhStats.height = static_cast<uint32_t>(nodes[root].height);
+    if (!wideDirty)
+    {
+      return true;
+    }
+    for (auto &node : nodes)
+    {
+      node.wideSlot = NONE;
+    }
+    wideNodes.clear();
+    collapse(root);
+    wideDirty = false;
+    bvhStats.wideNodeCount = static_cast<uint32_t>(wideNodes.size());
+    bvhStats.collapses++;
+    return true;
+  }
+
+  // opens the largest interior nodes below index until there are four children
+  int32_t CjhBvh::collapse(int32_t index)
+  {
+    int32_t wideIndex = static_cast<int32_t>(wideNodes.size());
+    wideNodes.emplace_back();
+
+    int32_t entries[4];
+    int count = 0;
+    if (nodes[index].isLeaf())
+    {
+      entries[count++] = index;
+    }
+    else
+    {
+      entries[count++] = nodes[index].child[0];
+      entries[count++] = nodes[index].child[1];
+    }
+    while (count < 4)
+    {
+      int largest = -1;
+      float largestArea = -1.f;
+      for (int i = 0; i < count; i++)
+      {
+        const Node &entry = nodes[entries[i]];
+        if (!entry.isLeaf() && entry.box.surfaceArea() > largestArea)
+        {
+          largest = i;
+          largestArea = entry.box.surfaceArea();
+        }
+      }
+      if (largest < 0)
+      {
+        break;
+      }
+      int32_t opened = entries[largest];
+      entries[largest] = nodes[opened].child[0];
+      entries[count++] = nodes[opened].child[1];
+    }
+
+    for (int lane = 0; lane < 4; lane++)
+    {
+      if (lane >= count)
+      {
+        setLane(wideNodes[wideIndex], lane, {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)}, EMPTY_LANE);
+        continue;
+      }
+      int32_t entry = entries[lane];
+      // collapsing grows wideNodes, index it only afterwards
+      int32_t child = nodes[entry].isLeaf() ? ~entry : collapse(entry);
+      setLane(wideNodes[wideIndex], lane, nodes[entry].box, child);
+      nodes[entry].wideSlot = wideIndex * 4 + lane;
+    }
+    return wideIndex;
+  }
+
+  void CjhBvh::setLane(WideNode &node, int lane, const CjhAabb &box, int32_t child)
+  {
+    node.minX[lane] = box.min.x;
+    node.minY[lane] = box.min.y;
+    node.minZ[lane] = box.min.z;
+    node.maxX[lane] = box.max.x;
+    node.maxY[lane] = box.max.y;
+    node.maxZ[lane] = box.max.z;
+    node.child[lane] = child;
+  }
+
+  void CjhBvh::collectAll(int32_t wideNode, std::vector<uint32_t> &ids) const
+  {
+    const WideNode &node = wideNodes[wideNode];
+    for (int lane = 0; lane < 4; lane++)
+    {
+      int32_t child = node.child[lane];
+      if (child == EMPTY_LANE)
+      {
+        continue;
+      }
+      if (child < 0)
+      {
+        ids.push_back(nodes[~child].id);
+      }
+      else
+      {
+        collectAll(child, ids);
+      }
+    }
+  }
+
+  void CjhBvh::queryFrustum(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &ids)
+  {
+    ids.clear();
+    if (!prepareQuery())
+    {
+      return;
+    }
+
+    const Lanes zero = splat(0.f);
+    stack.clear();
+    stack.push_back({0, 0.f});
+    while (!stack.empty())
+    {
+      const WideNode &node = wideNodes[stack.back().wideNode];
+      stack.pop_back();
+
+      // the corner farthest along a plane's normal decides whether a box is outside of it, the
+      // nearest one whether it is entirely inside
+      uint32_t outside = 0;
+      uint32_t crossing = 0;
+      for (const auto &plane : planes)
+      {
+        Lanes farX = load(plane.x > 0.f ? node.maxX : node.minX);
+        Lanes farY = load(plane.y > 0.f ? node.maxY : node.minY);
+        Lanes farZ = load(plane.z > 0.f ? node.maxZ : node.minZ);
+        Lanes nearX = load(plane.x > 0.f ? node.minX : node.maxX);
+        Lanes nearY = load(plane.y > 0.f ? node.minY : node.maxY);
+        Lanes nearZ = load(plane.z > 0.f ? node.minZ : node.maxZ);
+        Lanes nx = splat(plane.x), ny = splat(plane.y), nz = splat(plane.z), w = splat(plane.w);
+        Lanes farDistance = add(add(mul(nx, farX), mul(ny, farY)), add(mul(nz, farZ), w));
+        Lanes nearDistance = add(add(mul(nx, nearX), mul(ny, nearY)), add(mul(nz, nearZ), w));
+        outside |= lessMask(farDistance, zero);
+        crossing |= lessMask(nearDistance, zero);
+      }
+
+      for (int lane = 0; lane < 4; lane++)
+      {
+        int32_t child = node.child[lane];
+        if (child == EMPTY_LANE || (outside & (1u << lane)))
+        {
+          continue;
+        }
+        if (child < 0)
+        {
+          ids.push_back(nodes[~child].id);
+        }
+        else if ((crossing & (1u << lane)) == 0)
+        {
+          collectAll(child, ids);
+        }
+        else
+        {
+          stack.push_back({child, 0.f});
+        }
+      }
+    }
+  }
+
+  void CjhBvh::querySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &ids)
+  {
+    ids.clear();
+    if (!prepareQuery())
+    {
+      return;
+    }
+
+    const Lanes zero = splat(0.f);
+    const Lanes cx = splat(center.x), cy = splat(center.y), cz = splat(center.z);
+    const Lanes radiusSquared = splat(radius * radius);
+    stack.clear();
+    stack.push_back({0, 0.f});
+    while (!stack.empty())
+    {
+      const WideNode &node = wideNodes[stack.back().wideNode];
+      stack.pop_back();
+
+      // distance from the center to the closest point of each box
+      Lanes dx = add(lanesMax(sub(load(node.minX), cx), zero), lanesMax(sub(cx, load(node.maxX)), zero));
+      Lanes dy = add(lanesMax(sub(load(node.minY), cy), zero), lanesMax(sub(cy, load(node.maxY)), zero));
+      Lanes dz = add(lanesMax(sub(load(node.minZ), cz), zero), lanesMax(sub(cz, load(node.maxZ)), zero));
+      uint32_t overlap = lessEqualMask(add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz)), radiusSquared);
+
+      for (int lane = 0; lane < 4; lane++)
+      {
+        int32_t child = node.child[lane];
+        if (child == EMPTY_LANE || (overlap & (1u << lane)) == 0)
+        {
+          continue;
+        }
+        if (child < 0)
+        {
+          ids.push_back(nodes[~child].id);
+        }
+        else
+        {
+          stack.push_back({child, 0.f});
+        }
+      }
+    }
+  }
+
+  bool CjhBvh::raycast(
+      const glm::vec3 &origin,
+      const glm::vec3 &direction,
+      float maxDistance,
+      RayHit &hit,
+      const std::function<float(uint32_t id)> &hitTest)
+  {
+    if (!prepareQuery())
+    {
+      return false;
+    }
+
+    const Lanes ox = splat(origin.x), oy = splat(origin.y), oz = splat(origin.z);
+    // a zero component gives infinities, which the slab test handles
+    const Lanes ix = splat(1.f / direction.x), iy = splat(1.f / direction.y), iz = splat(1.f / direction.z);
+    const Lanes zero = splat(0.f);
+    float best = maxDistance;
+    bool found = false;
+
+    stack.clear();
+    stack.push_back({0, 0.f});
+    while (!stack.empty())
+    {
+      StackEntry entry = stack.back();
+      stack.pop_back();
+      if (entry.distance > best)
+      {
+        continue;
+      }
+      const WideNode &node = wideNodes[entry.wideNode];
+
+      Lanes tx1 = mul(sub(load(node.minX), ox), ix), tx2 = mul(sub(load(node.maxX), ox), ix);
+      Lanes ty1 = mul(sub(load(node.minY), oy), iy), ty2 = mul(sub(load(node.maxY), oy), iy);
+      Lanes tz1 = mul(sub(load(node.minZ), oz), iz), tz2 = mul(sub(load(node.maxZ), oz), iz);
+      Lanes tEnter = lanesMax(lanesMax(lanesMin(tx1, tx2), lanesMin(ty1, ty2)), lanesMax(lanesMin(tz1, tz2), zero));
+      Lanes tExit = lanesMin(lanesMin(lanesMax(tx1, tx2), lanesMax(ty1, ty2)), lanesMin(lanesMax(tz1, tz2), splat(best)));
+      uint32_t hits = lessEqualMask(tEnter, tExit);
+      float enter[4];
+      store(enter, tEnter);
+
+      // children are pushed far to near so the nearest one is visited first
+      int order[4];
+      int orderCount = 0;
+      for (int lane = 0; lane < 4; lane++)
+      {
+        int32_t child = node.child[lane];
+        if (child == EMPTY_LANE || (hits & (1u << lane)) == 0)
+        {
+          continue;
+        }
+        if (child < 0)
+        {
+          float distance = hitTest ? hitTest(nodes[~child].id) : enter[lane];
+          if (distance >= 0.f && distance <= best)
+          {
+            best = distance;
+            hit = {nodes[~child].id, distance};
+            found = true;
+          }
+          continue;
+        }
+        int position = orderCount++;
+        while (position > 0 && enter[order[position - 1]] < enter[lane])
+        {
+          order[position] = order[position - 1];
+          position--;
+        }
+        order[position] = lane;
+      }
+      for (int i = 0; i < orderCount; i++)
+      {
+        stack.push_back({node.child[order[i]], enter[order[i]]});
+      }
+    }
+    return found;
+  }
+
+  bool CjhBvh::nearest(const glm::vec3 &point, float maxDistance, uint32_t &id, float &distance)
+  {
+    if (!prepareQuery())
+    {
+      return false;
+    }
+
+    const Lanes zero = splat(0.f);
+    const Lanes px = splat(point.x), py = splat(point.y), pz = splat(point.z);
+    float best = maxDistance * maxDistance;
+    bool found = false;
+
+    stack.clear();
+    stack.push_back({0, 0.f});
+    while (!stack.empty())
+    {
+      StackEntry entry = stack.back();
+      stack.pop_back();
+      if (entry.distance > best)
+      {
+        continue;
+      }
+      const WideNode &node = wideNodes[entry.wideNode];
+
+      Lanes dx = add(lanesMax(sub(load(node.minX), px), zero), lanesMax(sub(px, load(node.maxX)), zero));
+      Lanes dy = add(lanesMax(sub(load(node.minY), py), zero), lanesMax(sub(py, load(node.maxY)), zero));
+      Lanes dz = add(lanesMax(sub(load(node.minZ), pz), zero), lanesMax(sub(pz, load(node.maxZ)), zero));
+      float distances[4];
+      store(distances, add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz)));
+
+      int order[4];
+      int orderCount = 0;
+      for (int lane = 0; lane < 4; lane++)
+      {
+        int32_t child = node.child[lane];
+        if (child == EMPTY_LANE || distances[lane] > best)
+        {
+          continue;
+        }
+        if (child < 0)
+        {
+          best = distances[lane];
+          id = nodes[~child].id;
+          found = true;
+          continue;
+        }
+        int position = orderCount++;
+        while (position > 0 && distances[order[position - 1]] < distances[lane])
+        {
+          order[position] = order[position - 1];
+          position--;
+        }
+        order[position] = lane;
+      }
+      for (int i = 0; i < orderCount; i++)
+      {
+        stack.push_back({node.child[order[i]], distances[order[i]]});
+      }
+    }
+    if (found)
+    {
+      distance = std::sqrt(best);
+    }
+    return found;
+  }
+
+} // namespace cjh
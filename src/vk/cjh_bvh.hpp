@@ -0,0 +1,148 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace cjh
+{
+  struct CjhAabb
+  {
+    glm::vec3 min{0.f};
+    glm::vec3 max{0.f};
+
+    float surfaceArea() const
+    {
+      glm::vec3 size = max - min;
+      return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+    bool contains(const CjhAabb &other) const
+    {
+      return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+             max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+    }
+    static CjhAabb merge(const CjhAabb &a, const CjhAabb &b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+  };
+
+  // Dynamic bounding volume hierarchy over object boxes. Proxies live in a binary tree that is
+  // built top down with the surface area heuristic, takes single inserts and removals, and is only
+  // refit when a proxy moves; tree rotations along the refit path keep its quality from decaying.
+  // Queries run on a 4-wide copy of the tree whose child boxes are stored as structure of arrays
+  // and tested four at a time. A refit updates that copy in place, it is only collapsed again after
+  // the topology changed. Every proxy carries a caller chosen id. Not thread safe.
+  class CjhBvh
+  {
+  public:
+    static constexpr int32_t NO_PROXY = -1;
+
+    struct Stats
+    {
+      uint32_t proxyCount = 0;
+      uint32_t height = 0;
+      uint32_t wideNodeCount = 0;
+      uint64_t refits = 0;
+      uint64_t rotations = 0;
+      uint64_t collapses = 0; // rebuilds of the 4-wide copy
+    };
+
+    struct RayHit
+    {
+      uint32_t id = 0;
+      float distance = 0.f;
+    };
+
+    // Replaces the tree with a SAH build over the boxes; returns the proxy of every item in order.
+    std::vector<int32_t> build(const std::vector<std::pair<CjhAabb, uint32_t>> &items);
+    void clear();
+
+    int32_t createProxy(const CjhAabb &box, uint32_t id);
+    void destroyProxy(int32_t proxy);
+    // Returns false when the proxy's enlarged box still holds the new one and nothing changed.
+    bool moveProxy(int32_t proxy, const CjhAabb &box);
+    uint32_t getId(int32_t proxy) const { return nodes[proxy].id; }
+
+    // ids of the proxies inside or touching the frustum, planes as CjhCamera::getFrustumPlanes()
+    void queryFrustum(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &ids);
+    void querySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &ids);
+    // Closest proxy along the ray within maxDistance. Boxes are hit tested by default, hitTest can
+    // refine a box hit into the distance to the actual object, or a negative value for a miss.
+    bool raycast(
+        const glm::vec3 &origin,
+        const glm::vec3 &direction,
+        float maxDistance,
+        RayHit &hit,
+        const std::function<float(uint32_t id)> &hitTest = {});
+    // proxy whose box is closest to the point, within maxDistance
+    bool nearest(const glm::vec3 &point, float maxDistance, uint32_t &id, float &distance);
+
+    const Stats &stats() const { return bvhStats; }
+
+  private:
+    static constexpr int32_t NONE = -1;
+
+    struct Node
+    {
+      CjhAabb box{};
+      int32_t parent = NONE; // next free node while on the free list
+      int32_t child[2] = {NONE, NONE};
+      int32_t height = 0; // 0 for leaves, -1 while free
+      uint32_t id = 0;
+      // lane of the 4-wide copy holding this node's box, NONE when it was collapsed away
+      int32_t wideSlot = NONE;
+
+      bool isLeaf() const { return child[0] == NONE; }
+    };
+
+    // child boxes as structure of arrays; a lane is a wide node, a leaf (~node) or EMPTY_LANE
+    struct alignas(16) WideNode
+    {
+      float minX[4], minY[4], minZ[4];
+      float maxX[4], maxY[4], maxZ[4];
+      int32_t child[4];
+    };
+
+    static constexpr int32_t EMPTY_LANE = INT32_MIN;
+
+    struct StackEntry
+    {
+      int32_t wideNode;
+      float distance; // entry distance of rays, squared box distance for nearest()
+    };
+
+    int32_t allocateNode();
+    void freeNode(int32_t index);
+    int32_t buildRange(std::vector<int32_t> &leaves, size_t first, size_t last);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    // refits and rotates from index up to the root
+    void refitUpwards(int32_t index);
+    // swaps a child with a grandchild across the node when that shrinks the node's children
+    bool rotate(int32_t index);
+    void updateWideSlot(int32_t index);
+
+    // makes the 4-wide copy current, returns false for an empty tree
+    bool prepareQuery();
+    int32_t collapse(int32_t index);
+    void setLane(WideNode &node, int lane, const CjhAabb &box, int32_t child);
+    // every proxy below a wide node, for subtrees entirely inside a query volume
+    void collectAll(int32_t wideNode, std::vector<uint32_t> &ids) const;
+
+    std::vector<Node> nodes;
+    int32_t root = NONE;
+    int32_t freeList = NONE;
+
+    std::vector<WideNode> wideNodes;
+    bool wideDirty = true;
+    std::vector<StackEntry> stack;
+
+    Stats bvhStats{};
+  };
+} // namespace cjh
@@ -111,4 +111,22 @@ namespace cjh
     inverseViewMatrix[3][2] = position.z;
   }
 
+  std::array<glm::vec4, 6> CjhCamera::getFrustumPlanes() const
+  {
+    // Gribb-Hartmann: rows of the view projection, clip space depth is 0..1
+    const glm::mat4 m = glm::transpose(projectionMatrix * viewMatrix);
+    std::array<glm::vec4, 6> planes{
+        m[3] + m[0],
+        m[3] - m[0],
+        m[3] + m[1],
+        m[3] - m[1],
+        m[2],
+        m[3] - m[2]};
+    for (auto &plane : planes)
+    {
+      plane = plane / glm::length(glm::vec3(plane));
+    }
+    return planes;
+  }
+
 } // namespace lve
@@ -5,6 +5,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std
+#include <array>
+
 namespace cjh
 {
 
@@ -25,6 +28,9 @@ namespace cjh
         const glm::mat4 &getView() const { return viewMatrix; }
         const glm::mat4 &getInverseView() const { return inverseViewMatrix; }
         const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+        // world space planes of getProjection() * getView(), normals pointing inwards and of unit
+        // length, in the order left, right, bottom, top, near, far
+        std::array<glm::vec4, 6> getFrustumPlanes() const;
 
     private:
         glm::mat4 projectionMatrix{1.f};
@@ -0,0 +1,305 @@
+#include "cjh_depth_pyramid.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace cjh
+{
+  struct DepthReducePushConstantData
+  {
+    uint32_t sourceWidth;
+    uint32_t sourceHeight;
+    uint32_t destinationWidth;
+    uint32_t destinationHeight;
+  };
+
+  namespace
+  {
+    constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+    uint32_t previousPowerOfTwo(uint32_t value)
+    {
+      uint32_t result = 1;
+      while (result * 2 <= value)
+      {
+        result *= 2;
+      }
+      return result;
+    }
+
+    void computeBarrier(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+    {
+      VkMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = srcAccessMask;
+      barrier.dstAccessMask = dstAccessMask;
+      vkCmdPipelineBarrier(
+          commandBuffer,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          0,
+          1,
+          &barrier,
+          0,
+          nullptr,
+          0,
+          nullptr);
+    }
+
+    // discards the contents, every level is rewritten before it is read
+    void transitionToGeneral(
+        VkCommandBuffer commandBuffer, VkImage image, uint32_t levelCount, VkPipelineStageFlags srcStageMask)
+    {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = image;
+      barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      barrier.subresourceRange.baseMipLevel = 0;
+      barrier.subresourceRange.levelCount = levelCount;
+      barrier.subresourceRange.baseArrayLayer = 0;
+      barrier.subresourceRange.layerCount = 1;
+      vkCmdPipelineBarrier(
+          commandBuffer,
+          srcStageMask,
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          0,
+          0,
+          nullptr,
+          0,
+          nullptr,
+          1,
+          &barrier);
+    }
+  } // namespace
+
+  CjhDepthPyramid::CjhDepthPyramid(CjhDevice &device, VkExtent2D depthExtent)
+      : cjhDevice{device},
+        depthExtent{depthExtent},
+        pyramidWidth{previousPowerOfTwo(depthExtent.width)},
+        pyramidHeight{previousPowerOfTwo(depthExtent.height)}
+  {
+    createImage();
+    createSampler();
+    createPipeline();
+    createDescriptors();
+  }
+
+  CjhDepthPyramid::~CjhDepthPyramid()
+  {
+    reducePipeline.reset();
+    vkDestroyPipelineLayout(cjhDevice.device(), pipelineLayout, nullptr);
+    vkDestroySampler(cjhDevice.device(), sampler, nullptr);
+    for (auto levelView : levelViews)
+    {
+      vkDestroyImageView(cjhDevice.device(), levelView, nullptr);
+    }
+    vkDestroyImageView(cjhDevice.device(), imageView, nullptr);
+    vkDestroyImage(cjhDevice.device(), image, nullptr);
+    cjhDevice.allocator().free(imageAllocation);
+  }
+
+  void CjhDepthPyramid::createImage()
+  {
+    uint32_t levels = 1;
+    while ((std::max(pyramidWidth, pyramidHeight) >> levels) > 0)
+    {
+      levels++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = pyramidWidth;
+    imageInfo.extent.height = pyramidHeight;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = levels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    cjhDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(cjhDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create depth pyramid image view!");
+    }
+
+    levelViews.resize(levels);
+    viewInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < levels; level++)
+    {
+      viewInfo.subresourceRange.baseMipLevel = level;
+      if (vkCreateImageView(cjhDevice.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create depth pyramid image view!");
+      }
+    }
+
+    // the culling descriptors point at it before the first build()
+    VkCommandBuffer commandBuffer = cjhDevice.beginSingleTimeCommands();
+    transitionToGeneral(commandBuffer, image, levels, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    cjhDevice.endSingleTimeCommands(commandBuffer);
+  }
+
+  void CjhDepthPyramid::createSampler()
+  {
+    // texelFetch while building, nearest samples of whole texels while culling
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(levelCount() - 1);
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    if (vkCreateSampler(cjhDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create depth pyramid sampler!");
+    }
+  }
+
+  void CjhDepthPyramid::createPipeline()
+  {
+    setLayout =
+        CjhDescriptorSetLayout::Builder(cjhDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DepthReducePushConstantData);
+
+    VkDescriptorSetLayout descriptorSetLayouts[] = {setLayout->getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(cjhDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+        VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    reducePipeline =
+        std::make_unique<CjhComputePipeline>(cjhDevice, "shaders/spv/depth_reduce.comp.spv", pipelineLayout);
+  }
+
+  void CjhDepthPyramid::createDescriptors()
+  {
+    uint32_t setCount = levelCount() + CjhSwapChain::MAX_FRAMES_IN_FLIGHT;
+    descriptorPool =
+        CjhDescriptorPool::Builder(cjhDevice)
+            .setMaxSets(setCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+            .build();
+
+    for (auto &set : depthSets)
+    {
+      if (!descriptorPool->allocateDescriptor(setLayout->getDescriptorSetLayout(), set))
+      {
+        throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+      }
+    }
+
+    levelSets.resize(levelCount(), VK_NULL_HANDLE);
+    for (uint32_t level = 1; level < levelCount(); level++)
+    {
+      VkDescriptorImageInfo sourceInfo{sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+      VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+      bool built = CjhDescriptorWriter(*setLayout, *descriptorPool)
+                       .writeImage(0, &sourceInfo)
+                       .writeImage(1, &destinationInfo)
+                       .build(levelSets[level]);
+      if (!built)
+      {
+        throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+      }
+    }
+  }
+
+  VkDescriptorImageInfo CjhDepthPyramid::descriptorInfo() const
+  {
+    return VkDescriptorImageInfo{sampler, imageView, VK_IMAGE_LAYOUT_GENERAL};
+  }
+
+  void CjhDepthPyramid::build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView)
+  {
+    // the frame fence was waited on, the set is not in use anymore
+    VkDescriptorImageInfo depthInfo{sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo levelInfo{VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL};
+    CjhDescriptorWriter(*setLayout, *descriptorPool)
+        .writeImage(0, &depthInfo)
+        .writeImage(1, &levelInfo)
+        .overwrite(depthSets[frameIndex]);
+
+    // waits for earlier culling to sample the old levels
+    transitionToGeneral(commandBuffer, image, levelCount(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    reducePipeline->bind(commandBuffer);
+    uint32_t sourceWidth = depthExtent.width;
+    uint32_t sourceHeight = depthExtent.height;
+    for (uint32_t level = 0; level < levelCount(); level++)
+    {
+      DepthReducePushConstantData push{};
+      push.sourceWidth = sourceWidth;
+      push.sourceHeight = sourceHeight;
+      push.destinationWidth = std::max(pyramidWidth >> level, 1u);
+      push.destinationHeight = std::max(pyramidHeight >> level, 1u);
+
+      VkDescriptorSet set = level == 0 ? depthSets[frameIndex] : levelSets[level];
+      vkCmdBindDescriptorSets(
+          commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+      vkCmdPushConstants(
+          commandBuffer,
+          pipelineLayout,
+          VK_SHADER_STAGE_COMPUTE_BIT,
+          0,
+          sizeof(DepthReducePushConstantData),
+          &push);
+      vkCmdDispatch(
+          commandBuffer,
+          (push.destinationWidth + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+          (push.destinationHeight + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+          1);
+
+      // the next level reads this one, the culling after the last reads them all
+      computeBarrier(commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+      sourceWidth = push.destinationWidth;
+      sourceHeight = push.destinationHeight;
+    }
+  }
+
+} // namespace cjh
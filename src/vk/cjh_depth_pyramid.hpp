@@ -0,0 +1,70 @@
+#pragma once
+
+#include "cjh_descriptors.hpp"
+#include "cjh_device.hpp"
+#include "cjh_pipeline.hpp"
+#include "cjh_swap_chain.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace cjh
+{
+  // Hierarchical depth buffer for occlusion culling. Level 0 is the depth attachment shrunk to the
+  // largest power of two size that fits in it, each texel keeping the farthest depth under its
+  // footprint, and every further level halves the one before the same way. Built on the GPU by
+  // depth_reduce.comp; the image stays in VK_IMAGE_LAYOUT_GENERAL and is sampled with nearest
+  // filtering through descriptorInfo().
+  class CjhDepthPyramid
+  {
+  public:
+    CjhDepthPyramid(CjhDevice &device, VkExtent2D depthExtent);
+    ~CjhDepthPyramid();
+
+    CjhDepthPyramid(const CjhDepthPyramid &) = delete;
+    CjhDepthPyramid &operator=(const CjhDepthPyramid &) = delete;
+
+    // Records the reduction of a depth view of depthExtent in
+    // VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, outside of a render pass. Reads of the
+    // pyramid recorded earlier finish first, compute reads after it see the new levels.
+    void build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView);
+
+    VkDescriptorImageInfo descriptorInfo() const;
+    VkExtent2D getDepthExtent() const { return depthExtent; }
+    uint32_t width() const { return pyramidWidth; }
+    uint32_t height() const { return pyramidHeight; }
+    uint32_t levelCount() const { return static_cast<uint32_t>(levelViews.size()); }
+
+  private:
+    void createImage();
+    void createSampler();
+    void createPipeline();
+    void createDescriptors();
+
+    CjhDevice &cjhDevice;
+    VkExtent2D depthExtent;
+    uint32_t pyramidWidth;
+    uint32_t pyramidHeight;
+
+    VkImage image = VK_NULL_HANDLE;
+    CjhAllocation imageAllocation{};
+    VkImageView imageView = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<CjhComputePipeline> reducePipeline;
+
+    std::unique_ptr<CjhDescriptorPool> descriptorPool;
+    std::unique_ptr<CjhDescriptorSetLayout> setLayout;
+    // level 0 reads the frame's depth attachment and is rewritten by every build()
+    std::array<VkDescriptorSet, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> depthSets{};
+    // level i reads level i - 1, index 0 unused
+    std::vector<VkDescriptorSet> levelSets;
+  };
+} // namespace cjh
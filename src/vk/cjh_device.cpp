@@ -1,5 +1,7 @@
 #include "cjh_device.hpp"
 
+#include "cjh_staging_ring.hpp"
+
 // std headers
 #include <cstring>
 #include <iostream>
@@ -63,10 +65,22 @@ namespace cjh
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    m_Allocator = std::make_unique<CjhMemoryAllocator>(m_Device, m_PhysicalDevice);
+    m_StagingRing = std::make_unique<CjhStagingRing>(*this);
+    m_PipelineCache = std::make_unique<CjhPipelineCache>(m_Device, properties);
+    m_ShaderModules = std::make_unique<CjhShaderModuleCache>(m_Device);
   }
 
   CjhDevice::~CjhDevice()
   {
+    m_ShaderModules.reset();
+    m_PipelineCache.reset();
+    m_StagingRing.reset();
+    m_Allocator.reset();
+    if (m_TransferCommandPool != m_CommandPool)
+    {
+      vkDestroyCommandPool(m_Device, m_TransferCommandPool, nullptr);
+    }
     vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
     vkDestroyDevice(m_Device, nullptr);
 
@@ -161,6 +175,10 @@ namespace cjh
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    if (indices.transferFamilyHasValue)
+    {
+      uniqueQueueFamilies.insert(indices.transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -173,8 +191,17 @@ namespace cjh
       queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+    m_TextureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+    m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    m_DrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -205,6 +232,11 @@ namespace cjh
 
     vkGetDeviceQueue(m_Device, indices.graphicsFamily, 0, &m_GraphicsQueue);
     vkGetDeviceQueue(m_Device, indices.presentFamily, 0, &m_PresentQueue);
+    m_TransferQueue = m_GraphicsQueue;
+    if (indices.transferFamilyHasValue)
+    {
+      vkGetDeviceQueue(m_Device, indices.transferFamily, 0, &m_TransferQueue);
+    }
   }
 
   void CjhDevice::createCommandPool()
@@ -221,6 +253,16 @@ namespace cjh
     {
       throw std::runtime_error("failed to create command pool!");
     }
+
+    m_TransferCommandPool = m_CommandPool;
+    if (queueFamilyIndices.transferFamilyHasValue)
+    {
+      poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily;
+      if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_TransferCommandPool) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create transfer command pool!");
+      }
+    }
   }
 
   void CjhDevice::createSurface() { m_Window.createWindowSurface(m_Instance, &m_Surface); }
@@ -398,6 +440,22 @@ namespace cjh
       i++;
     }
 
+    // prefer a pure DMA family, otherwise any family without graphics (async compute) still keeps
+    // copies off the graphics queue; single family implementations such as lavapipe have neither
+    for (VkQueueFlags excluded : {VkQueueFlags{VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT}, VkQueueFlags{VK_QUEUE_GRAPHICS_BIT}})
+    {
+      for (uint32_t family = 0; family < queueFamilyCount && !indices.transferFamilyHasValue; family++)
+      {
+        const auto &queueFamily = queueFamilies[family];
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(queueFamily.queueFlags & excluded))
+        {
+          indices.transferFamily = family;
+          indices.transferFamilyHasValue = true;
+        }
+      }
+    }
+
     return indices;
   }
 
@@ -472,7 +530,7 @@ namespace cjh
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory)
+      CjhAllocation &bufferAllocation)
   {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -488,17 +546,19 @@ namespace cjh
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    CjhMemoryAllocator::AllocationCreateInfo allocInfo{};
+    allocInfo.properties = properties;
+    allocInfo.kind = CjhMemoryAllocator::ResourceKind::Linear;
+    // staging buffers only live until their copy finished, a bump allocator recycles them cheaply
+    allocInfo.strategy = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                             ? CjhMemoryAllocator::Strategy::Linear
+                             : CjhMemoryAllocator::Strategy::Tlsf;
+    bufferAllocation = m_Allocator->allocate(memRequirements, allocInfo);
 
-    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+    if (vkBindBufferMemory(m_Device, buffer, bufferAllocation.memory, bufferAllocation.offset) != VK_SUCCESS)
     {
-      throw std::runtime_error("failed to allocate vertex buffer memory!");
+      throw std::runtime_error("failed to bind buffer memory!");
     }
-
-    vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
   }
 
   VkCommandBuffer CjhDevice::beginSingleTimeCommands()
@@ -535,13 +595,13 @@ namespace cjh
     vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
   }
 
-  void CjhDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+  void CjhDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset)
   {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
+    copyRegion.dstOffset = dstOffset; // Optional
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -580,7 +640,7 @@ namespace cjh
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory)
+      CjhAllocation &imageAllocation)
   {
     if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
@@ -590,17 +650,17 @@ namespace cjh
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS)
+    CjhMemoryAllocator::AllocationCreateInfo allocInfo{};
+    allocInfo.properties = properties;
+    allocInfo.kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL
+                         ? CjhMemoryAllocator::ResourceKind::Optimal
+                         : CjhMemoryAllocator::ResourceKind::Linear;
+    // attachments are recreated with the swap chain, keep them out of the shared blocks
+    allocInfo.dedicated = (imageInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+    imageAllocation = m_Allocator->allocate(memRequirements, allocInfo);
+
+    if (vkBindImageMemory(m_Device, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to bind image memory!");
     }
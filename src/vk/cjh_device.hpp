@@ -1,13 +1,18 @@
 #pragma once
 
+#include "cjh_memory_allocator.hpp"
+#include "cjh_pipeline_cache.hpp"
+#include "cjh_shader_module_cache.hpp"
 #include "cjh_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace cjh
 {
+  class CjhStagingRing;
 
   struct SwapChainSupportDetails
   {
@@ -20,8 +25,11 @@ namespace cjh
   {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    // a family with transfer but without graphics support, if the device has one
+    uint32_t transferFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
   };
 
@@ -49,8 +57,23 @@ namespace cjh
     VkSurfaceKHR surface() { return m_Surface; }
     VkQueue graphicsQueue() { return m_GraphicsQueue; }
     VkQueue presentQueue() { return m_PresentQueue; }
+    // the graphics queue and command pool when there is no dedicated transfer family
+    VkQueue transferQueue() { return m_TransferQueue; }
+    VkCommandPool getTransferCommandPool() { return m_TransferCommandPool; }
+    bool hasDedicatedTransferQueue() { return m_TransferQueue != m_GraphicsQueue; }
     VkInstance instance() { return m_Instance; }
     VkPhysicalDevice physicalDevice() { return m_PhysicalDevice; }
+    CjhMemoryAllocator &allocator() { return *m_Allocator; }
+    CjhStagingRing &stagingRing() { return *m_StagingRing; }
+    // shared by every pipeline creation, persisted across runs
+    VkPipelineCache pipelineCache() { return m_PipelineCache->handle(); }
+    CjhShaderModuleCache &shaderModules() { return *m_ShaderModules; }
+    // enabled whenever the physical device has it
+    bool supportsTextureCompressionBC() { return m_TextureCompressionBC; }
+    // more than one command per vkCmdDrawIndexedIndirect
+    bool supportsMultiDrawIndirect() { return m_MultiDrawIndirect; }
+    // indirect commands with a firstInstance, which the GPU driven path needs
+    bool supportsDrawIndirectFirstInstance() { return m_DrawIndirectFirstInstance; }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(m_PhysicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -64,10 +87,10 @@ namespace cjh
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory);
+        CjhAllocation &bufferAllocation);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
     void copyBufferToImage(
         VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -75,7 +98,7 @@ namespace cjh
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory);
+        CjhAllocation &imageAllocation);
 
     VkPhysicalDeviceProperties properties;
 
@@ -102,11 +125,20 @@ namespace cjh
     VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
     CjhWindow &m_Window;
     VkCommandPool m_CommandPool;
+    VkCommandPool m_TransferCommandPool;
 
     VkDevice m_Device;
     VkSurfaceKHR m_Surface;
     VkQueue m_GraphicsQueue;
     VkQueue m_PresentQueue;
+    VkQueue m_TransferQueue;
+    bool m_TextureCompressionBC = false;
+    bool m_MultiDrawIndirect = false;
+    bool m_DrawIndirectFirstInstance = false;
+    std::unique_ptr<CjhMemoryAllocator> m_Allocator;
+    std::unique_ptr<CjhStagingRing> m_StagingRing;
+    std::unique_ptr<CjhPipelineCache> m_PipelineCache;
+    std::unique_ptr<CjhShaderModuleCache> m_ShaderModules;
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -2,6 +2,7 @@
 
 #include "cjh_camera.hpp"
 #include "cjh_game_object.hpp"
+#include "cjh_render_queue.hpp"
 
 // lib
 #include <vulkan/vulkan.h>
@@ -35,5 +36,6 @@ namespace cjh
 		CjhCamera &camera;
 		VkDescriptorSet globalDescriptorSet;
 		CjhGameObject::Map &gameObjects;
+		CjhRenderQueue &renderQueue;
 	};
 } // namespace lve
@@ -0,0 +1,174 @@
+#include "cjh_frustum_culler.hpp"
+
+// std
+#include <chrono>
+#include <cmath>
+
+#if defined(__AVX__)
+#define CJH_CULL_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJH_CULL_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    constexpr uint32_t PLANE_COUNT = 6;
+
+    // lanes not in outsideMask are visible
+    inline void appendVisible(
+        uint32_t outsideMask, uint32_t laneCount, size_t first, CjhGameObject *const *objects, std::vector<CjhGameObject *> &visible)
+    {
+      for (uint32_t lane = 0; lane < laneCount; lane++)
+      {
+        if ((outsideMask & (1u << lane)) == 0)
+        {
+          visible.push_back(objects[first + lane]);
+        }
+      }
+    }
+  } // namespace
+
+  uint32_t CjhFrustumCuller::laneCount()
+  {
+#if CJH_CULL_AVX
+    return 8;
+#elif CJH_CULL_SSE
+    return 4;
+#else
+    return 1;
+#endif
+  }
+
+  void CjhFrustumCuller::clear()
+  {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+    objects.clear();
+  }
+
+  void CjhFrustumCuller::add(const glm::vec3 &center, const glm::vec3 &extent, CjhGameObject *object)
+  {
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+    objects.push_back(object);
+  }
+
+  // a box is outside when it lies entirely behind one plane: the center's distance to the plane
+  // plus the box's projected half size along the plane normal is negative
+  void CjhFrustumCuller::cull(const std::array<glm::vec4, 6> &planes, bool useSimd)
+  {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = objects.size();
+    visible.clear();
+    visible.reserve(count);
+
+    size_t i = 0;
+#if CJH_CULL_AVX
+    __m256 planeX[PLANE_COUNT], planeY[PLANE_COUNT], planeZ[PLANE_COUNT], planeW[PLANE_COUNT];
+    __m256 absX[PLANE_COUNT], absY[PLANE_COUNT], absZ[PLANE_COUNT];
+    for (uint32_t p = 0; p < PLANE_COUNT; p++)
+    {
+      planeX[p] = _mm256_set1_ps(planes[p].x);
+      planeY[p] = _mm256_set1_ps(planes[p].y);
+      planeZ[p] = _mm256_set1_ps(planes[p].z);
+      planeW[p] = _mm256_set1_ps(planes[p].w);
+      absX[p] = _mm256_set1_ps(std::fabs(planes[p].x));
+      absY[p] = _mm256_set1_ps(std::fabs(planes[p].y));
+      absZ[p] = _mm256_set1_ps(std::fabs(planes[p].z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; useSimd && i + 8 <= count; i += 8)
+    {
+      __m256 cx = _mm256_loadu_ps(centerX.data() + i);
+      __m256 cy = _mm256_loadu_ps(centerY.data() + i);
+      __m256 cz = _mm256_loadu_ps(centerZ.data() + i);
+      __m256 ex = _mm256_loadu_ps(extentX.data() + i);
+      __m256 ey = _mm256_loadu_ps(extentY.data() + i);
+      __m256 ez = _mm256_loadu_ps(extentZ.data() + i);
+      __m256 outside = zero;
+      for (uint32_t p = 0; p < PLANE_COUNT; p++)
+      {
+        __m256 distance = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+            _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+        __m256 radius = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+      }
+      appendVisible(static_cast<uint32_t>(_mm256_movemask_ps(outside)), 8, i, objects.data(), visible);
+    }
+#elif CJH_CULL_SSE
+    __m128 planeX[PLANE_COUNT], planeY[PLANE_COUNT], planeZ[PLANE_COUNT], planeW[PLANE_COUNT];
+    __m128 absX[PLANE_COUNT], absY[PLANE_COUNT], absZ[PLANE_COUNT];
+    for (uint32_t p = 0; p < PLANE_COUNT; p++)
+    {
+      planeX[p] = _mm_set1_ps(planes[p].x);
+      planeY[p] = _mm_set1_ps(planes[p].y);
+      planeZ[p] = _mm_set1_ps(planes[p].z);
+      planeW[p] = _mm_set1_ps(planes[p].w);
+      absX[p] = _mm_set1_ps(std::fabs(planes[p].x));
+      absY[p] = _mm_set1_ps(std::fabs(planes[p].y));
+      absZ[p] = _mm_set1_ps(std::fabs(planes[p].z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; useSimd && i + 4 <= count; i += 4)
+    {
+      __m128 cx = _mm_loadu_ps(centerX.data() + i);
+      __m128 cy = _mm_loadu_ps(centerY.data() + i);
+      __m128 cz = _mm_loadu_ps(centerZ.data() + i);
+      __m128 ex = _mm_loadu_ps(extentX.data() + i);
+      __m128 ey = _mm_loadu_ps(extentY.data() + i);
+      __m128 ez = _mm_loadu_ps(extentZ.data() + i);
+      __m128 outside = zero;
+      for (uint32_t p = 0; p < PLANE_COUNT; p++)
+      {
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+            _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+        __m128 radius = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+      }
+      appendVisible(static_cast<uint32_t>(_mm_movemask_ps(outside)), 4, i, objects.data(), visible);
+    }
+#else
+    (void)useSimd;
+#endif
+
+    // the tail that does not fill a register, or everything without SIMD
+    for (; i < count; i++)
+    {
+      bool outside = false;
+      for (uint32_t p = 0; p < PLANE_COUNT && !outside; p++)
+      {
+        const glm::vec4 &plane = planes[p];
+        float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+        float radius = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] +
+                       std::fabs(plane.z) * extentZ[i];
+        outside = distance + radius < 0.f;
+      }
+      if (!outside)
+      {
+        visible.push_back(objects[i]);
+      }
+    }
+
+    std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    cullStats.testedCount = static_cast<uint32_t>(count);
+    cullStats.visibleCount = static_cast<uint32_t>(visible.size());
+    cullStats.nanosecondsPerObject = count > 0 ? elapsed.count() / count : 0.f;
+  }
+
+} // namespace cjh
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "cjh_game_object.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cjh
+{
+  // Frustum culling on the CPU. The world space boxes of the objects are kept as a structure of
+  // arrays and tested against the planes eight at a time with AVX, four at a time with SSE, or one
+  // by one where neither is available; the survivors form the visibility list the render queue is
+  // filled from. Render thread only.
+  class CjhFrustumCuller
+  {
+  public:
+    struct Stats
+    {
+      uint32_t testedCount = 0;
+      uint32_t visibleCount = 0;
+      float nanosecondsPerObject = 0.f; // plane tests only, gathering the boxes not included
+    };
+
+    // the lanes of the compiled test, 1 without SIMD
+    static uint32_t laneCount();
+
+    void clear();
+    // world box of the model bounds under the object's transform; the object must have a model
+    void add(CjhGameObject &object)
+    {
+      CjhModel::Bounds bounds = object.model->getBounds().transformed(object.transform.mat4());
+      add((bounds.min + bounds.max) * 0.5f, (bounds.max - bounds.min) * 0.5f, &object);
+    }
+    // a world box given by its center and half size, object is what visibleObjects() hands back
+    void add(const glm::vec3 &center, const glm::vec3 &extent, CjhGameObject *object);
+    // clears and adds every object with a model
+    void gather(CjhGameObject::Map &gameObjects)
+    {
+      clear();
+      for (auto &kv : gameObjects)
+      {
+        if (kv.second.model != nullptr)
+        {
+          add(kv.second);
+        }
+      }
+    }
+    // planes as CjhCamera::getFrustumPlanes() returns them; without useSimd every box goes through
+    // the scalar loop, for comparing the two
+    void cull(const std::array<glm::vec4, 6> &planes, bool useSimd = true);
+
+    // objects of the last cull() inside or touching the frustum, in the order they were added
+    const std::vector<CjhGameObject *> &visibleObjects() const { return visible; }
+    size_t size() const { return objects.size(); }
+    const Stats &stats() const { return cullStats; }
+
+  private:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<CjhGameObject *> objects;
+    std::vector<CjhGameObject *> visible;
+    Stats cullStats{};
+  };
+} // namespace cjh
@@ -61,6 +61,8 @@ namespace cjh
 
     glm::vec3 color{};
     TransformComponent transform{};
+    // per object, so instances of one shared model can be drawn by different systems
+    CjhModel::RenderSystem renderSystem = CjhModel::RenderSystem::Simple;
 
     // Optional pointer components
     std::shared_ptr<CjhModel> model{};
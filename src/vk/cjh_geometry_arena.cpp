@@ -0,0 +1,130 @@
+#include "cjh_geometry_arena.hpp"
+
+#include "cjh_model.hpp"
+#include "cjh_swap_chain.hpp"
+
+// std
+#include <cassert>
+
+namespace cjh
+{
+
+  CjhGeometryArena::RangeAllocator::RangeAllocator(uint32_t capacity)
+  {
+    if (capacity > 0)
+    {
+      freeRanges.emplace(0, capacity);
+    }
+  }
+
+  bool CjhGeometryArena::RangeAllocator::allocate(uint32_t count, uint32_t &first)
+  {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+      if (it->second < count)
+      {
+        continue;
+      }
+      first = it->first;
+      uint32_t remaining = it->second - count;
+      freeRanges.erase(it);
+      if (remaining > 0)
+      {
+        freeRanges.emplace(first + count, remaining);
+      }
+      used += count;
+      return true;
+    }
+    return false;
+  }
+
+  void CjhGeometryArena::RangeAllocator::free(uint32_t first, uint32_t count)
+  {
+    used -= count;
+    auto next = freeRanges.lower_bound(first);
+    if (next != freeRanges.begin())
+    {
+      auto prev = std::prev(next);
+      assert(prev->first + prev->second <= first && "Freed range overlaps a free range");
+      if (prev->first + prev->second == first)
+      {
+        first = prev->first;
+        count += prev->second;
+        freeRanges.erase(prev);
+      }
+    }
+    if (next != freeRanges.end() && first + count == next->first)
+    {
+      count += next->second;
+      freeRanges.erase(next);
+    }
+    freeRanges.emplace(first, count);
+  }
+
+  CjhGeometryArena::CjhGeometryArena(CjhDevice &device, uint32_t vertexCapacity, uint32_t indexCapacity)
+      : cjhDevice{device}, vertexRanges{vertexCapacity}, indexRanges{indexCapacity}
+  {
+    vertexBuffer = std::make_unique<CjhBuffer>(
+        cjhDevice,
+        sizeof(CjhModel::Vertex),
+        vertexCapacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    indexBuffer = std::make_unique<CjhBuffer>(
+        cjhDevice,
+        sizeof(uint32_t),
+        indexCapacity,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  bool CjhGeometryArena::allocate(uint32_t vertexCount, uint32_t indexCount, Range &vertices, Range &indices)
+  {
+    vertices = {0, vertexCount};
+    indices = {0, indexCount};
+    if (!vertexRanges.allocate(vertexCount, vertices.first))
+    {
+      return false;
+    }
+    if (indexCount > 0 && !indexRanges.allocate(indexCount, indices.first))
+    {
+      vertexRanges.free(vertices.first, vertexCount);
+      return false;
+    }
+    return true;
+  }
+
+  void CjhGeometryArena::free(const Range &vertices, const Range &indices)
+  {
+    retired.push_back({vertices, indices, frameCounter});
+  }
+
+  void CjhGeometryArena::beginFrame()
+  {
+    frameCounter++;
+    // frames recorded more than MAX_FRAMES_IN_FLIGHT frames ago have finished on the GPU
+    for (auto it = retired.begin(); it != retired.end();)
+    {
+      if (frameCounter - it->frame <= CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+      {
+        ++it;
+        continue;
+      }
+      vertexRanges.free(it->vertices.first, it->vertices.count);
+      if (it->indices.count > 0)
+      {
+        indexRanges.free(it->indices.first, it->indices.count);
+      }
+      it = retired.erase(it);
+    }
+  }
+
+  void CjhGeometryArena::bind(VkCommandBuffer commandBuffer)
+  {
+    VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  }
+
+} // namespace cjh
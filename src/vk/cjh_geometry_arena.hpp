@@ -0,0 +1,83 @@
+#pragma once
+
+#include "cjh_buffer.hpp"
+#include "cjh_device.hpp"
+
+// std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace cjh
+{
+  // One device local vertex buffer and one index buffer shared by every static mesh. Models keep
+  // only element offsets into them, so a render system binds the arena once and draws every
+  // model with firstIndex / vertexOffset. Render thread only.
+  class CjhGeometryArena
+  {
+  public:
+    struct Range
+    {
+      uint32_t first = 0;
+      uint32_t count = 0;
+    };
+
+    static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1024 * 1024;
+    static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 4 * 1024 * 1024;
+
+    CjhGeometryArena(
+        CjhDevice &device,
+        uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+        uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+    CjhGeometryArena(const CjhGeometryArena &) = delete;
+    CjhGeometryArena &operator=(const CjhGeometryArena &) = delete;
+
+    // false when either buffer has no contiguous room left, the caller keeps its own buffers then
+    bool allocate(uint32_t vertexCount, uint32_t indexCount, Range &vertices, Range &indices);
+    // the ranges are reused once every frame that may still read them has finished
+    void free(const Range &vertices, const Range &indices);
+
+    // call once per frame after the frame fence was waited on
+    void beginFrame();
+
+    void bind(VkCommandBuffer commandBuffer);
+
+    VkBuffer getVertexBuffer() const { return vertexBuffer->getBuffer(); }
+    VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+    uint32_t getUsedVertexCount() const { return vertexRanges.usedCount(); }
+    uint32_t getUsedIndexCount() const { return indexRanges.usedCount(); }
+
+  private:
+    // first fit over a sorted free list, neighbouring free ranges are merged on release
+    class RangeAllocator
+    {
+    public:
+      explicit RangeAllocator(uint32_t capacity);
+
+      bool allocate(uint32_t count, uint32_t &first);
+      void free(uint32_t first, uint32_t count);
+      uint32_t usedCount() const { return used; }
+
+    private:
+      std::map<uint32_t, uint32_t> freeRanges;
+      uint32_t used = 0;
+    };
+
+    struct RetiredRanges
+    {
+      Range vertices;
+      Range indices;
+      uint64_t frame;
+    };
+
+    CjhDevice &cjhDevice;
+    std::unique_ptr<CjhBuffer> vertexBuffer;
+    std::unique_ptr<CjhBuffer> indexBuffer;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    std::vector<RetiredRanges> retired;
+    uint64_t frameCounter = 0;
+  };
+} // namespace cjh
@@ -1,162 +1,333 @@
 #include "cjh_image.hpp"
+
+#include "cjh_async_io.hpp"
+#include "cjh_mip_generator.hpp"
+#include "cjh_staging_ring.hpp"
+#include "cjh_texture_container.hpp"
+#include "cjh_vfs.hpp"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <future>
+
 namespace cjh
 {
+    namespace
+    {
+        // decodes straight out of the (possibly archived) file, stbi_image_free releases the result
+        stbi_uc *loadPixels(const std::string &path, int &width, int &height, int &channels)
+        {
+            CjhVfs::File file = CjhVfs::shared().tryOpen(path);
+            if (!file)
+            {
+                return nullptr;
+            }
+            return stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels,
+                                         STBI_rgb_alpha);
+        }
+
+        // A bake is stale when its source is a loose file edited after the file holding the bake,
+        // the loose .ctex itself or the archive it was packed into. Archived sources are trusted.
+        bool bakeIsCurrent(const std::string &sourcePath, const std::string &bakedPath)
+        {
+            CjhVfs::Location baked;
+            if (!CjhVfs::shared().locate(bakedPath, baked))
+            {
+                return false;
+            }
+            std::string looseSource = CjhVfs::shared().loosePath(sourcePath);
+            if (looseSource.empty())
+            {
+                return true;
+            }
+            std::error_code ec;
+            auto sourceTime = std::filesystem::last_write_time(looseSource, ec);
+            if (ec)
+            {
+                return true;
+            }
+            auto bakedTime = std::filesystem::last_write_time(baked.diskPath, ec);
+            return !ec && bakedTime >= sourceTime;
+        }
+    } // namespace
+
     CjhImage::CjhImage(CjhDevice &cjhDevice, std::string Path)
         : m_cjhDevice(cjhDevice)
     {
+        // prefer the output of the texture baker next to the source image
+        std::string bakedPath = texture_container::bakedPath(Path);
+        if (CjhVfs::shared().exists(bakedPath) && (Path == bakedPath || bakeIsCurrent(Path, bakedPath)) &&
+            loadBaked(bakedPath))
+        {
+            creatImageView(m_format);
+            createImageSampler();
+            return;
+        }
+        if (Path == bakedPath)
+        {
+            throw std::runtime_error("failed to load baked texture " + Path + "!");
+        }
+
         // use stb to read the file
-        stbi_uc *pixels = stbi_load(Path.c_str(), &m_imgHeight, &m_imgWidth, &m_channels, STBI_rgb_alpha);
-        VkDeviceSize imageSize = m_imgHeight * m_imgHeight * 4;
+        stbi_uc *pixels = loadPixels(Path, m_imgWidth, m_imgHeight, m_channels);
 
         if (!pixels)
         {
             throw std::runtime_error("failed to load texture image!");
         }
-        CjhBuffer stagingBuffer(m_cjhDevice,
-                                imageSize,
-                                1,
-                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(pixels);
-        stagingBuffer.unmap();
 
+        uploadLayers({pixels});
         stbi_image_free(pixels);
 
-        createImage(VK_FORMAT_R8G8B8A8_SRGB,
-                    VK_IMAGE_TILING_OPTIMAL,
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL | VK_IMAGE_USAGE_SAMPLED_BIT,
-                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copyBufferToImage(stagingBuffer.getBuffer(), m_image, static_cast<uint32_t>(m_imgHeight), static_cast<uint32_t>(m_imgWidth));
-        transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-        creatImageView(VK_FORMAT_R8G8B8A8_SRGB);
+        creatImageView(m_format);
         createImageSampler();
     }
 
-    void CjhImage::createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+    CjhImage::CjhImage(CjhDevice &cjhDevice, const std::vector<std::string> &layerPaths)
+        : m_cjhDevice(cjhDevice)
     {
-        VkImageCreateInfo imageInfo{};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.format = format;
-        imageInfo.extent.width = static_cast<uint32_t>(m_imgWidth);
-        imageInfo.extent.height = static_cast<uint32_t>(m_imgHeight);
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.tiling = tiling;
-        imageInfo.usage = usage;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (layerPaths.empty())
+        {
+            throw std::runtime_error("texture array needs at least one layer!");
+        }
 
-        if (vkCreateImage(m_cjhDevice.device(), &imageInfo, nullptr, &m_image) != VK_SUCCESS)
+        // all layers are read in one batch, each is decoded as soon as its read completed
+        std::vector<std::promise<CjhVfs::File>> reads(layerPaths.size());
+        for (size_t i = 0; i < layerPaths.size(); i++)
         {
-            throw std::runtime_error("failed to create image!");
+            CjhVfs::shared().openAsync(layerPaths[i], CjhAsyncIo::shared(), [&reads, i](CjhVfs::File file)
+                                       { reads[i].set_value(std::move(file)); });
         }
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(m_cjhDevice.device(), m_image, &memRequirements);
+        CjhAsyncIo::shared().flush();
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = m_cjhDevice.findMemoryType(memRequirements.memoryTypeBits, properties);
+        struct DecodedLayer
+        {
+            stbi_uc *pixels = nullptr;
+            int width = 0;
+            int height = 0;
+            int channels = 0;
+        };
+        std::vector<DecodedLayer> decoded(layerPaths.size());
+        CjhThreadPool::shared().parallelFor(static_cast<uint32_t>(decoded.size()), [&](uint32_t i)
+                                            {
+            CjhVfs::File file = reads[i].get_future().get();
+            DecodedLayer &layer = decoded[i];
+            if (file)
+            {
+                layer.pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &layer.width,
+                                                     &layer.height, &layer.channels, STBI_rgb_alpha);
+            } });
 
-        if (vkAllocateMemory(m_cjhDevice.device(), &allocInfo, nullptr, &m_imageMemory) != VK_SUCCESS)
+        std::vector<stbi_uc *> layers;
+        for (const auto &layer : decoded)
+        {
+            layers.push_back(layer.pixels);
+        }
+        for (size_t i = 0; i < decoded.size(); i++)
         {
-            throw std::runtime_error("failed to allocate image memory!");
+            if (!decoded[i].pixels || decoded[i].width != decoded[0].width || decoded[i].height != decoded[0].height)
+            {
+                for (stbi_uc *layer : layers)
+                {
+                    stbi_image_free(layer);
+                }
+                throw std::runtime_error("failed to load texture array layer " + layerPaths[i] + "!");
+            }
         }
+        m_imgWidth = decoded[0].width;
+        m_imgHeight = decoded[0].height;
+        m_channels = decoded[0].channels;
 
-        vkBindImageMemory(m_cjhDevice.device(), m_image, m_imageMemory, 0);
-    }
+        uploadLayers(layers);
+        for (stbi_uc *layer : layers)
+        {
+            stbi_image_free(layer);
+        }
 
-    void CjhImage::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-    {
-        auto commandBuffer = m_cjhDevice.beginSingleTimeCommands();
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {
-            width,
-            height,
-            1};
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-        m_cjhDevice.endSingleTimeCommands(commandBuffer);
+        creatImageView(m_format);
+        createImageSampler();
     }
 
-    void CjhImage::transitionImageLayout(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+    bool CjhImage::loadBaked(const std::string &path)
     {
-        auto commandBuffer = m_cjhDevice.beginSingleTimeCommands();
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = m_image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.srcAccessMask = 0; // TODO
-        barrier.dstAccessMask = 0; // TODO
+        using namespace texture_container;
 
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
+        CjhVfs::File file = CjhVfs::shared().open(path);
+        Header header;
+        if (file.size() < sizeof(Header))
+        {
+            return false;
+        }
+        memcpy(&header, file.data(), sizeof(Header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.width == 0 ||
+            header.height == 0 || header.arrayLayers == 0 || header.mipLevels == 0 ||
+            header.mipLevels > CjhMipGenerator::levelCount(header.width, header.height))
+        {
+            return false;
+        }
+        uint64_t entriesSize = static_cast<uint64_t>(header.mipLevels) * header.arrayLayers * sizeof(LevelEntry);
+        if (sizeof(Header) + entriesSize > file.size() || header.dataOffset > file.size() ||
+            header.dataSize > file.size() - header.dataOffset)
+        {
+            return false;
+        }
 
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+        // m_format stays untouched until the container checks out, the stb fallback relies on it
+        bool srgb = (header.flags & FLAG_SRGB) != 0;
+        VkFormat format;
+        switch (header.encoding)
+        {
+        case Encoding::Rgba8:
+            format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+            break;
+        case Encoding::Bc1:
+            format = srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+            break;
+        case Encoding::Bc3:
+            format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+            break;
+        default:
+            return false;
+        }
+        if (header.encoding != Encoding::Rgba8 && !m_cjhDevice.supportsTextureCompressionBC())
         {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            return false;
+        }
+
+        std::vector<LevelEntry> entries(static_cast<size_t>(header.mipLevels) * header.arrayLayers);
+        memcpy(entries.data(), file.data() + sizeof(Header), static_cast<size_t>(entriesSize));
+        // every subresource exactly once, with the extent and size its mip level implies
+        std::vector<bool> covered(entries.size(), false);
+        for (const auto &entry : entries)
+        {
+            if (entry.mipLevel >= header.mipLevels || entry.arrayLayer >= header.arrayLayers)
+            {
+                return false;
+            }
+            uint32_t levelWidth = std::max(header.width >> entry.mipLevel, 1u);
+            uint32_t levelHeight = std::max(header.height >> entry.mipLevel, 1u);
+            if (entry.width != levelWidth || entry.height != levelHeight ||
+                entry.size != levelSize(header.encoding, levelWidth, levelHeight) ||
+                entry.offset % DATA_ALIGNMENT != 0 || entry.offset > header.dataSize ||
+                entry.size > header.dataSize - entry.offset)
+            {
+                return false;
+            }
+            size_t index = static_cast<size_t>(entry.mipLevel) * header.arrayLayers + entry.arrayLayer;
+            if (covered[index])
+            {
+                return false;
+            }
+            covered[index] = true;
+        }
+
+        m_format = format;
+        m_imgWidth = static_cast<int>(header.width);
+        m_imgHeight = static_cast<int>(header.height);
+        m_mipLevels = header.mipLevels;
+        m_arrayLayers = header.arrayLayers;
+        createImage(m_format,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        // the data block already has the staging layout, it goes into the ring in one piece
+        CjhStagingRing::ImageUploadBuilder upload(m_cjhDevice.stagingRing(), m_image);
+        upload.setSubresourceCount(m_mipLevels, m_arrayLayers)
+            .setPackedData(file.data() + header.dataOffset, header.dataSize);
+        for (const auto &entry : entries)
+        {
+            upload.addPackedRegion(entry.mipLevel, entry.arrayLayer, entry.width, entry.height, entry.offset);
         }
-        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        upload.record();
+        m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return true;
+    }
+
+    void CjhImage::uploadLayers(const std::vector<unsigned char *> &layers)
+    {
+        const VkFormat format = m_format;
+        uint32_t width = static_cast<uint32_t>(m_imgWidth);
+        uint32_t height = static_cast<uint32_t>(m_imgHeight);
+        m_arrayLayers = static_cast<uint32_t>(layers.size());
+        m_mipLevels = CjhMipGenerator::levelCount(width, height);
+
+        // blit the mip chain on the GPU when the format allows linear filtered blits
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(m_cjhDevice.physicalDevice(), format, &formatProperties);
+        const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                                  VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        bool gpuMips = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (gpuMips)
         {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        }
+        createImage(format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        // the staging ring records the layout transitions and the copies, they go out with its next flush
+        CjhStagingRing::ImageUploadBuilder upload(m_cjhDevice.stagingRing(), m_image);
+        upload.setSubresourceCount(m_mipLevels, m_arrayLayers);
+        if (gpuMips)
+        {
+            upload.generateMipmaps();
+            VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4;
+            for (uint32_t layer = 0; layer < m_arrayLayers; layer++)
+            {
+                upload.addRegion(0, layer, width, height, layers[layer], layerSize);
+            }
+            upload.record();
         }
         else
         {
-            throw std::invalid_argument("unsupported layout transition!");
+            // record() copies the data into the ring, so the chains only have to outlive it
+            std::vector<CjhMipGenerator::Result> chains;
+            chains.reserve(m_arrayLayers);
+            for (uint32_t layer = 0; layer < m_arrayLayers; layer++)
+            {
+                chains.push_back(CjhMipGenerator::generate(layers[layer], width, height, true));
+                for (uint32_t level = 0; level < m_mipLevels; level++)
+                {
+                    const auto &mip = chains.back().levels[level];
+                    upload.addRegion(level, layer, mip.width, mip.height, chains.back().pixels.data() + mip.offset, mip.size);
+                }
+            }
+            upload.record();
         }
+        m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
 
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            sourceStage, destinationStage,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
-        m_cjhDevice.endSingleTimeCommands(commandBuffer);
+    void CjhImage::createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent.width = static_cast<uint32_t>(m_imgWidth);
+        imageInfo.extent.height = static_cast<uint32_t>(m_imgHeight);
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = m_mipLevels;
+        imageInfo.arrayLayers = m_arrayLayers;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = tiling;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-        m_imageLayout = newLayout;
+        m_cjhDevice.createImageWithInfo(imageInfo, properties, m_image, m_imageAllocation);
     }
+
     CjhImage::~CjhImage()
     {
         vkDestroySampler(m_cjhDevice.device(), m_imageSampler, nullptr);
         vkDestroyImageView(m_cjhDevice.device(), m_imageView, nullptr);
         vkDestroyImage(m_cjhDevice.device(), m_image, nullptr);
-        vkFreeMemory(m_cjhDevice.device(), m_imageMemory, nullptr);
+        m_cjhDevice.allocator().free(m_imageAllocation);
     }
 
     void CjhImage::creatImageView(VkFormat format)
@@ -164,13 +335,13 @@ namespace cjh
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = m_image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.viewType = m_arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = format;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.levelCount = m_mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.layerCount = m_arrayLayers;
 
         if (vkCreateImageView(m_cjhDevice.device(), &viewInfo, nullptr, &m_imageView) != VK_SUCCESS)
         {
@@ -199,7 +370,7 @@ namespace cjh
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = static_cast<float>(m_mipLevels - 1);
 
         if (vkCreateSampler(m_cjhDevice.device(), &samplerInfo, nullptr, &m_imageSampler) != VK_SUCCESS)
         {
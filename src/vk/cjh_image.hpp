@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "cjh_device.hpp"
 #include "cjh_buffer.hpp"
@@ -12,17 +13,20 @@ namespace cjh
     class CjhImage
     {
     public:
+        // uses the baked .ctex next to Path when there is a usable one
         CjhImage(CjhDevice &cjhDevice, std::string Path);
+        // 2D array texture, one layer per file; every layer must have the same size
+        CjhImage(CjhDevice &cjhDevice, const std::vector<std::string> &layerPaths);
         ~CjhImage();
-        void transitionImageLayout(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
         VkDescriptorImageInfo descriptorInfo();
         // helper functions
         VkImage image() const { return m_image; }
         VkImageView imageView() const { return m_imageView; }
+        VkDeviceSize memorySize() const { return m_imageAllocation.size; }
 
     private:
         VkImage m_image;
-        VkDeviceMemory m_imageMemory;
+        CjhAllocation m_imageAllocation;
         VkImageView m_imageView;
         VkImageLayout m_imageLayout;
         VkSampler m_imageSampler;
@@ -30,10 +34,16 @@ namespace cjh
         int m_imgWidth;
         int m_imgHeight;
         int m_channels;
+        VkFormat m_format = VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t m_mipLevels = 1;
+        uint32_t m_arrayLayers = 1;
 
+        // loads a .ctex file written by the texture baker, false when it is unusable on this device
+        bool loadBaked(const std::string &path);
+        // creates the image with a full mip chain and records the upload of every layer
+        void uploadLayers(const std::vector<unsigned char *> &layers);
         void createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
         void creatImageView(VkFormat format);
         void createImageSampler();
-        void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
     };
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "cjh_instance_buffer.hpp"
+
+namespace cjh
+{
+  CjhInstanceBuffer::CjhInstanceBuffer(CjhDevice &device, uint32_t initialCapacity)
+      : cjhDevice{device}, initialCapacity{initialCapacity > 0 ? initialCapacity : 1} {}
+
+  CjhModel::Instance *CjhInstanceBuffer::map(int frameIndex, uint32_t count)
+  {
+    auto &buffer = buffers[frameIndex];
+    uint32_t capacity = buffer ? buffer->getInstanceCount() : 0;
+    if (capacity < count)
+    {
+      // the frame fence was waited on, nothing reads this frame's buffer anymore
+      uint32_t newCapacity = capacity > 0 ? capacity : initialCapacity;
+      while (newCapacity < count)
+      {
+        newCapacity *= 2;
+      }
+      buffer = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(CjhModel::Instance),
+          newCapacity,
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+      buffer->map();
+    }
+    counts[frameIndex] = count;
+    return static_cast<CjhModel::Instance *>(buffer->getMappedMemory());
+  }
+
+  void CjhInstanceBuffer::flush(int frameIndex)
+  {
+    if (buffers[frameIndex] && counts[frameIndex] > 0)
+    {
+      buffers[frameIndex]->flush(counts[frameIndex] * sizeof(CjhModel::Instance), 0);
+    }
+  }
+
+  void CjhInstanceBuffer::bind(VkCommandBuffer commandBuffer, int frameIndex)
+  {
+    VkBuffer instanceBuffers[] = {buffers[frameIndex]->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceBuffers, offsets);
+  }
+
+} // namespace cjh
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "cjh_buffer.hpp"
+#include "cjh_device.hpp"
+#include "cjh_model.hpp"
+#include "cjh_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace cjh
+{
+  // Host visible vertex buffer with the per instance data of one render system's draws. Every
+  // frame in flight writes its own buffer, so the one being filled is never read by the GPU, and
+  // a buffer grows by doubling when a frame needs more room. Render thread only.
+  class CjhInstanceBuffer
+  {
+  public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 1024;
+
+    explicit CjhInstanceBuffer(CjhDevice &device, uint32_t initialCapacity = DEFAULT_CAPACITY);
+
+    CjhInstanceBuffer(const CjhInstanceBuffer &) = delete;
+    CjhInstanceBuffer &operator=(const CjhInstanceBuffer &) = delete;
+
+    // room for count instances of this frame, replacing what the frame wrote last time
+    CjhModel::Instance *map(int frameIndex, uint32_t count);
+    // makes the written instances visible to the device
+    void flush(int frameIndex);
+    void bind(VkCommandBuffer commandBuffer, int frameIndex);
+
+  private:
+    CjhDevice &cjhDevice;
+    uint32_t initialCapacity;
+    std::array<std::unique_ptr<CjhBuffer>, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> buffers;
+    std::array<uint32_t, CjhSwapChain::MAX_FRAMES_IN_FLIGHT> counts{};
+  };
+} // namespace cjh
@@ -0,0 +1,121 @@
+#include "cjh_mapped_file.hpp"
+
+// std
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cjh
+{
+
+#ifdef _WIN32
+  CjhMappedFile::CjhMappedFile(const std::string &filepath)
+  {
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      throw std::runtime_error("failed to open file: " + filepath);
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+      CloseHandle(file);
+      throw std::runtime_error("failed to query file size: " + filepath);
+    }
+    fileSize = static_cast<size_t>(size.QuadPart);
+    if (fileSize == 0)
+    {
+      return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+      CloseHandle(file);
+      throw std::runtime_error("failed to map file: " + filepath);
+    }
+    mappingHandle = mapping;
+
+    mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mapped == nullptr)
+    {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      throw std::runtime_error("failed to map file: " + filepath);
+    }
+  }
+
+  CjhMappedFile::~CjhMappedFile()
+  {
+    if (mapped)
+    {
+      UnmapViewOfFile(mapped);
+    }
+    if (mappingHandle)
+    {
+      CloseHandle(static_cast<HANDLE>(mappingHandle));
+    }
+    if (fileHandle)
+    {
+      CloseHandle(static_cast<HANDLE>(fileHandle));
+    }
+  }
+#else
+  CjhMappedFile::CjhMappedFile(const std::string &filepath)
+  {
+    fileDescriptor = open(filepath.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+      throw std::runtime_error("failed to open file: " + filepath);
+    }
+
+    struct stat fileStat;
+    if (fstat(fileDescriptor, &fileStat) != 0)
+    {
+      close(fileDescriptor);
+      throw std::runtime_error("failed to query file size: " + filepath);
+    }
+    fileSize = static_cast<size_t>(fileStat.st_size);
+    if (fileSize == 0)
+    {
+      return;
+    }
+
+    mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapped == MAP_FAILED)
+    {
+      mapped = nullptr;
+      close(fileDescriptor);
+      throw std::runtime_error("failed to map file: " + filepath);
+    }
+    // the whole file is consumed right after mapping, start paging it in now
+    madvise(mapped, fileSize, MADV_WILLNEED);
+  }
+
+  CjhMappedFile::~CjhMappedFile()
+  {
+    if (mapped)
+    {
+      munmap(mapped, fileSize);
+    }
+    if (fileDescriptor >= 0)
+    {
+      close(fileDescriptor);
+    }
+  }
+#endif
+
+} // namespace cjh
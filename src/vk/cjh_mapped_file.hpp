@@ -0,0 +1,33 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cjh
+{
+  // Read-only memory mapping of a whole file. The mapping lives as long as the object.
+  class CjhMappedFile
+  {
+  public:
+    CjhMappedFile(const std::string &filepath);
+    ~CjhMappedFile();
+
+    CjhMappedFile(const CjhMappedFile &) = delete;
+    CjhMappedFile &operator=(const CjhMappedFile &) = delete;
+
+    const uint8_t *data() const { return static_cast<const uint8_t *>(mapped); }
+    size_t size() const { return fileSize; }
+
+  private:
+    void *mapped = nullptr;
+    size_t fileSize = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+  };
+} // namespace cjh
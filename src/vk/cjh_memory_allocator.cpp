@@ -0,0 +1,707 @@
+#include "cjh_memory_allocator.hpp"
+
+#include "cjh_async_io.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    inline uint32_t firstSetBit(uint64_t mask)
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward64(&index, mask);
+      return static_cast<uint32_t>(index);
+#else
+      return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+    }
+
+    inline uint32_t lastSetBit(uint64_t mask)
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanReverse64(&index, mask);
+      return static_cast<uint32_t>(index);
+#else
+      return 63 - static_cast<uint32_t>(__builtin_clzll(mask));
+#endif
+    }
+
+    inline VkDeviceSize roundDownToPowerOfTwo(VkDeviceSize value)
+    {
+      return VkDeviceSize{1} << lastSetBit(value);
+    }
+
+    inline VkDeviceSize roundUpToPowerOfTwo(VkDeviceSize value)
+    {
+      VkDeviceSize rounded = roundDownToPowerOfTwo(value);
+      return rounded == value ? value : rounded << 1;
+    }
+  } // namespace
+
+  // Bookkeeping of the free space inside one VkDeviceMemory, one implementation per strategy.
+  class CjhBlockMetadata
+  {
+  public:
+    virtual ~CjhBlockMetadata() = default;
+
+    virtual bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) = 0;
+    virtual void free(VkDeviceSize offset) = 0;
+    virtual bool empty() const = 0;
+  };
+
+  namespace
+  {
+    class LinearMetadata : public CjhBlockMetadata
+    {
+    public:
+      explicit LinearMetadata(VkDeviceSize size) : blockSize{size} {}
+
+      bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) override
+      {
+        VkDeviceSize alignedHead = alignUp(head, alignment);
+        if (alignedHead + size > blockSize)
+        {
+          return false;
+        }
+        offset = alignedHead;
+        head = alignedHead + size;
+        liveCount++;
+        return true;
+      }
+
+      void free(VkDeviceSize) override
+      {
+        assert(liveCount > 0 && "Freeing from an empty linear block");
+        if (--liveCount == 0)
+        {
+          head = 0;
+        }
+      }
+
+      bool empty() const override { return liveCount == 0; }
+
+    private:
+      VkDeviceSize blockSize;
+      VkDeviceSize head = 0;
+      uint32_t liveCount = 0;
+    };
+
+    class BuddyMetadata : public CjhBlockMetadata
+    {
+    public:
+      static constexpr VkDeviceSize MIN_NODE_SIZE = 256;
+
+      explicit BuddyMetadata(VkDeviceSize size) : blockSize{size}
+      {
+        assert((size & (size - 1)) == 0 && size >= MIN_NODE_SIZE && "Buddy blocks must be a power of two");
+        freeNodes.resize(lastSetBit(size / MIN_NODE_SIZE) + 1);
+        freeNodes[0].insert(0);
+      }
+
+      bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) override
+      {
+        // nodes are aligned to their own size, so a large enough node satisfies any alignment
+        VkDeviceSize nodeSize = roundUpToPowerOfTwo(std::max({size, alignment, MIN_NODE_SIZE}));
+        if (nodeSize > blockSize)
+        {
+          return false;
+        }
+        uint32_t level = lastSetBit(blockSize / nodeSize);
+
+        uint32_t found = level + 1;
+        for (uint32_t l = level + 1; l-- > 0;)
+        {
+          if (!freeNodes[l].empty())
+          {
+            found = l;
+            break;
+          }
+        }
+        if (found > level)
+        {
+          return false;
+        }
+
+        VkDeviceSize node = *freeNodes[found].begin();
+        freeNodes[found].erase(freeNodes[found].begin());
+        // split down, returning the upper halves to the free lists
+        for (uint32_t l = found; l < level; l++)
+        {
+          freeNodes[l + 1].insert(node + (blockSize >> (l + 1)));
+        }
+
+        allocatedLevels[node] = level;
+        offset = node;
+        return true;
+      }
+
+      void free(VkDeviceSize offset) override
+      {
+        auto it = allocatedLevels.find(offset);
+        assert(it != allocatedLevels.end() && "Freeing an offset the buddy block never handed out");
+        uint32_t level = it->second;
+        allocatedLevels.erase(it);
+
+        VkDeviceSize node = offset;
+        while (level > 0)
+        {
+          VkDeviceSize buddy = node ^ (blockSize >> level);
+          auto buddyIt = freeNodes[level].find(buddy);
+          if (buddyIt == freeNodes[level].end())
+          {
+            break;
+          }
+          freeNodes[level].erase(buddyIt);
+          node = std::min(node, buddy);
+          level--;
+        }
+        freeNodes[level].insert(node);
+      }
+
+      bool empty() const override { return allocatedLevels.empty(); }
+
+    private:
+      VkDeviceSize blockSize;
+      // level 0 is the whole block, every level below halves the node size
+      std::vector<std::unordered_set<VkDeviceSize>> freeNodes;
+      std::unordered_map<VkDeviceSize, uint32_t> allocatedLevels;
+    };
+
+    class TlsfMetadata : public CjhBlockMetadata
+    {
+    public:
+      explicit TlsfMetadata(VkDeviceSize size)
+      {
+        std::fill(&freeHeads[0][0], &freeHeads[0][0] + FL_COUNT * SL_COUNT, NONE);
+        uint32_t node = createNode(0, size);
+        insertFree(node);
+      }
+
+      bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) override
+      {
+        // any free block this large fits the request after aligning its start
+        VkDeviceSize searchSize = size + alignment - 1;
+        uint32_t node = findFree(searchSize);
+        if (node == NONE)
+        {
+          return false;
+        }
+        removeFree(node);
+
+        VkDeviceSize alignedOffset = alignUp(nodes[node].offset, alignment);
+        VkDeviceSize padding = alignedOffset - nodes[node].offset;
+        if (padding > 0)
+        {
+          // the physical predecessor is never free (free neighbours are always merged), so the
+          // padding becomes a free block of its own
+          uint32_t front = createNode(nodes[node].offset, padding);
+          linkBefore(front, node);
+          nodes[node].offset += padding;
+          nodes[node].size -= padding;
+          insertFree(front);
+        }
+        if (nodes[node].size > size)
+        {
+          uint32_t back = createNode(nodes[node].offset + size, nodes[node].size - size);
+          linkAfter(back, node);
+          nodes[node].size = size;
+          insertFree(back);
+        }
+
+        allocatedNodes[nodes[node].offset] = node;
+        offset = nodes[node].offset;
+        return true;
+      }
+
+      void free(VkDeviceSize offset) override
+      {
+        auto it = allocatedNodes.find(offset);
+        assert(it != allocatedNodes.end() && "Freeing an offset the TLSF block never handed out");
+        uint32_t node = it->second;
+        allocatedNodes.erase(it);
+
+        uint32_t prev = nodes[node].prevPhysical;
+        if (prev != NONE && nodes[prev].isFree)
+        {
+          removeFree(prev);
+          nodes[prev].size += nodes[node].size;
+          unlink(node);
+          node = prev;
+        }
+        uint32_t next = nodes[node].nextPhysical;
+        if (next != NONE && nodes[next].isFree)
+        {
+          removeFree(next);
+          nodes[node].size += nodes[next].size;
+          unlink(next);
+        }
+        insertFree(node);
+      }
+
+      bool empty() const override { return allocatedNodes.empty(); }
+
+    private:
+      static constexpr uint32_t NONE = ~0u;
+      static constexpr uint32_t SL_LOG2 = 4;
+      static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+      // sizes below this are spread linearly over the second level of list 0
+      static constexpr uint32_t SMALL_LOG2 = 8;
+      static constexpr uint32_t FL_COUNT = 64 - SMALL_LOG2 + 1;
+
+      struct Node
+      {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32_t prevPhysical = NONE;
+        uint32_t nextPhysical = NONE;
+        uint32_t prevFree = NONE;
+        uint32_t nextFree = NONE;
+        bool isFree = false;
+      };
+
+      static void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl)
+      {
+        if (size < (VkDeviceSize{1} << SMALL_LOG2))
+        {
+          fl = 0;
+          sl = static_cast<uint32_t>(size >> (SMALL_LOG2 - SL_LOG2));
+        }
+        else
+        {
+          uint32_t log = lastSetBit(size);
+          fl = log - SMALL_LOG2 + 1;
+          sl = static_cast<uint32_t>(size >> (log - SL_LOG2)) & (SL_COUNT - 1);
+        }
+      }
+
+      uint32_t createNode(VkDeviceSize offset, VkDeviceSize size)
+      {
+        uint32_t index;
+        if (!unusedNodes.empty())
+        {
+          index = unusedNodes.back();
+          unusedNodes.pop_back();
+          nodes[index] = Node{};
+        }
+        else
+        {
+          index = static_cast<uint32_t>(nodes.size());
+          nodes.emplace_back();
+        }
+        nodes[index].offset = offset;
+        nodes[index].size = size;
+        return index;
+      }
+
+      void linkBefore(uint32_t node, uint32_t successor)
+      {
+        nodes[node].prevPhysical = nodes[successor].prevPhysical;
+        nodes[node].nextPhysical = successor;
+        if (nodes[successor].prevPhysical != NONE)
+        {
+          nodes[nodes[successor].prevPhysical].nextPhysical = node;
+        }
+        nodes[successor].prevPhysical = node;
+      }
+
+      void linkAfter(uint32_t node, uint32_t predecessor)
+      {
+        nodes[node].nextPhysical = nodes[predecessor].nextPhysical;
+        nodes[node].prevPhysical = predecessor;
+        if (nodes[predecessor].nextPhysical != NONE)
+        {
+          nodes[nodes[predecessor].nextPhysical].prevPhysical = node;
+        }
+        nodes[predecessor].nextPhysical = node;
+      }
+
+      void unlink(uint32_t node)
+      {
+        if (nodes[node].prevPhysical != NONE)
+        {
+          nodes[nodes[node].prevPhysical].nextPhysical = nodes[node].nextPhysical;
+        }
+        if (nodes[node].nextPhysical != NONE)
+        {
+          nodes[nodes[node].nextPhysical].prevPhysical = nodes[node].prevPhysical;
+        }
+        unusedNodes.push_back(node);
+      }
+
+      void insertFree(uint32_t node)
+      {
+        uint32_t fl, sl;
+        mapping(nodes[node].size, fl, sl);
+        uint32_t &head = freeHeads[fl][sl];
+        nodes[node].isFree = true;
+        nodes[node].prevFree = NONE;
+        nodes[node].nextFree = head;
+        if (head != NONE)
+        {
+          nodes[head].prevFree = node;
+        }
+        head = node;
+        flBitmap |= uint64_t{1} << fl;
+        slBitmaps[fl] |= 1u << sl;
+      }
+
+      void removeFree(uint32_t node)
+      {
+        uint32_t fl, sl;
+        mapping(nodes[node].size, fl, sl);
+        nodes[node].isFree = false;
+        if (nodes[node].prevFree != NONE)
+        {
+          nodes[nodes[node].prevFree].nextFree = nodes[node].nextFree;
+        }
+        else
+        {
+          freeHeads[fl][sl] = nodes[node].nextFree;
+        }
+        if (nodes[node].nextFree != NONE)
+        {
+          nodes[nodes[node].nextFree].prevFree = nodes[node].prevFree;
+        }
+        if (freeHeads[fl][sl] == NONE)
+        {
+          slBitmaps[fl] &= ~(1u << sl);
+          if (slBitmaps[fl] == 0)
+          {
+            flBitmap &= ~(uint64_t{1} << fl);
+          }
+        }
+      }
+
+      uint32_t findFree(VkDeviceSize size) const
+      {
+        // round up to the next list boundary so whatever the list holds is large enough
+        if (size >= (VkDeviceSize{1} << SMALL_LOG2))
+        {
+          size += (VkDeviceSize{1} << (lastSetBit(size) - SL_LOG2)) - 1;
+        }
+        else
+        {
+          size += (VkDeviceSize{1} << (SMALL_LOG2 - SL_LOG2)) - 1;
+        }
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+        if (fl >= FL_COUNT)
+        {
+          return NONE;
+        }
+
+        uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+        if (slMap == 0)
+        {
+          uint64_t flMap = fl + 1 < 64 ? flBitmap & (~uint64_t{0} << (fl + 1)) : 0;
+          if (flMap == 0)
+          {
+            return NONE;
+          }
+          fl = firstSetBit(flMap);
+          slMap = slBitmaps[fl];
+        }
+        return freeHeads[fl][firstSetBit(slMap)];
+      }
+
+      std::vector<Node> nodes;
+      std::vector<uint32_t> unusedNodes;
+      std::unordered_map<VkDeviceSize, uint32_t> allocatedNodes;
+      uint64_t flBitmap = 0;
+      uint32_t slBitmaps[FL_COUNT] = {};
+      uint32_t freeHeads[FL_COUNT][SL_COUNT];
+    };
+  } // namespace
+
+  class CjhMemoryBlock
+  {
+  public:
+    CjhMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void *mapped, std::unique_ptr<CjhBlockMetadata> metadata)
+        : memory{memory}, size{size}, mapped{mapped}, metadata{std::move(metadata)}
+    {
+    }
+
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;
+    std::unique_ptr<CjhBlockMetadata> metadata;
+    // key of the owning pool, dedicated blocks have no pool
+    uint32_t poolKey = 0;
+    bool dedicated = false;
+  };
+
+  namespace
+  {
+    void freeBlock(VkDevice device, CjhMemoryBlock &block)
+    {
+      if (block.mapped)
+      {
+        CjhAsyncIo::shared().unregisterBuffer(block.mapped);
+      }
+      vkFreeMemory(device, block.memory, nullptr);
+    }
+  } // namespace
+
+  CjhMemoryAllocator::CjhMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) : device{device}
+  {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bufferImageGranularity = properties.limits.bufferImageGranularity;
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+  }
+
+  CjhMemoryAllocator::~CjhMemoryAllocator()
+  {
+    assert(stats.allocationCount == 0 && "Memory allocator destroyed with live allocations");
+    for (auto &pool : pools)
+    {
+      for (auto &block : pool.second.blocks)
+      {
+        freeBlock(device, *block);
+      }
+    }
+  }
+
+  uint32_t CjhMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+  {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+      if ((typeFilter & (1 << i)) &&
+          (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      {
+        return i;
+      }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+
+  VkDeviceSize CjhMemoryAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const
+  {
+    // small heaps (e.g. the 256MB host visible device local window) get proportionally smaller blocks
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return roundDownToPowerOfTwo(std::min(DEFAULT_BLOCK_SIZE, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024)));
+  }
+
+  std::unique_ptr<CjhMemoryBlock> CjhMemoryAllocator::createBlock(
+      uint32_t memoryTypeIndex, VkDeviceSize size, Strategy strategy)
+  {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+      return nullptr;
+    }
+
+    // host visible blocks stay mapped for their whole lifetime, a memory object can only be mapped once
+    void *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+      if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+      {
+        vkFreeMemory(device, memory, nullptr);
+        throw std::runtime_error("failed to map memory block!");
+      }
+      // staging memory, cache reads land in it as fixed io_uring reads
+      CjhAsyncIo::shared().registerBuffer(mapped, static_cast<size_t>(size));
+    }
+
+    std::unique_ptr<CjhBlockMetadata> metadata;
+    switch (strategy)
+    {
+    case Strategy::Linear:
+      metadata = std::make_unique<LinearMetadata>(size);
+      break;
+    case Strategy::Buddy:
+      metadata = std::make_unique<BuddyMetadata>(size);
+      break;
+    case Strategy::Tlsf:
+      metadata = std::make_unique<TlsfMetadata>(size);
+      break;
+    }
+    return std::make_unique<CjhMemoryBlock>(memory, size, mapped, std::move(metadata));
+  }
+
+  CjhAllocation CjhMemoryAllocator::allocate(
+      const VkMemoryRequirements &requirements, const AllocationCreateInfo &createInfo)
+  {
+    uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, createInfo.properties);
+    VkDeviceSize blockSize = preferredBlockSize(memoryTypeIndex);
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    CjhAllocation allocation{};
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.size = requirements.size;
+
+    if (createInfo.dedicated || requirements.size > blockSize / 2)
+    {
+      auto block = createBlock(memoryTypeIndex, requirements.size, Strategy::Linear);
+      if (!block)
+      {
+        throw std::runtime_error("failed to allocate dedicated device memory!");
+      }
+      block->dedicated = true;
+      allocation.memory = block->memory;
+      allocation.mappedData = block->mapped;
+      allocation.block = block.release();
+
+      stats.dedicatedAllocationCount++;
+      stats.allocationCount++;
+      stats.reservedBytes += requirements.size;
+      stats.usedBytes += requirements.size;
+      return allocation;
+    }
+
+    // with a granularity of 1 buffers and optimal images may share blocks freely
+    uint32_t kind = bufferImageGranularity > 1 && createInfo.kind == ResourceKind::Optimal ? 1 : 0;
+    uint32_t poolKey = (memoryTypeIndex << 8) | (kind << 4) | static_cast<uint32_t>(createInfo.strategy);
+    auto poolIt = pools.find(poolKey);
+    if (poolIt == pools.end())
+    {
+      poolIt = pools.emplace(poolKey, Pool{memoryTypeIndex, createInfo.strategy, blockSize, {}}).first;
+    }
+    Pool &pool = poolIt->second;
+
+    VkDeviceSize offset = 0;
+    CjhMemoryBlock *target = nullptr;
+    for (auto &block : pool.blocks)
+    {
+      if (block->metadata->allocate(requirements.size, requirements.alignment, offset))
+      {
+        target = block.get();
+        break;
+      }
+    }
+
+    if (!target)
+    {
+      // fall back to smaller blocks when the heap is nearly exhausted
+      std::unique_ptr<CjhMemoryBlock> block;
+      for (VkDeviceSize size = pool.blockSize; !block && size >= requirements.size; size /= 2)
+      {
+        block = createBlock(memoryTypeIndex, size, pool.strategy);
+      }
+      if (!block || !block->metadata->allocate(requirements.size, requirements.alignment, offset))
+      {
+        throw std::runtime_error("failed to allocate device memory block!");
+      }
+      block->poolKey = poolKey;
+      stats.blockCount++;
+      stats.reservedBytes += block->size;
+      target = block.get();
+      pool.blocks.push_back(std::move(block));
+    }
+
+    allocation.memory = target->memory;
+    allocation.offset = offset;
+    allocation.mappedData = target->mapped ? static_cast<char *>(target->mapped) + offset : nullptr;
+    allocation.block = target;
+
+    stats.allocationCount++;
+    stats.usedBytes += requirements.size;
+    return allocation;
+  }
+
+  void CjhMemoryAllocator::free(CjhAllocation &allocation)
+  {
+    if (!allocation.block)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.allocationCount--;
+    stats.usedBytes -= allocation.size;
+
+    CjhMemoryBlock *block = allocation.block;
+    if (block->dedicated)
+    {
+      freeBlock(device, *block);
+      stats.dedicatedAllocationCount--;
+      stats.reservedBytes -= block->size;
+      delete block;
+    }
+    else
+    {
+      block->metadata->free(allocation.offset);
+
+      // keep one empty block per pool around so a streaming workload does not thrash vkAllocateMemory
+      if (block->metadata->empty())
+      {
+        auto &blocks = pools.at(block->poolKey).blocks;
+        size_t emptyCount = std::count_if(blocks.begin(), blocks.end(), [](const auto &b)
+                                          { return b->metadata->empty(); });
+        if (emptyCount > 1)
+        {
+          auto it = std::find_if(blocks.begin(), blocks.end(), [block](const auto &b)
+                                 { return b.get() == block; });
+          freeBlock(device, *block);
+          stats.blockCount--;
+          stats.reservedBytes -= block->size;
+          blocks.erase(it);
+        }
+      }
+    }
+    allocation = CjhAllocation{};
+  }
+
+  VkMappedMemoryRange CjhMemoryAllocator::mappedRange(
+      const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const
+  {
+    // ranges must start and end on nonCoherentAtomSize, clamped to the end of the memory object
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+    begin = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+    end = std::min(alignUp(end, nonCoherentAtomSize), allocation.block->size);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end - begin;
+    return range;
+  }
+
+  VkResult CjhMemoryAllocator::flush(const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset)
+  {
+    VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+    return vkFlushMappedMemoryRanges(device, 1, &range);
+  }
+
+  VkResult CjhMemoryAllocator::invalidate(const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset)
+  {
+    VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+    return vkInvalidateMappedMemoryRanges(device, 1, &range);
+  }
+
+  CjhMemoryAllocator::Stats CjhMemoryAllocator::getStats() const
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+  }
+
+} // namespace cjh
@@ -0,0 +1,112 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cjh
+{
+  class CjhMemoryBlock;
+
+  // A range of device memory handed out by CjhMemoryAllocator. Resources are bound at
+  // memory + offset; mappedData already points at offset for host visible memory.
+  struct CjhAllocation
+  {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *mappedData = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    CjhMemoryBlock *block = nullptr;
+  };
+
+  // Keeps large per memory type blocks and sub-allocates resources from them, so the number of
+  // vkAllocateMemory calls stays far below maxMemoryAllocationCount. Thread safe.
+  class CjhMemoryAllocator
+  {
+  public:
+    enum class Strategy
+    {
+      // bump pointer, the whole block is recycled once every allocation in it was freed;
+      // best for short lived staging memory
+      Linear,
+      // power of two splitting with buddy merging, constant time but wastes up to half a node
+      Buddy,
+      // two level segregated fit, good fit with immediate coalescing for long lived resources
+      Tlsf,
+    };
+
+    enum class ResourceKind
+    {
+      // buffers and linear tiled images
+      Linear,
+      // optimal tiled images
+      Optimal,
+    };
+
+    struct AllocationCreateInfo
+    {
+      VkMemoryPropertyFlags properties = 0;
+      ResourceKind kind = ResourceKind::Linear;
+      Strategy strategy = Strategy::Tlsf;
+      // skip the pools and give the resource its own VkDeviceMemory
+      bool dedicated = false;
+    };
+
+    struct Stats
+    {
+      uint32_t blockCount = 0;
+      uint32_t dedicatedAllocationCount = 0;
+      uint32_t allocationCount = 0;
+      VkDeviceSize reservedBytes = 0;
+      VkDeviceSize usedBytes = 0;
+    };
+
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    CjhMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~CjhMemoryAllocator();
+
+    CjhMemoryAllocator(const CjhMemoryAllocator &) = delete;
+    CjhMemoryAllocator &operator=(const CjhMemoryAllocator &) = delete;
+
+    CjhAllocation allocate(const VkMemoryRequirements &requirements, const AllocationCreateInfo &createInfo);
+    void free(CjhAllocation &allocation);
+
+    // flush / invalidate a range relative to the allocation, rounded to nonCoherentAtomSize
+    VkResult flush(const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset);
+    VkResult invalidate(const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset);
+
+    Stats getStats() const;
+
+  private:
+    struct Pool
+    {
+      uint32_t memoryTypeIndex;
+      Strategy strategy;
+      VkDeviceSize blockSize;
+      std::vector<std::unique_ptr<CjhMemoryBlock>> blocks;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+    std::unique_ptr<CjhMemoryBlock> createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, Strategy strategy);
+    VkMappedMemoryRange mappedRange(const CjhAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize bufferImageGranularity;
+    VkDeviceSize nonCoherentAtomSize;
+
+    mutable std::mutex mutex;
+    // keyed by memory type, resource kind and strategy; buffers and optimal images never share a
+    // block, which keeps bufferImageGranularity from ever applying between neighbours
+    std::map<uint32_t, Pool> pools;
+    Stats stats;
+  };
+} // namespace cjh
@@ -0,0 +1,282 @@
+#include "cjh_mesh_cache.hpp"
+
+#include "cjh_mapped_file.hpp"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+namespace cjh
+{
+  namespace
+  {
+    constexpr char CACHE_MAGIC[4] = {'C', 'J', 'H', 'M'};
+
+    static_assert(sizeof(CjhMeshCache::Header) % alignof(CjhModel::Vertex) == 0,
+                  "vertex data must stay aligned after the header");
+    static_assert(sizeof(CjhModel::Vertex) % alignof(uint32_t) == 0,
+                  "index data must stay aligned after the vertex data");
+
+    int64_t modifiedTime(const std::filesystem::path &path, std::error_code &ec)
+    {
+      return static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    }
+
+    // word-at-a-time hash; only used to tell whether a touched source actually changed
+    uint64_t hashBytes(const uint8_t *data, size_t size)
+    {
+      uint64_t hash = 0xcbf29ce484222325ull ^ size;
+      size_t i = 0;
+      for (; i + 8 <= size; i += 8)
+      {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+      }
+      for (; i < size; i++)
+      {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+      }
+      return hash;
+    }
+
+    // Sources that were touched without changing, by cache path, with the mtime their hash was
+    // checked at. Kept in memory: the cache may be mapped by other loads while it is checked, so
+    // its header is never rewritten in place.
+    struct VerifiedTimes
+    {
+      std::mutex mutex;
+      std::unordered_map<std::string, int64_t> times;
+    };
+
+    VerifiedTimes &verifiedTimes()
+    {
+      static VerifiedTimes verified;
+      return verified;
+    }
+  } // namespace
+
+  std::string CjhMeshCache::cachePathFor(const std::string &sourcePath)
+  {
+    return sourcePath + ".cjhmesh";
+  }
+
+  CjhMeshCache::CjhMeshCache(CjhVfs::File file)
+      : file{std::move(file)},
+        header{reinterpret_cast<const Header *>(this->file.data())}
+  {
+  }
+
+  const CjhModel::Vertex *CjhMeshCache::vertices() const
+  {
+    return reinterpret_cast<const CjhModel::Vertex *>(file.data() + sizeof(Header));
+  }
+
+  const uint32_t *CjhMeshCache::indices() const
+  {
+    return reinterpret_cast<const uint32_t *>(
+        file.data() + sizeof(Header) + header->vertexCount * sizeof(CjhModel::Vertex));
+  }
+
+  bool CjhMeshCache::readFreshHeader(const std::string &sourcePath, float weldEpsilon, Header &header)
+  {
+    std::error_code ec;
+    std::string cachePath = cachePathFor(sourcePath);
+    uint64_t cacheSize = std::filesystem::file_size(cachePath, ec);
+    if (ec)
+    {
+      return false;
+    }
+
+    uint64_t sourceSize = std::filesystem::file_size(sourcePath, ec);
+    if (ec)
+    {
+      return false;
+    }
+    int64_t sourceTime = modifiedTime(sourcePath, ec);
+    if (ec)
+    {
+      return false;
+    }
+
+    std::ifstream stream{cachePath, std::ios::binary};
+    stream.read(reinterpret_cast<char *>(&header), sizeof(Header));
+    if (!stream || !hasValidLayout(header, cacheSize, weldEpsilon) || header.sourceSize != sourceSize)
+    {
+      return false;
+    }
+    stream.close();
+
+    if (header.sourceModifiedTime != sourceTime)
+    {
+      VerifiedTimes &verified = verifiedTimes();
+      {
+        std::lock_guard<std::mutex> lock{verified.mutex};
+        auto it = verified.times.find(cachePath);
+        if (it != verified.times.end() && it->second == sourceTime)
+        {
+          return true;
+        }
+      }
+      // source was touched, only rebuild if its contents really changed
+      CjhMappedFile source{sourcePath};
+      if (hashBytes(source.data(), source.size()) != header.sourceHash)
+      {
+        return false;
+      }
+      std::lock_guard<std::mutex> lock{verified.mutex};
+      verified.times[cachePath] = sourceTime;
+    }
+    return true;
+  }
+
+  std::unique_ptr<CjhMeshCache> CjhMeshCache::open(const std::string &sourcePath, float weldEpsilon)
+  {
+    Header header;
+    if (!readFreshHeader(sourcePath, weldEpsilon, header))
+    {
+      return nullptr;
+    }
+
+    CjhVfs::File file;
+    try
+    {
+      auto mapping = std::make_shared<CjhMappedFile>(cachePathFor(sourcePath));
+      file = CjhVfs::File{mapping->data(), mapping->size(), mapping};
+    }
+    catch (const std::exception &)
+    {
+      return nullptr;
+    }
+    return fromData(std::move(file), weldEpsilon);
+  }
+
+  bool CjhMeshCache::locate(const std::string &sourcePath, float weldEpsilon, Location &location)
+  {
+    CjhVfs &vfs = CjhVfs::shared();
+    Header header;
+    CjhVfs::Location stored;
+    std::string loosePath = vfs.loosePath(sourcePath);
+    if (!loosePath.empty())
+    {
+      if (!readFreshHeader(loosePath, weldEpsilon, header))
+      {
+        return false;
+      }
+      location.path = cachePathFor(loosePath);
+    }
+    else
+    {
+      // only a stored entry has the arrays on disk as they are
+      if (!vfs.locate(cachePathFor(sourcePath), stored) || stored.compressed)
+      {
+        return false;
+      }
+      std::ifstream stream{stored.diskPath, std::ios::binary};
+      stream.seekg(static_cast<std::streamoff>(stored.offset));
+      stream.read(reinterpret_cast<char *>(&header), sizeof(Header));
+      if (!stream || !hasValidLayout(header, stored.size, weldEpsilon))
+      {
+        return false;
+      }
+      location.path = stored.diskPath;
+    }
+
+    location.vertexOffset = stored.offset + sizeof(Header);
+    location.vertexCount = static_cast<uint32_t>(header.vertexCount);
+    location.indexOffset = location.vertexOffset + header.vertexCount * sizeof(CjhModel::Vertex);
+    location.indexCount = static_cast<uint32_t>(header.indexCount);
+    location.bounds = boundsOf(header);
+    return true;
+  }
+
+  std::unique_ptr<CjhMeshCache> CjhMeshCache::fromData(CjhVfs::File file, float weldEpsilon)
+  {
+    Header header;
+    if (file.size() < sizeof(Header))
+    {
+      return nullptr;
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (!hasValidLayout(header, file.size(), weldEpsilon))
+    {
+      return nullptr;
+    }
+    return std::unique_ptr<CjhMeshCache>(new CjhMeshCache(std::move(file)));
+  }
+
+  CjhModel::Bounds CjhMeshCache::boundsOf(const Header &header)
+  {
+    CjhModel::Bounds bounds{};
+    std::memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    std::memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+    std::memcpy(&bounds.sphere, header.boundingSphere, sizeof(header.boundingSphere));
+    return bounds;
+  }
+
+  bool CjhMeshCache::hasValidLayout(const Header &header, uint64_t cacheSize, float weldEpsilon)
+  {
+    return std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+           header.version == VERSION &&
+           header.vertexStride == sizeof(CjhModel::Vertex) &&
+           header.indexStride == sizeof(uint32_t) &&
+           header.weldEpsilon == weldEpsilon &&
+           cacheSize == sizeof(Header) + header.vertexCount * sizeof(CjhModel::Vertex) +
+                              header.indexCount * sizeof(uint32_t);
+  }
+
+  void CjhMeshCache::write(
+      const std::string &sourcePath,
+      float weldEpsilon,
+      const std::vector<CjhModel::Vertex> &vertices,
+      const std::vector<uint32_t> &indices)
+  {
+    std::error_code ec;
+    Header header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = VERSION;
+    header.vertexStride = sizeof(CjhModel::Vertex);
+    header.indexStride = sizeof(uint32_t);
+    header.sourceModifiedTime = modifiedTime(sourcePath, ec);
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+    header.weldEpsilon = weldEpsilon;
+    CjhModel::Bounds bounds = CjhModel::Bounds::compute(vertices.data(), static_cast<uint32_t>(vertices.size()));
+    std::memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+    std::memcpy(header.boundingSphere, &bounds.sphere, sizeof(header.boundingSphere));
+    {
+      CjhMappedFile source{sourcePath};
+      header.sourceSize = source.size();
+      header.sourceHash = hashBytes(source.data(), source.size());
+    }
+
+    // write next to the final file and rename, so a crash never leaves a torn cache behind
+    std::string cachePath = cachePathFor(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    {
+      std::ofstream stream{tempPath, std::ios::binary | std::ios::trunc};
+      stream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+      stream.write(reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(CjhModel::Vertex));
+      stream.write(reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(uint32_t));
+      if (!stream)
+      {
+        std::cout << "failed to write mesh cache: " << cachePath << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec)
+    {
+      std::cout << "failed to write mesh cache: " << cachePath << std::endl;
+      std::filesystem::remove(tempPath, ec);
+    }
+  }
+
+} // namespace cjh
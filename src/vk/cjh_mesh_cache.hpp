@@ -0,0 +1,91 @@
+#pragma once
+
+#include "cjh_model.hpp"
+#include "cjh_vfs.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  // Binary sidecar (<source>.cjhmesh) holding the deduplicated vertex and index arrays of a
+  // source mesh. A valid cache is memory-mapped (or viewed inside an archive) and its arrays are
+  // read in place.
+  class CjhMeshCache
+  {
+  public:
+    // bump whenever CjhModel::Vertex or the file layout changes
+    static constexpr uint32_t VERSION = 3;
+
+    struct Header
+    {
+      char magic[4];
+      uint32_t version;
+      uint32_t vertexStride;
+      uint32_t indexStride;
+      uint64_t sourceSize;
+      int64_t sourceModifiedTime;
+      uint64_t sourceHash;
+      uint64_t vertexCount;
+      uint64_t indexCount;
+      float weldEpsilon;
+      uint32_t reserved;
+      // CjhModel::Bounds of the vertices, so loads never read the arrays back to compute them
+      float boundsMin[3];
+      float boundsMax[3];
+      float boundingSphere[4];
+    };
+
+    // where the arrays of a usable cache are on disk, for reading them straight into staging memory
+    struct Location
+    {
+      std::string path;
+      uint64_t vertexOffset;
+      uint32_t vertexCount;
+      uint64_t indexOffset;
+      uint32_t indexCount;
+      CjhModel::Bounds bounds;
+    };
+
+    // Maps the cache of the given source file. Returns nullptr when there is no cache or it is
+    // stale. The source is only hashed when its size matches but its mtime does not.
+    static std::unique_ptr<CjhMeshCache> open(const std::string &sourcePath, float weldEpsilon = 0.0f);
+    // Cache whose bytes are already at hand, e.g. packed into an archive next to its source (the
+    // pak builder only packs sidecars that were fresh). Only the layout is checked, returns nullptr
+    // if it does not fit.
+    static std::unique_ptr<CjhMeshCache> fromData(CjhVfs::File file, float weldEpsilon = 0.0f);
+    // Finds the cache of a source given as a CjhVfs path without mapping it: a loose source gets
+    // the checks of open(), a packed one those of fromData(). Compressed entries are skipped.
+    static bool locate(const std::string &sourcePath, float weldEpsilon, Location &location);
+    static void write(
+        const std::string &sourcePath,
+        float weldEpsilon,
+        const std::vector<CjhModel::Vertex> &vertices,
+        const std::vector<uint32_t> &indices);
+    static std::string cachePathFor(const std::string &sourcePath);
+
+    CjhMeshCache(const CjhMeshCache &) = delete;
+    CjhMeshCache &operator=(const CjhMeshCache &) = delete;
+
+    const CjhModel::Vertex *vertices() const;
+    const uint32_t *indices() const;
+    uint32_t vertexCount() const { return static_cast<uint32_t>(header->vertexCount); }
+    uint32_t indexCount() const { return static_cast<uint32_t>(header->indexCount); }
+    CjhModel::Bounds bounds() const { return boundsOf(*header); }
+
+  private:
+    CjhMeshCache(CjhVfs::File file);
+
+    static CjhModel::Bounds boundsOf(const Header &header);
+    // matches this build, weldEpsilon and the size of the cache
+    static bool hasValidLayout(const Header &header, uint64_t cacheSize, float weldEpsilon);
+    // header of the loose cache of sourcePath if it is fresh; a touched but unchanged source is
+    // hashed once per run, the header keeps its old mtime
+    static bool readFreshHeader(const std::string &sourcePath, float weldEpsilon, Header &header);
+
+    CjhVfs::File file;
+    const Header *header;
+  };
+} // namespace cjh
@@ -0,0 +1,196 @@
+#include "cjh_mip_generator.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJH_MIP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    // below this many destination texels per job the threads cost more than they save
+    constexpr uint32_t MIN_TEXELS_PER_JOB = 16 * 1024;
+
+    // channels are filtered as 12 bit linear values; four of them still fit a 16 bit lane
+    constexpr uint32_t LINEAR_MAX = 4095;
+
+    struct ConversionTables
+    {
+      uint16_t toLinear[256];
+      uint8_t fromLinear[LINEAR_MAX + 1];
+    };
+
+    ConversionTables makeTables(bool srgb)
+    {
+      ConversionTables tables{};
+      for (uint32_t i = 0; i < 256; i++)
+      {
+        float value = i / 255.0f;
+        if (srgb)
+        {
+          value = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        tables.toLinear[i] = static_cast<uint16_t>(value * LINEAR_MAX + 0.5f);
+      }
+      for (uint32_t i = 0; i <= LINEAR_MAX; i++)
+      {
+        float value = static_cast<float>(i) / LINEAR_MAX;
+        if (srgb)
+        {
+          value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+        tables.fromLinear[i] = static_cast<uint8_t>(std::min(value, 1.0f) * 255.0f + 0.5f);
+      }
+      return tables;
+    }
+
+    const ConversionTables &conversionTables(bool srgb)
+    {
+      static const ConversionTables srgbTables = makeTables(true);
+      static const ConversionTables unormTables = makeTables(false);
+      return srgb ? srgbTables : unormTables;
+    }
+
+    void expandRow(const uint8_t *src, uint32_t width, const ConversionTables &color, const ConversionTables &alpha, uint16_t *dst)
+    {
+      for (uint32_t i = 0; i < width * 4; i += 4)
+      {
+        dst[i + 0] = color.toLinear[src[i + 0]];
+        dst[i + 1] = color.toLinear[src[i + 1]];
+        dst[i + 2] = color.toLinear[src[i + 2]];
+        dst[i + 3] = alpha.toLinear[src[i + 3]];
+      }
+    }
+
+    // averages the 2x2 footprint of every destination texel of one row
+    void filterRow(const uint16_t *row0, const uint16_t *row1, uint32_t srcWidth, uint32_t dstWidth, uint16_t *dst)
+    {
+      uint32_t x = 0;
+#if CJH_MIP_SSE2
+      if (srcWidth >= 2)
+      {
+        const __m128i rounding = _mm_set1_epi16(2);
+        // two destination texels from four source texels per iteration
+        for (; x + 2 <= dstWidth; x += 2)
+        {
+          const __m128i *a = reinterpret_cast<const __m128i *>(row0 + x * 8);
+          const __m128i *b = reinterpret_cast<const __m128i *>(row1 + x * 8);
+          __m128i left = _mm_add_epi16(_mm_loadu_si128(a), _mm_loadu_si128(b));
+          __m128i right = _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+          __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+          sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), sum);
+        }
+      }
+#endif
+      for (; x < dstWidth; x++)
+      {
+        uint32_t x0 = x * 2;
+        uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+          uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+          dst[x * 4 + c] = static_cast<uint16_t>((sum + 2) >> 2);
+        }
+      }
+    }
+
+    void downsampleRows(
+        const uint8_t *src,
+        uint32_t srcWidth,
+        uint32_t srcHeight,
+        uint8_t *dst,
+        uint32_t dstWidth,
+        uint32_t rowBegin,
+        uint32_t rowEnd,
+        bool srgb)
+    {
+      const ConversionTables &color = conversionTables(srgb);
+      const ConversionTables &alpha = conversionTables(false);
+      std::vector<uint16_t> row0(srcWidth * 4);
+      std::vector<uint16_t> row1(srcWidth * 4);
+      std::vector<uint16_t> filtered(dstWidth * 4);
+
+      for (uint32_t y = rowBegin; y < rowEnd; y++)
+      {
+        uint32_t y0 = y * 2;
+        uint32_t y1 = std::min(y0 + 1, srcHeight - 1);
+        expandRow(src + static_cast<size_t>(y0) * srcWidth * 4, srcWidth, color, alpha, row0.data());
+        expandRow(src + static_cast<size_t>(y1) * srcWidth * 4, srcWidth, color, alpha, row1.data());
+        filterRow(row0.data(), row1.data(), srcWidth, dstWidth, filtered.data());
+
+        uint8_t *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        for (uint32_t i = 0; i < dstWidth * 4; i += 4)
+        {
+          out[i + 0] = color.fromLinear[filtered[i + 0]];
+          out[i + 1] = color.fromLinear[filtered[i + 1]];
+          out[i + 2] = color.fromLinear[filtered[i + 2]];
+          out[i + 3] = alpha.fromLinear[filtered[i + 3]];
+        }
+      }
+    }
+  } // namespace
+
+  uint32_t CjhMipGenerator::levelCount(uint32_t width, uint32_t height)
+  {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+    {
+      levels++;
+    }
+    return levels;
+  }
+
+  CjhMipGenerator::Result CjhMipGenerator::generate(
+      const uint8_t *pixels,
+      uint32_t width,
+      uint32_t height,
+      bool srgb,
+      CjhThreadPool &pool)
+  {
+    Result result;
+    uint32_t count = levelCount(width, height);
+    result.levels.reserve(count);
+    size_t totalSize = 0;
+    for (uint32_t level = 0; level < count; level++)
+    {
+      uint32_t levelWidth = std::max(width >> level, 1u);
+      uint32_t levelHeight = std::max(height >> level, 1u);
+      size_t size = static_cast<size_t>(levelWidth) * levelHeight * 4;
+      result.levels.push_back({levelWidth, levelHeight, totalSize, size});
+      totalSize += size;
+    }
+
+    result.pixels.resize(totalSize);
+    memcpy(result.pixels.data(), pixels, result.levels[0].size);
+
+    for (uint32_t level = 1; level < count; level++)
+    {
+      const Level &source = result.levels[level - 1];
+      const Level &target = result.levels[level];
+      const uint8_t *src = result.pixels.data() + source.offset;
+      uint8_t *dst = result.pixels.data() + target.offset;
+
+      uint32_t rowsPerJob = std::max(MIN_TEXELS_PER_JOB / target.width, 1u);
+      uint32_t jobCount = (target.height + rowsPerJob - 1) / rowsPerJob;
+      if (jobCount == 1)
+      {
+        downsampleRows(src, source.width, source.height, dst, target.width, 0, target.height, srgb);
+        continue;
+      }
+      pool.parallelFor(jobCount, [&](uint32_t job)
+                       {
+        uint32_t rowBegin = job * rowsPerJob;
+        uint32_t rowEnd = std::min(rowBegin + rowsPerJob, target.height);
+        downsampleRows(src, source.width, source.height, dst, target.width, rowBegin, rowEnd, srgb); });
+    }
+    return result;
+  }
+
+} // namespace cjh
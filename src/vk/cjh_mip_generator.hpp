@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cjh
+{
+  // CPU mip chain generation for tightly packed RGBA8 images, used when the GPU cannot blit the
+  // texture format with linear filtering. Each level is a 2x2 box filter of the previous one
+  // (odd edges are dropped, a 1 texel wide side is repeated), averaged in linear space when the
+  // data is sRGB. Rows of a level are filtered in parallel. No Vulkan dependency.
+  class CjhMipGenerator
+  {
+  public:
+    struct Level
+    {
+      uint32_t width;
+      uint32_t height;
+      size_t offset; // into Result::pixels
+      size_t size;
+    };
+
+    struct Result
+    {
+      std::vector<uint8_t> pixels{}; // every level back to back, level 0 first
+      std::vector<Level> levels{};
+    };
+
+    // floor(log2(max(width, height))) + 1
+    static uint32_t levelCount(uint32_t width, uint32_t height);
+
+    static Result generate(
+        const uint8_t *pixels,
+        uint32_t width,
+        uint32_t height,
+        bool srgb,
+        CjhThreadPool &pool = CjhThreadPool::shared());
+  };
+} // namespace cjh
@@ -1,72 +1,301 @@
 #include "cjh_model.hpp"
 
-#include "cjh_utils.hpp"
-
-// libs
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include "cjh_async_io.hpp"
+#include "cjh_mesh_cache.hpp"
+#include "cjh_obj_parser.hpp"
+#include "cjh_staging_ring.hpp"
+#include "cjh_vertex_weld.hpp"
+#include "cjh_vfs.hpp"
 
 // std
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
-
-#ifndef MODEL_PATH
-#define MODEL_PATH "../"
-#endif
 
-namespace std
+namespace cjh
 {
-  template <>
-  struct hash<cjh::CjhModel::Vertex>
+  namespace
   {
-    size_t operator()(cjh::CjhModel::Vertex const &vertex) const
+    // a loose source keeps its sidecar next to it on disk, a packed one next to it in the archive
+    std::unique_ptr<CjhMeshCache> openMeshCache(const std::string &filepath, float weldEpsilon = 0.0f)
     {
-      size_t seed = 0;
-      cjh::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-      return seed;
+      CjhVfs &vfs = CjhVfs::shared();
+      std::string loosePath = vfs.loosePath(filepath);
+      if (!loosePath.empty())
+      {
+        return CjhMeshCache::open(loosePath, weldEpsilon);
+      }
+      if (CjhVfs::File packed = vfs.tryOpen(CjhMeshCache::cachePathFor(filepath)))
+      {
+        return CjhMeshCache::fromData(std::move(packed), weldEpsilon);
+      }
+      return nullptr;
     }
-  };
-} // namespace std
+  } // namespace
+
+  CjhModel::CjhModel(CjhDevice &device, const CjhModel::Builder &builder, CjhGeometryArena *geometryArena)
+      : CjhModel{
+            device,
+            builder.vertices.data(),
+            static_cast<uint32_t>(builder.vertices.size()),
+            builder.indices.data(),
+            static_cast<uint32_t>(builder.indices.size()),
+            geometryArena}
+  {
+  }
 
-namespace cjh
-{
+  CjhModel::CjhModel(
+      CjhDevice &device,
+      const Vertex *vertices,
+      uint32_t vertexCount,
+      const uint32_t *indices,
+      uint32_t indexCount,
+      CjhGeometryArena *geometryArena)
+      : cjhDevice{device}
+  {
+    bounds = Bounds::compute(vertices, vertexCount);
+    allocateFromArena(geometryArena, vertexCount, indexCount);
+    createVertexBuffers(vertices, vertexCount);
+    createIndexBuffers(indices, indexCount);
+  }
+
+  CjhModel::CjhModel(CjhDevice &device, StagedData stagedData, CjhGeometryArena *geometryArena)
+      : cjhDevice{device}
+  {
+    vertexCount = stagedData.vertexCount;
+    assert(vertexCount >= 3 && "Vertex count must be at least 3");
+    indexCount = stagedData.indexCount;
+    bounds = stagedData.bounds;
+    hasIndexBuffer = indexCount > 0;
+    allocateFromArena(geometryArena, vertexCount, indexCount);
+
+    CjhStagingRing &stagingRing = cjhDevice.stagingRing();
+    if (this->geometryArena)
+    {
+      stagingRing.copyBuffer(
+          std::move(stagedData.vertexStaging),
+          this->geometryArena->getVertexBuffer(),
+          sizeof(Vertex) * vertexCount,
+          sizeof(Vertex) * vertexRange.first);
+      if (hasIndexBuffer)
+      {
+        stagingRing.copyBuffer(
+            std::move(stagedData.indexStaging),
+            this->geometryArena->getIndexBuffer(),
+            sizeof(uint32_t) * indexCount,
+            sizeof(uint32_t) * indexRange.first);
+      }
+      return;
+    }
+
+    vertexBuffer = std::make_unique<CjhBuffer>(
+        cjhDevice,
+        sizeof(Vertex),
+        vertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    stagingRing.copyBuffer(
+        std::move(stagedData.vertexStaging), vertexBuffer->getBuffer(), sizeof(Vertex) * vertexCount);
+
+    if (hasIndexBuffer)
+    {
+      indexBuffer = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          sizeof(uint32_t),
+          indexCount,
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      stagingRing.copyBuffer(
+          std::move(stagedData.indexStaging), indexBuffer->getBuffer(), sizeof(uint32_t) * indexCount);
+    }
+  }
+
+  void CjhModel::allocateFromArena(CjhGeometryArena *arena, uint32_t vertexCount, uint32_t indexCount)
+  {
+    if (arena && arena->allocate(vertexCount, indexCount, vertexRange, indexRange))
+    {
+      geometryArena = arena;
+    }
+  }
+
+  CjhModel::StagedData CjhModel::stage(CjhDevice &device, const Builder &builder)
+  {
+    return stage(
+        device,
+        builder.vertices.data(),
+        static_cast<uint32_t>(builder.vertices.size()),
+        builder.indices.data(),
+        static_cast<uint32_t>(builder.indices.size()),
+        Bounds::compute(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size())));
+  }
+
+  CjhModel::StagedData CjhModel::stageFromFile(
+      CjhDevice &device, const std::string &filepath, const CjhVfs::File &source)
+  {
+    if (auto cache = openMeshCache(filepath))
+    {
+      return stage(
+          device, cache->vertices(), cache->vertexCount(), cache->indices(), cache->indexCount(), cache->bounds());
+    }
+
+    Builder builder{};
+    builder.loadModel(filepath, source);
+    StagedData stagedData = stage(device, builder);
+    stagedData.bytesCopied += source.size() + builder.bytesCopied;
+    return stagedData;
+  }
+
+  bool CjhModel::stageFromMeshCacheAsync(
+      CjhDevice &device,
+      const std::string &filepath,
+      CjhAsyncIo &io,
+      std::function<void(StagedData)> onStaged)
+  {
+    CjhMeshCache::Location cache;
+    if (!CjhMeshCache::locate(filepath, 0.0f, cache) || cache.vertexCount < 3)
+    {
+      return false;
+    }
+
+    auto stagedData = std::make_shared<StagedData>();
+    stagedData->vertexCount = cache.vertexCount;
+    // from the cache header, the staging memory may be write combined and slow to read back
+    stagedData->bounds = cache.bounds;
+    stagedData->vertexStaging = createStagingBuffer(device, nullptr, sizeof(Vertex), cache.vertexCount);
+    stagedData->indexCount = cache.indexCount;
+    if (cache.indexCount > 0)
+    {
+      stagedData->indexStaging = createStagingBuffer(device, nullptr, sizeof(uint32_t), cache.indexCount);
+    }
+    uint64_t vertexBytes = static_cast<uint64_t>(cache.vertexCount) * sizeof(Vertex);
+    uint64_t indexBytes = static_cast<uint64_t>(cache.indexCount) * sizeof(uint32_t);
+
+    // the last of the reads hands the staged data over
+    struct PendingReads
+    {
+      std::atomic<uint32_t> remaining;
+      std::atomic<bool> failed{false};
+      std::atomic<uint64_t> bytesRead{0};
+    };
+    auto pending = std::make_shared<PendingReads>();
+    pending->remaining = cache.indexCount > 0 ? 2 : 1;
+    auto readInto = [&](uint64_t offset, uint64_t size, void *destination)
+    {
+      auto onRead = [stagedData, pending, size, onStaged](const CjhAsyncIo::Result &result)
+      {
+        if (result.error != 0 || result.bytesRead != size)
+        {
+          pending->failed = true;
+        }
+        pending->bytesRead += result.bytesRead;
+        if (--pending->remaining == 0)
+        {
+          // the reads are the only writes on this path
+          stagedData->bytesCopied = pending->bytesRead;
+          onStaged(pending->failed ? StagedData{} : std::move(*stagedData));
+        }
+      };
+      try
+      {
+        io.read(cache.path, offset, size, destination, onRead);
+      }
+      catch (const std::exception &)
+      {
+        onRead({0, EIO});
+      }
+    };
+    readInto(cache.vertexOffset, vertexBytes, stagedData->vertexStaging->getMappedMemory());
+    if (cache.indexCount > 0)
+    {
+      readInto(cache.indexOffset, indexBytes, stagedData->indexStaging->getMappedMemory());
+    }
+    return true;
+  }
+
+  CjhModel::StagedData CjhModel::stage(
+      CjhDevice &device,
+      const Vertex *vertices,
+      uint32_t vertexCount,
+      const uint32_t *indices,
+      uint32_t indexCount,
+      const Bounds &bounds)
+  {
+    StagedData stagedData{};
+    stagedData.vertexCount = vertexCount;
+    stagedData.vertexStaging = createStagingBuffer(device, vertices, sizeof(Vertex), vertexCount);
+    stagedData.bounds = bounds;
+    stagedData.indexCount = indexCount;
+    if (indexCount > 0)
+    {
+      stagedData.indexStaging = createStagingBuffer(device, indices, sizeof(uint32_t), indexCount);
+    }
+    stagedData.bytesCopied = static_cast<uint64_t>(vertexCount) * sizeof(Vertex) +
+                             static_cast<uint64_t>(indexCount) * sizeof(uint32_t);
+    return stagedData;
+  }
+
+  std::unique_ptr<CjhBuffer> CjhModel::createStagingBuffer(
+      CjhDevice &device, const void *data, uint32_t instanceSize, uint32_t instanceCount)
+  {
+    auto stagingBuffer = std::make_unique<CjhBuffer>(
+        device,
+        instanceSize,
+        instanceCount,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    stagingBuffer->map();
+    if (data)
+    {
+      stagingBuffer->writeToBuffer(const_cast<void *>(data));
+    }
+    return stagingBuffer;
+  }
 
-  CjhModel::CjhModel(CjhDevice &device, const CjhModel::Builder &builder) : cjhDevice{device}
+  uint32_t CjhModel::nextMeshId()
   {
-    createVertexBuffers(builder.vertices);
-    createIndexBuffers(builder.indices);
+    static std::atomic<uint32_t> counter{0};
+    return counter++;
   }
 
-  CjhModel::~CjhModel() {}
+  CjhModel::~CjhModel()
+  {
+    if (geometryArena)
+    {
+      geometryArena->free(vertexRange, indexRange);
+    }
+  }
 
   std::unique_ptr<CjhModel> CjhModel::createModelFromFile(
-      CjhDevice &device, const std::string &filepath)
+      CjhDevice &device, const std::string &filepath, CjhGeometryArena *geometryArena)
   {
+    // warm path: upload straight out of the mapped cache without building a Builder
+    if (auto cache = openMeshCache(filepath))
+    {
+      return std::make_unique<CjhModel>(
+          device, cache->vertices(), cache->vertexCount(), cache->indices(), cache->indexCount(), geometryArena);
+    }
+
     Builder builder{};
     builder.loadModel(filepath);
-    return std::make_unique<CjhModel>(device, builder);
+    return std::make_unique<CjhModel>(device, builder, geometryArena);
   }
 
-  void CjhModel::createVertexBuffers(const std::vector<Vertex> &vertices)
+  void CjhModel::createVertexBuffers(const Vertex *vertices, uint32_t vertexCount)
   {
-    vertexCount = static_cast<uint32_t>(vertices.size());
+    this->vertexCount = vertexCount;
     assert(vertexCount >= 3 && "Vertex count must be at least 3");
     VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
     uint32_t vertexSize = sizeof(vertices[0]);
 
-    CjhBuffer stagingBuffer{
-        cjhDevice,
-        vertexSize,
-        vertexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)vertices.data());
+    if (geometryArena)
+    {
+      cjhDevice.stagingRing().uploadBuffer(
+          vertices, bufferSize, geometryArena->getVertexBuffer(), vertexSize * vertexRange.first);
+      return;
+    }
 
     vertexBuffer = std::make_unique<CjhBuffer>(
         cjhDevice,
@@ -75,12 +304,12 @@ namespace cjh
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    cjhDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+    cjhDevice.stagingRing().uploadBuffer(vertices, bufferSize, vertexBuffer->getBuffer());
   }
 
-  void CjhModel::createIndexBuffers(const std::vector<uint32_t> &indices)
+  void CjhModel::createIndexBuffers(const uint32_t *indices, uint32_t indexCount)
   {
-    indexCount = static_cast<uint32_t>(indices.size());
+    this->indexCount = indexCount;
     hasIndexBuffer = indexCount > 0;
 
     if (!hasIndexBuffer)
@@ -90,16 +319,12 @@ namespace cjh
     VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
     uint32_t indexSize = sizeof(indices[0]);
 
-    CjhBuffer stagingBuffer{
-        cjhDevice,
-        indexSize,
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)indices.data());
+    if (geometryArena)
+    {
+      cjhDevice.stagingRing().uploadBuffer(
+          indices, bufferSize, geometryArena->getIndexBuffer(), indexSize * indexRange.first);
+      return;
+    }
 
     indexBuffer = std::make_unique<CjhBuffer>(
         cjhDevice,
@@ -108,23 +333,36 @@ namespace cjh
         VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    cjhDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+    cjhDevice.stagingRing().uploadBuffer(indices, bufferSize, indexBuffer->getBuffer());
   }
 
-  void CjhModel::draw(VkCommandBuffer commandBuffer)
+  void CjhModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
   {
+    // both ranges start at 0 for models with their own buffers
     if (hasIndexBuffer)
     {
-      vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+      vkCmdDrawIndexed(
+          commandBuffer,
+          indexCount,
+          instanceCount,
+          indexRange.first,
+          static_cast<int32_t>(vertexRange.first),
+          firstInstance);
     }
     else
     {
-      vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+      vkCmdDraw(commandBuffer, vertexCount, instanceCount, vertexRange.first, firstInstance);
     }
   }
 
   void CjhModel::bind(VkCommandBuffer commandBuffer)
   {
+    if (geometryArena)
+    {
+      geometryArena->bind(commandBuffer);
+      return;
+    }
+
     VkBuffer buffers[] = {vertexBuffer->getBuffer()};
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
@@ -154,71 +392,151 @@ namespace cjh
     return attributeDescriptions;
   }
 
-  void CjhModel::Builder::loadModel(const std::string &filepath)
+  std::vector<VkVertexInputBindingDescription> CjhModel::Instance::getBindingDescriptions()
   {
-    Timer timer;
-    std::string modelPath = MODEL_PATH + filepath;
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+    bindingDescriptions[0].binding = 1;
+    bindingDescriptions[0].stride = sizeof(Instance);
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return bindingDescriptions;
+  }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str()))
+  std::vector<VkVertexInputAttributeDescription> CjhModel::Instance::getAttributeDescriptions()
+  {
+    // a mat4 attribute takes one location per column
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+    for (uint32_t column = 0; column < 4; column++)
     {
-      throw std::runtime_error(warn + err);
+      attributeDescriptions.push_back(
+          {4 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+           static_cast<uint32_t>(offsetof(Instance, modelMatrix) + column * sizeof(glm::vec4))});
     }
+    for (uint32_t column = 0; column < 4; column++)
+    {
+      attributeDescriptions.push_back(
+          {8 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+           static_cast<uint32_t>(offsetof(Instance, normalMatrix) + column * sizeof(glm::vec4))});
+    }
+    return attributeDescriptions;
+  }
+
+  CjhModel::Bounds CjhModel::Bounds::compute(const Vertex *vertices, uint32_t vertexCount)
+  {
+    Bounds bounds{};
+    if (vertexCount == 0)
+    {
+      return bounds;
+    }
+    bounds.min = vertices[0].position;
+    bounds.max = vertices[0].position;
+    for (uint32_t i = 1; i < vertexCount; i++)
+    {
+      bounds.min = glm::min(bounds.min, vertices[i].position);
+      bounds.max = glm::max(bounds.max, vertices[i].position);
+    }
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radiusSquared = 0.f;
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+      glm::vec3 offset = vertices[i].position - center;
+      radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.sphere = glm::vec4{center, std::sqrt(radiusSquared)};
+    return bounds;
+  }
+
+  CjhModel::Bounds CjhModel::Bounds::transformed(const glm::mat4 &transform) const
+  {
+    glm::vec3 center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.f));
+    glm::vec3 extent = (max - min) * 0.5f;
+    // every world axis gets the absolute contribution of the three local axes
+    glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x +
+                            glm::abs(glm::vec3(transform[1])) * extent.y +
+                            glm::abs(glm::vec3(transform[2])) * extent.z;
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+                           std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    Bounds world{};
+    world.min = center - worldExtent;
+    world.max = center + worldExtent;
+    world.sphere = glm::vec4{glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * scale};
+    return world;
+  }
+
+  void CjhModel::Builder::loadModel(const std::string &filepath, const CjhVfs::File &source)
+  {
+    Timer timer;
 
     vertices.clear();
     indices.clear();
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    for (const auto &shape : shapes)
+    if (auto cache = openMeshCache(filepath, weldEpsilon))
     {
-      for (const auto &index : shape.mesh.indices)
-      {
-        Vertex vertex{};
+      vertices.assign(cache->vertices(), cache->vertices() + cache->vertexCount());
+      indices.assign(cache->indices(), cache->indices() + cache->indexCount());
+      bytesCopied = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+      return;
+    }
 
-        if (index.vertex_index >= 0)
-        {
-          vertex.position = {
-              attrib.vertices[3 * index.vertex_index + 0],
-              attrib.vertices[3 * index.vertex_index + 1],
-              attrib.vertices[3 * index.vertex_index + 2],
-          };
-          vertex.color = {
-              attrib.colors[3 * index.vertex_index + 0],
-              attrib.colors[3 * index.vertex_index + 1],
-              attrib.colors[3 * index.vertex_index + 2],
-          };
-        }
+    CjhObjParser::Result attrib =
+        source ? CjhObjParser::parse(reinterpret_cast<const char *>(source.data()), source.size())
+               : CjhObjParser::parseFile(filepath);
 
-        if (index.normal_index >= 0)
-        {
-          vertex.normal = {
-              attrib.normals[3 * index.normal_index + 0],
-              attrib.normals[3 * index.normal_index + 1],
-              attrib.normals[3 * index.normal_index + 2],
-          };
-        }
+    indices.reserve(attrib.indices.size());
+    CjhVertexWeldTable uniqueVertices{vertices, attrib.positions.size() / 3, weldEpsilon};
+    bytesCopied = attrib.bytesCopied;
+    size_t vertexCapacity = vertices.capacity();
+    for (const auto &index : attrib.indices)
+    {
+      Vertex vertex{};
 
-        if (index.texcoord_index >= 0)
-        {
-          vertex.uv = {
-              attrib.texcoords[2 * index.texcoord_index + 0],
-              attrib.texcoords[2 * index.texcoord_index + 1],
-          };
-        }
+      if (index.vertex >= 0)
+      {
+        vertex.position = {
+            attrib.positions[3 * index.vertex + 0],
+            attrib.positions[3 * index.vertex + 1],
+            attrib.positions[3 * index.vertex + 2],
+        };
+        vertex.color = {
+            attrib.colors[3 * index.vertex + 0],
+            attrib.colors[3 * index.vertex + 1],
+            attrib.colors[3 * index.vertex + 2],
+        };
+      }
 
-        if (uniqueVertices.count(vertex) == 0)
-        {
-          uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-          // vertices.push_back(vertex);
-          vertices.emplace_back(std::move(vertex));
-        }
-        // indices.push_back(uniqueVertices[vertex]);
-        indices.emplace_back(std::move(uniqueVertices[vertex]));
+      if (index.normal >= 0)
+      {
+        vertex.normal = {
+            attrib.normals[3 * index.normal + 0],
+            attrib.normals[3 * index.normal + 1],
+            attrib.normals[3 * index.normal + 2],
+        };
+      }
+
+      if (index.texcoord >= 0)
+      {
+        vertex.uv = {
+            attrib.texcoords[2 * index.texcoord + 0],
+            attrib.texcoords[2 * index.texcoord + 1],
+        };
+      }
+
+      indices.push_back(uniqueVertices.findOrInsert(vertex));
+      if (vertices.capacity() != vertexCapacity)
+      {
+        // more unique vertices than positions, the ones welded so far moved
+        bytesCopied += (vertices.size() - 1) * sizeof(Vertex);
+        vertexCapacity = vertices.capacity();
       }
     }
+    bytesCopied += vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+
+    // archives are read only, their sidecars come from the pak builder
+    std::string loosePath = CjhVfs::shared().loosePath(filepath);
+    if (!loosePath.empty())
+    {
+      CjhMeshCache::write(loosePath, weldEpsilon, vertices, indices);
+    }
   }
 
 } // namespace lve
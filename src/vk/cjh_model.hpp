@@ -2,6 +2,8 @@
 
 #include "cjh_buffer.hpp"
 #include "cjh_device.hpp"
+#include "cjh_geometry_arena.hpp"
+#include "cjh_vfs.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -9,6 +11,7 @@
 #include <glm/glm.hpp>
 
 // std
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -17,9 +20,18 @@
 
 namespace cjh
 {
+  class CjhAsyncIo;
+
   class CjhModel
   {
   public:
+    // which render system draws an instance of the model, part of its render queue sort key
+    enum class RenderSystem : uint8_t
+    {
+      Simple = 0,
+      Texture = 1,
+    };
+
     struct Vertex
     {
       glm::vec3 position{};
@@ -37,6 +49,29 @@ namespace cjh
       }
     };
 
+    // model space bounds of the vertex positions
+    struct Bounds
+    {
+      glm::vec3 min{0.f};
+      glm::vec3 max{0.f};
+      // center of the box in xyz, distance to the farthest vertex in w; not the minimal sphere
+      glm::vec4 sphere{0.f};
+
+      static Bounds compute(const Vertex *vertices, uint32_t vertexCount);
+      // the box around the transformed box and the sphere scaled by the largest axis scale
+      Bounds transformed(const glm::mat4 &transform) const;
+    };
+
+    // per instance data of instanced draws, read from vertex binding 1 at locations 4 to 11
+    struct Instance
+    {
+      glm::mat4 modelMatrix{1.f};
+      glm::mat4 normalMatrix{1.f};
+
+      static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+      static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    };
+
     struct Timer
     {
       std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
@@ -58,33 +93,113 @@ namespace cjh
     {
       std::vector<Vertex> vertices{};
       std::vector<uint32_t> indices{};
+      // > 0 merges vertices whose attributes all lie within this distance of each other
+      float weldEpsilon = 0.0f;
+      // bytes the last loadModel wrote to fill vertices and indices, the parser's arrays included
+      uint64_t bytesCopied = 0;
+
+      // source is the already read file when the caller has it, otherwise it is opened here;
+      // either way a warm mesh cache is used instead
+      void loadModel(const std::string &filepath, const CjhVfs::File &source = {});
+    };
 
-      void loadModel(const std::string &filepath);
+    // Host side staging copies of a model's buffers. Can be prepared on a worker thread and
+    // turned into a model on the render thread.
+    struct StagedData
+    {
+      std::unique_ptr<CjhBuffer> vertexStaging{};
+      uint32_t vertexCount = 0;
+      std::unique_ptr<CjhBuffer> indexStaging{};
+      uint32_t indexCount = 0;
+      // bytes the CPU (or the kernel on its behalf) wrote to produce the staged data, the final
+      // write into staging memory included
+      uint64_t bytesCopied = 0;
+      Bounds bounds{};
     };
 
-    CjhModel(CjhDevice &device, const CjhModel::Builder &builder);
+    static StagedData stage(CjhDevice &device, const Builder &builder);
+    static StagedData stageFromFile(CjhDevice &device, const std::string &filepath, const CjhVfs::File &source = {});
+    // Reads the arrays of a warm mesh cache straight from disk into mapped staging buffers, with no
+    // intermediate copy. Returns false without reading anything when there is no cache that can be
+    // read in place. onStaged runs on an I/O thread and gets StagedData without buffers if a read
+    // failed. Queued reads go out with io.flush().
+    static bool stageFromMeshCacheAsync(
+        CjhDevice &device,
+        const std::string &filepath,
+        CjhAsyncIo &io,
+        std::function<void(StagedData)> onStaged);
+
+    // with a geometryArena the model lives in the shared buffers when they have room left
+    CjhModel(CjhDevice &device, const CjhModel::Builder &builder, CjhGeometryArena *geometryArena = nullptr);
+    // the copies are recorded into the device staging ring and go out with its next flush
+    CjhModel(CjhDevice &device, StagedData stagedData, CjhGeometryArena *geometryArena = nullptr);
+    CjhModel(
+        CjhDevice &device,
+        const Vertex *vertices,
+        uint32_t vertexCount,
+        const uint32_t *indices,
+        uint32_t indexCount,
+        CjhGeometryArena *geometryArena = nullptr);
     ~CjhModel();
 
     CjhModel(const CjhModel &) = delete;
     CjhModel &operator=(const CjhModel &) = delete;
 
     static std::unique_ptr<CjhModel> createModelFromFile(
-        CjhDevice &device, const std::string &filepath);
+        CjhDevice &device, const std::string &filepath, CjhGeometryArena *geometryArena = nullptr);
 
     void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
-    std::string m_render_system = {};
+    void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+    // null when the model owns its buffers; models sharing an arena only need it bound once
+    CjhGeometryArena *getGeometryArena() const { return geometryArena; }
+    // bytes of vertex and index data the model keeps on the GPU
+    VkDeviceSize getMemorySize() const
+    {
+      return sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCount) +
+             (hasIndexBuffer ? sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCount) : 0);
+    }
+    bool isIndexed() const { return hasIndexBuffer; }
+    // the draw() of one instance as an indirect command, for indexed models
+    VkDrawIndexedIndirectCommand getIndirectCommand() const
+    {
+      return {indexCount, 1, indexRange.first, static_cast<int32_t>(vertexRange.first), 0};
+    }
+    const Bounds &getBounds() const { return bounds; }
+    // model space center in xyz, radius in w
+    const glm::vec4 &getBoundingSphere() const { return bounds.sphere; }
+    // stable small id, render queue keys group draws of the same mesh by it
+    uint32_t getMeshId() const { return meshId; }
 
   private:
-    void createVertexBuffers(const std::vector<Vertex> &vertices);
-    void createIndexBuffers(const std::vector<uint32_t> &indices);
+    static StagedData stage(
+        CjhDevice &device,
+        const Vertex *vertices,
+        uint32_t vertexCount,
+        const uint32_t *indices,
+        uint32_t indexCount,
+        const Bounds &bounds);
+    // data may be nullptr for a buffer that is filled later through its mapping
+    static std::unique_ptr<CjhBuffer> createStagingBuffer(
+        CjhDevice &device, const void *data, uint32_t instanceSize, uint32_t instanceCount);
+
+    void allocateFromArena(CjhGeometryArena *arena, uint32_t vertexCount, uint32_t indexCount);
+    void createVertexBuffers(const Vertex *vertices, uint32_t vertexCount);
+    void createIndexBuffers(const uint32_t *indices, uint32_t indexCount);
+
+    static uint32_t nextMeshId();
 
     CjhDevice &cjhDevice;
+    uint32_t meshId = nextMeshId();
+    CjhGeometryArena *geometryArena = nullptr;
+    CjhGeometryArena::Range vertexRange{};
+    CjhGeometryArena::Range indexRange{};
     std::unique_ptr<CjhBuffer> vertexBuffer;
     uint32_t vertexCount;
 
     bool hasIndexBuffer = false;
     std::unique_ptr<CjhBuffer> indexBuffer;
     uint32_t indexCount;
+
+    Bounds bounds{};
   };
 } // namespace lve
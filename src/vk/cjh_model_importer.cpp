@@ -0,0 +1,130 @@
+#include "cjh_model_importer.hpp"
+
+#include "cjh_async_io.hpp"
+#include "cjh_staging_ring.hpp"
+#include "cjh_vfs.hpp"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace cjh
+{
+
+  CjhModelImporter::CjhModelImporter(CjhDevice &device, CjhGeometryArena *geometryArena, uint32_t workerCount)
+      : cjhDevice{device}, geometryArena{geometryArena}, workers{workerCount}
+  {
+  }
+
+  CjhModelImporter::~CjhModelImporter()
+  {
+    // staged buffers of unfinished jobs still belong to the device, let them drain first
+    for (auto &pending : parsing)
+    {
+      pending.stagedData.wait();
+    }
+  }
+
+  void CjhModelImporter::request(const std::string &filepath)
+  {
+    std::string extension = std::filesystem::path(filepath).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension != ".obj")
+    {
+      std::cout << "skipping import of unsupported file: " << filepath << std::endl;
+      return;
+    }
+
+    auto stagedData = std::make_shared<std::promise<CjhModel::StagedData>>();
+    parsing.push_back({filepath, stagedData->get_future()});
+    CjhDevice &device = cjhDevice;
+    CjhThreadPool &pool = workers;
+    // Probing for a mesh cache reads its header, so that happens on a worker. The bulk reads go to
+    // the async I/O backend: a warm cache straight into staging memory, a source into memory for
+    // the workers to parse.
+    workers.submit([&device, &pool, filepath, stagedData]()
+                   {
+      CjhAsyncIo &io = CjhAsyncIo::shared();
+      try
+      {
+        bool cached = CjhModel::stageFromMeshCacheAsync(
+            device, filepath, io, [filepath, stagedData](CjhModel::StagedData staged)
+            {
+              if (!staged.vertexStaging)
+              {
+                stagedData->set_exception(std::make_exception_ptr(std::runtime_error("failed to read " + filepath)));
+                return;
+              }
+              stagedData->set_value(std::move(staged));
+            });
+        if (!cached)
+        {
+          CjhVfs::shared().openAsync(filepath, io, [&device, &pool, filepath, stagedData](CjhVfs::File source)
+                                     { pool.submit([&device, filepath, stagedData, source = std::move(source)]()
+                                                   {
+              try
+              {
+                if (!source)
+                {
+                  throw std::runtime_error("failed to read " + filepath);
+                }
+                stagedData->set_value(CjhModel::stageFromFile(device, filepath, source));
+              }
+              catch (...)
+              {
+                stagedData->set_exception(std::current_exception());
+              } }); });
+        }
+        io.flush();
+      }
+      catch (...)
+      {
+        // nothing was queued for this model yet
+        stagedData->set_exception(std::current_exception());
+      } });
+  }
+
+  std::vector<CjhModelImporter::ImportedModel> CjhModelImporter::poll()
+  {
+    std::vector<ImportedModel> imported;
+    for (auto it = parsing.begin(); it != parsing.end();)
+    {
+      if (it->stagedData.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      {
+        ++it;
+        continue;
+      }
+
+      try
+      {
+        CjhModel::StagedData stagedData = it->stagedData.get();
+        importStats.stagedBytes += static_cast<uint64_t>(stagedData.vertexCount) * sizeof(CjhModel::Vertex) +
+                                   static_cast<uint64_t>(stagedData.indexCount) * sizeof(uint32_t);
+        importStats.copiedBytes += stagedData.bytesCopied;
+        auto model = std::make_shared<CjhModel>(cjhDevice, std::move(stagedData), geometryArena);
+        uploading.push_back({it->filepath, std::move(model), cjhDevice.stagingRing().pendingSubmission()});
+      }
+      catch (const std::exception &e)
+      {
+        std::cout << "failed to import " << it->filepath << ": " << e.what() << std::endl;
+      }
+      it = parsing.erase(it);
+    }
+
+    // submissions complete in order, so the first unfinished upload ends the ready prefix
+    size_t readyCount = 0;
+    while (readyCount < uploading.size() && cjhDevice.stagingRing().isComplete(uploading[readyCount].submission))
+    {
+      imported.push_back({uploading[readyCount].filepath, std::move(uploading[readyCount].model)});
+      readyCount++;
+    }
+    uploading.erase(uploading.begin(), uploading.begin() + readyCount);
+    return imported;
+  }
+
+} // namespace cjh
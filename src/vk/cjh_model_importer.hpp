@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cjh_device.hpp"
+#include "cjh_geometry_arena.hpp"
+#include "cjh_model.hpp"
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  // Loads models in the background: files are read by the async I/O backend, parsed and staged
+  // on worker threads, the GPU copies are recorded into the device staging ring on the render
+  // thread, and a model is only handed out once the ring reports its upload complete.
+  class CjhModelImporter
+  {
+  public:
+    struct ImportedModel
+    {
+      std::string filepath;
+      std::shared_ptr<CjhModel> model;
+    };
+
+    // copiedBytes / stagedBytes is how often each byte of model data was written on its way into
+    // staging memory: 1 for warm mesh caches, which are read in place, several for parsed sources
+    struct Stats
+    {
+      uint64_t stagedBytes = 0;
+      uint64_t copiedBytes = 0;
+    };
+
+    // imported models are placed in geometryArena when it is given and has room
+    CjhModelImporter(CjhDevice &device, CjhGeometryArena *geometryArena = nullptr, uint32_t workerCount = 2);
+    ~CjhModelImporter();
+
+    CjhModelImporter(const CjhModelImporter &) = delete;
+    CjhModelImporter &operator=(const CjhModelImporter &) = delete;
+
+    void request(const std::string &filepath);
+
+    // Call once per frame on the render thread. Never blocks; records uploads for models that
+    // finished parsing and returns the ones whose uploads completed.
+    std::vector<ImportedModel> poll();
+
+    size_t pendingCount() const { return parsing.size() + uploading.size(); }
+    const Stats &stats() const { return importStats; }
+
+  private:
+    struct PendingParse
+    {
+      std::string filepath;
+      std::future<CjhModel::StagedData> stagedData;
+    };
+
+    struct PendingUpload
+    {
+      std::string filepath;
+      std::shared_ptr<CjhModel> model;
+      uint64_t submission;
+    };
+
+    CjhDevice &cjhDevice;
+    CjhGeometryArena *geometryArena;
+    CjhThreadPool workers;
+    std::vector<PendingParse> parsing;
+    std::vector<PendingUpload> uploading;
+    Stats importStats{};
+  };
+} // namespace cjh
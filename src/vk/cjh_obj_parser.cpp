@@ -0,0 +1,545 @@
+#include "cjh_obj_parser.hpp"
+
+#include "cjh_vfs.hpp"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CJH_OBJ_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace cjh
+{
+  namespace
+  {
+    // below this a file is parsed as a single chunk, threads would cost more than they save
+    constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+    inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+    inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+#if CJH_OBJ_SSE2
+    inline uint32_t firstSetBit(uint32_t mask)
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return static_cast<uint32_t>(index);
+#else
+      return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+#endif
+
+    const char *findNewline(const char *p, const char *end)
+    {
+#if CJH_OBJ_SSE2
+      const __m128i newline = _mm_set1_epi8('\n');
+      while (end - p >= 16)
+      {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+        if (mask != 0)
+        {
+          return p + firstSetBit(mask);
+        }
+        p += 16;
+      }
+#endif
+      while (p < end && *p != '\n')
+      {
+        p++;
+      }
+      return p;
+    }
+
+    const char *skipSpaces(const char *p, const char *end)
+    {
+      // a single separator is by far the common case, only go wide on longer runs
+      if (p >= end || !isSpace(*p))
+      {
+        return p;
+      }
+      p++;
+      if (p >= end || !isSpace(*p))
+      {
+        return p;
+      }
+#if CJH_OBJ_SSE2
+      const __m128i space = _mm_set1_epi8(' ');
+      const __m128i tab = _mm_set1_epi8('\t');
+      const __m128i carriageReturn = _mm_set1_epi8('\r');
+      while (end - p >= 16)
+      {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i blank = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+            _mm_cmpeq_epi8(bytes, carriageReturn));
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(blank)) & 0xffffu;
+        if (mask != 0)
+        {
+          return p + firstSetBit(mask);
+        }
+        p += 16;
+      }
+#endif
+      while (p < end && isSpace(*p))
+      {
+        p++;
+      }
+      return p;
+    }
+
+    const char *skipToken(const char *p, const char *end)
+    {
+      while (p < end && !isSpace(*p))
+      {
+        p++;
+      }
+      return p;
+    }
+
+    // Decimal float parser. Values with at most 19 significant digits and a small decimal
+    // exponent are assembled exactly from integer mantissa and a power of ten; everything else
+    // (long mantissas, huge exponents, inf, nan) goes through strtod.
+    const char *parseFloat(const char *p, const char *end, float &value)
+    {
+      static const double powersOfTen[] = {
+          1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+      const char *start = p;
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+        negative = *p == '-';
+        p++;
+      }
+
+      uint64_t mantissa = 0;
+      int significantDigits = 0;
+      int exponent = 0;
+      bool anyDigits = false;
+      bool truncated = false;
+      while (p < end && isDigit(*p))
+      {
+        anyDigits = true;
+        if (significantDigits < 19)
+        {
+          mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+          significantDigits += mantissa != 0;
+        }
+        else
+        {
+          exponent++;
+          truncated |= *p != '0';
+        }
+        p++;
+      }
+      if (p < end && *p == '.')
+      {
+        p++;
+        while (p < end && isDigit(*p))
+        {
+          anyDigits = true;
+          if (significantDigits < 19)
+          {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            significantDigits += mantissa != 0;
+            exponent--;
+          }
+          else
+          {
+            truncated |= *p != '0';
+          }
+          p++;
+        }
+      }
+      if (anyDigits && p < end && (*p == 'e' || *p == 'E'))
+      {
+        const char *exponentStart = p;
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+          negativeExponent = *p == '-';
+          p++;
+        }
+        if (p < end && isDigit(*p))
+        {
+          int explicitExponent = 0;
+          while (p < end && isDigit(*p))
+          {
+            if (explicitExponent < 100000)
+            {
+              explicitExponent = explicitExponent * 10 + (*p - '0');
+            }
+            p++;
+          }
+          exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+        else
+        {
+          p = exponentStart;
+        }
+      }
+
+      if (anyDigits && !truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+      {
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+        value = static_cast<float>(negative ? -result : result);
+        return p;
+      }
+
+      // slow path, the mapped file is not zero terminated so copy the token out first
+      const char *tokenEnd = anyDigits ? p : skipToken(start, end);
+      char buffer[128];
+      size_t length = std::min(static_cast<size_t>(tokenEnd - start), sizeof(buffer) - 1);
+      std::memcpy(buffer, start, length);
+      buffer[length] = '\0';
+      char *parsedEnd = nullptr;
+      double result = std::strtod(buffer, &parsedEnd);
+      if (parsedEnd == buffer)
+      {
+        throw std::runtime_error("invalid number in obj file");
+      }
+      value = static_cast<float>(result);
+      return start + (parsedEnd - buffer);
+    }
+
+    const char *parseInt(const char *p, const char *end, int &value)
+    {
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+        negative = *p == '-';
+        p++;
+      }
+      if (p >= end || !isDigit(*p))
+      {
+        throw std::runtime_error("invalid face index in obj file");
+      }
+      int64_t result = 0;
+      while (p < end && isDigit(*p))
+      {
+        result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+        p++;
+      }
+      value = static_cast<int>(negative ? -result : result);
+      return p;
+    }
+
+    enum Attribute : uint8_t
+    {
+      ATTRIBUTE_VERTEX,
+      ATTRIBUTE_TEXCOORD,
+      ATTRIBUTE_NORMAL,
+    };
+
+    // Negative OBJ indices count back from the attributes read so far. Inside a chunk they are
+    // resolved against the chunk local count and remembered here, the merge adds the chunk base.
+    struct RelativeIndex
+    {
+      uint32_t corner;
+      Attribute attribute;
+    };
+
+    struct Chunk
+    {
+      const char *begin;
+      const char *end;
+      CjhObjParser::Result result{};
+      std::vector<RelativeIndex> relativeIndices{};
+      uint64_t bytesCopied = 0;
+    };
+
+    // appends count values and counts them, plus the elements moved when the array reallocates
+    template <typename T>
+    void append(std::vector<T> &array, const T *values, size_t count, uint64_t &bytesCopied)
+    {
+      if (array.size() + count > array.capacity())
+      {
+        bytesCopied += array.size() * sizeof(T);
+      }
+      array.insert(array.end(), values, values + count);
+      bytesCopied += count * sizeof(T);
+    }
+
+    enum RelativeFlags : uint8_t
+    {
+      RELATIVE_VERTEX = 1 << ATTRIBUTE_VERTEX,
+      RELATIVE_TEXCOORD = 1 << ATTRIBUTE_TEXCOORD,
+      RELATIVE_NORMAL = 1 << ATTRIBUTE_NORMAL,
+    };
+
+    int resolveIndex(int index, size_t localCount, uint8_t relativeFlag, uint8_t &flags)
+    {
+      if (index > 0)
+      {
+        return index - 1;
+      }
+      if (index == 0)
+      {
+        throw std::runtime_error("invalid face index 0 in obj file");
+      }
+      flags |= relativeFlag;
+      return static_cast<int>(localCount) + index;
+    }
+
+    struct PolygonCorner
+    {
+      CjhObjParser::Index index;
+      uint8_t relativeFlags;
+    };
+
+    void parseFace(const char *p, const char *end, Chunk &chunk, std::vector<PolygonCorner> &polygon)
+    {
+      CjhObjParser::Result &result = chunk.result;
+      size_t positionCount = result.positions.size() / 3;
+      size_t texcoordCount = result.texcoords.size() / 2;
+      size_t normalCount = result.normals.size() / 3;
+
+      polygon.clear();
+      while ((p = skipSpaces(p, end)) < end)
+      {
+        PolygonCorner corner{};
+        int value;
+        p = parseInt(p, end, value);
+        corner.index.vertex = resolveIndex(value, positionCount, RELATIVE_VERTEX, corner.relativeFlags);
+        if (p < end && *p == '/')
+        {
+          p++;
+          if (p < end && *p != '/')
+          {
+            p = parseInt(p, end, value);
+            corner.index.texcoord = resolveIndex(value, texcoordCount, RELATIVE_TEXCOORD, corner.relativeFlags);
+          }
+          if (p < end && *p == '/')
+          {
+            p++;
+            p = parseInt(p, end, value);
+            corner.index.normal = resolveIndex(value, normalCount, RELATIVE_NORMAL, corner.relativeFlags);
+          }
+        }
+        polygon.push_back(corner);
+      }
+
+      auto emit = [&](const PolygonCorner &corner)
+      {
+        for (uint8_t attribute = ATTRIBUTE_VERTEX; attribute <= ATTRIBUTE_NORMAL; attribute++)
+        {
+          if (corner.relativeFlags & (1 << attribute))
+          {
+            RelativeIndex relative{static_cast<uint32_t>(result.indices.size()), static_cast<Attribute>(attribute)};
+            append(chunk.relativeIndices, &relative, 1, chunk.bytesCopied);
+          }
+        }
+        append(result.indices, &corner.index, 1, chunk.bytesCopied);
+      };
+      for (size_t i = 1; i + 1 < polygon.size(); i++)
+      {
+        emit(polygon[0]);
+        emit(polygon[i]);
+        emit(polygon[i + 1]);
+      }
+    }
+
+    void parseChunk(Chunk &chunk)
+    {
+      CjhObjParser::Result &result = chunk.result;
+      std::vector<PolygonCorner> polygon;
+      polygon.reserve(8);
+
+      const char *p = chunk.begin;
+      while (p < chunk.end)
+      {
+        const char *lineEnd = findNewline(p, chunk.end);
+        const char *line = skipSpaces(p, lineEnd);
+        p = lineEnd + 1;
+
+        if (lineEnd - line < 2)
+        {
+          continue;
+        }
+        if (line[0] == 'v')
+        {
+          if (isSpace(line[1]))
+          {
+            float values[6];
+            int count = 0;
+            const char *cursor = line + 1;
+            while (count < 6 && (cursor = skipSpaces(cursor, lineEnd)) < lineEnd)
+            {
+              cursor = parseFloat(cursor, lineEnd, values[count++]);
+            }
+            if (count < 3)
+            {
+              throw std::runtime_error("vertex with less than 3 components in obj file");
+            }
+            append(result.positions, values, 3, chunk.bytesCopied);
+            if (count < 6)
+            {
+              std::fill(values + 3, values + 6, 1.0f);
+            }
+            append(result.colors, values + 3, 3, chunk.bytesCopied);
+          }
+          else if (line[1] == 'n' && lineEnd - line > 2 && isSpace(line[2]))
+          {
+            float values[3] = {0.0f, 0.0f, 0.0f};
+            const char *cursor = line + 2;
+            for (int i = 0; i < 3 && (cursor = skipSpaces(cursor, lineEnd)) < lineEnd; i++)
+            {
+              cursor = parseFloat(cursor, lineEnd, values[i]);
+            }
+            append(result.normals, values, 3, chunk.bytesCopied);
+          }
+          else if (line[1] == 't' && lineEnd - line > 2 && isSpace(line[2]))
+          {
+            float values[2] = {0.0f, 0.0f};
+            const char *cursor = line + 2;
+            for (int i = 0; i < 2 && (cursor = skipSpaces(cursor, lineEnd)) < lineEnd; i++)
+            {
+              cursor = parseFloat(cursor, lineEnd, values[i]);
+            }
+            append(result.texcoords, values, 2, chunk.bytesCopied);
+          }
+        }
+        else if (line[0] == 'f' && isSpace(line[1]))
+        {
+          parseFace(line + 1, lineEnd, chunk, polygon);
+        }
+      }
+    }
+
+    template <typename T>
+    void appendAt(std::vector<T> &destination, size_t offset, const std::vector<T> &source)
+    {
+      if (!source.empty())
+      {
+        std::memcpy(destination.data() + offset, source.data(), source.size() * sizeof(T));
+      }
+    }
+  } // namespace
+
+  CjhObjParser::Result CjhObjParser::parseFile(const std::string &filepath, CjhThreadPool &pool)
+  {
+    CjhVfs::File file = CjhVfs::shared().open(filepath, pool);
+    return parse(reinterpret_cast<const char *>(file.data()), file.size(), pool);
+  }
+
+  CjhObjParser::Result CjhObjParser::parse(const char *data, size_t size, CjhThreadPool &pool)
+  {
+    const char *end = data + size;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / MIN_CHUNK_SIZE, pool.threadCount() * 4));
+
+    std::vector<Chunk> chunks(chunkCount);
+    const char *chunkBegin = data;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+      const char *chunkEnd = end;
+      if (i + 1 < chunkCount)
+      {
+        const char *target = std::max(chunkBegin, data + size * (i + 1) / chunkCount);
+        chunkEnd = std::min(findNewline(target, end) + 1, end);
+      }
+      chunks[i].begin = chunkBegin;
+      chunks[i].end = chunkEnd;
+      chunkBegin = chunkEnd;
+    }
+
+    pool.parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i)
+                     { parseChunk(chunks[i]); });
+
+    // prefix sums give every chunk its base offset in the merged arrays
+    struct Offsets
+    {
+      size_t positions, normals, texcoords, indices;
+    };
+    std::vector<Offsets> offsets(chunkCount + 1);
+    offsets[0] = {0, 0, 0, 0};
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+      const Result &chunkResult = chunks[i].result;
+      offsets[i + 1] = {
+          offsets[i].positions + chunkResult.positions.size(),
+          offsets[i].normals + chunkResult.normals.size(),
+          offsets[i].texcoords + chunkResult.texcoords.size(),
+          offsets[i].indices + chunkResult.indices.size()};
+    }
+    const Offsets &total = offsets[chunkCount];
+
+    Result result{};
+    result.positions.resize(total.positions);
+    result.colors.resize(total.positions);
+    result.normals.resize(total.normals);
+    result.texcoords.resize(total.texcoords);
+    result.indices.resize(total.indices);
+
+    for (const auto &chunk : chunks)
+    {
+      result.bytesCopied += chunk.bytesCopied;
+    }
+    result.bytesCopied += 2 * ((total.positions * 2 + total.normals + total.texcoords) * sizeof(float) +
+                               total.indices * sizeof(Index));
+
+    const int positionCount = static_cast<int>(total.positions / 3);
+    const int texcoordCount = static_cast<int>(total.texcoords / 2);
+    const int normalCount = static_cast<int>(total.normals / 3);
+
+    pool.parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i)
+                     {
+      Chunk &chunk = chunks[i];
+      const Offsets &base = offsets[i];
+      appendAt(result.positions, base.positions, chunk.result.positions);
+      appendAt(result.colors, base.positions, chunk.result.colors);
+      appendAt(result.normals, base.normals, chunk.result.normals);
+      appendAt(result.texcoords, base.texcoords, chunk.result.texcoords);
+
+      std::vector<Index> &indices = chunk.result.indices;
+      for (const auto &relative : chunk.relativeIndices)
+      {
+        Index &index = indices[relative.corner];
+        switch (relative.attribute)
+        {
+        case ATTRIBUTE_VERTEX:
+          index.vertex += static_cast<int>(base.positions / 3);
+          break;
+        case ATTRIBUTE_TEXCOORD:
+          index.texcoord += static_cast<int>(base.texcoords / 2);
+          break;
+        case ATTRIBUTE_NORMAL:
+          index.normal += static_cast<int>(base.normals / 3);
+          break;
+        }
+        // a relative index reaching before the first element must not read as an absent one
+        if ((relative.attribute == ATTRIBUTE_TEXCOORD && index.texcoord < 0) ||
+            (relative.attribute == ATTRIBUTE_NORMAL && index.normal < 0))
+        {
+          throw std::runtime_error("face index out of range in obj file");
+        }
+      }
+      for (const auto &index : indices)
+      {
+        if (index.vertex < 0 || index.vertex >= positionCount || index.texcoord < -1 ||
+            index.texcoord >= texcoordCount || index.normal < -1 || index.normal >= normalCount)
+        {
+          throw std::runtime_error("face index out of range in obj file");
+        }
+      }
+      appendAt(result.indices, base.indices, indices);
+      chunk.result = Result{}; });
+
+    return result;
+  }
+
+} // namespace cjh
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  // Wavefront OBJ geometry parser. The file is split into line aligned chunks that are parsed in
+  // parallel and merged afterwards. Only geometry is read (v, vt, vn, f); groups, smoothing and
+  // materials are ignored. Polygons are fan triangulated.
+  class CjhObjParser
+  {
+  public:
+    // zero based attribute indices of one face corner, -1 when the attribute is absent
+    struct Index
+    {
+      int vertex = -1;
+      int texcoord = -1;
+      int normal = -1;
+    };
+
+    struct Result
+    {
+      std::vector<float> positions{}; // xyz
+      std::vector<float> colors{};    // rgb per position, white when the file has none
+      std::vector<float> normals{};   // xyz
+      std::vector<float> texcoords{}; // uv
+      std::vector<Index> indices{};   // three per triangle
+      // bytes written building the arrays: the per chunk arrays, what their reallocations moved
+      // and the merge into these (resize zero fills before the copy)
+      uint64_t bytesCopied = 0;
+    };
+
+    // filepath goes through CjhVfs, so it is relative to the engine root
+    static Result parseFile(const std::string &filepath, CjhThreadPool &pool = CjhThreadPool::shared());
+    static Result parse(const char *data, size_t size, CjhThreadPool &pool = CjhThreadPool::shared());
+  };
+} // namespace cjh
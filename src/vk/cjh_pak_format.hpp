@@ -0,0 +1,83 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace cjh
+{
+  // Layout of the .pak archives written by the pak builder (tools/pak_builder). The file is a
+  // Header, the data of every entry, the table of contents and the name block. Everything is
+  // little endian. The table is sorted by name so lookups are a binary search, and every entry
+  // starts on an ENTRY_ALIGNMENT boundary so a mapped archive can be read in place.
+  namespace pak_format
+  {
+    constexpr char MAGIC[4] = {'C', 'P', 'A', 'K'};
+    constexpr uint32_t VERSION = 1;
+    // enough for in place views of vertex arrays, SPIR-V words and .ctex data blocks
+    constexpr uint64_t ENTRY_ALIGNMENT = 64;
+    // compressed entries are split into chunks of this many original bytes that decode independently
+    constexpr uint64_t CHUNK_SIZE = 256 * 1024;
+    constexpr const char *EXTENSION = ".pak";
+
+    enum class Compression : uint32_t
+    {
+      None = 0,
+      // a uint32_t compressed size per chunk (padded to 16 bytes), then one zlib stream per chunk
+      Deflate = 1,
+    };
+
+    struct Header
+    {
+      char magic[4];
+      uint32_t version;
+      uint32_t entryCount;
+      uint32_t reserved;
+      uint64_t tocOffset; // from the start of the file
+      uint64_t namesOffset;
+      uint64_t namesSize;
+    };
+
+    struct Entry
+    {
+      uint64_t offset; // from the start of the file
+      uint64_t size;   // stored bytes, including the chunk table of compressed entries
+      uint64_t originalSize;
+      uint32_t nameOffset; // from the start of the name block, names are not null terminated
+      uint32_t nameLength;
+      Compression compression;
+      uint32_t chunkCount;
+    };
+
+    static_assert(sizeof(Header) == 40, "Header layout is part of the file format");
+    static_assert(sizeof(Entry) == 40, "Entry layout is part of the file format");
+
+    inline uint32_t chunkCount(uint64_t originalSize)
+    {
+      return static_cast<uint32_t>((originalSize + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    }
+
+    inline uint64_t chunkTableSize(uint32_t chunkCount)
+    {
+      return (static_cast<uint64_t>(chunkCount) * sizeof(uint32_t) + 15) & ~uint64_t{15};
+    }
+
+    // entry names use forward slashes and are relative to the engine root: ".\models\cube.obj"
+    // -> "models/cube.obj"
+    inline std::string normalizePath(std::string path)
+    {
+      for (char &c : path)
+      {
+        if (c == '\\')
+        {
+          c = '/';
+        }
+      }
+      while (path.compare(0, 2, "./") == 0)
+      {
+        path.erase(0, 2);
+      }
+      return path;
+    }
+  } // namespace pak_format
+} // namespace cjh
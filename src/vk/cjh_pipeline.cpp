@@ -4,14 +4,8 @@
 
 // std
 #include <cassert>
-#include <fstream>
-#include <iostream>
 #include <stdexcept>
 
-#ifndef ENGINE_PATH
-#define ENGINE_PATH "../"
-#endif
-
 namespace cjh
 {
 
@@ -27,29 +21,19 @@ namespace cjh
 
   CjhPipeline::~CjhPipeline()
   {
-    vkDestroyShaderModule(cjhDevice.device(), vertShaderModule, nullptr);
-    vkDestroyShaderModule(cjhDevice.device(), fragShaderModule, nullptr);
     vkDestroyPipeline(cjhDevice.device(), graphicsPipeline, nullptr);
   }
 
-  std::vector<char> CjhPipeline::readFile(const std::string &filepath)
+  std::future<std::unique_ptr<CjhPipeline>> CjhPipeline::createAsync(
+      CjhDevice &device,
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      std::unique_ptr<PipelineConfigInfo> configInfo,
+      CjhThreadPool &pool)
   {
-    std::string enginePath = ENGINE_PATH + filepath;
-    std::ifstream file{enginePath, std::ios::ate | std::ios::binary};
-
-    if (!file.is_open())
-    {
-      throw std::runtime_error("failed to open file: " + enginePath);
-    }
-
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-    return buffer;
+    std::shared_ptr<PipelineConfigInfo> config = std::move(configInfo);
+    return pool.submit([&device, vertFilepath, fragFilepath, config]()
+                       { return std::make_unique<CjhPipeline>(device, vertFilepath, fragFilepath, *config); });
   }
 
   void CjhPipeline::createGraphicsPipeline(
@@ -64,11 +48,9 @@ namespace cjh
         configInfo.renderPass != VK_NULL_HANDLE &&
         "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
-    auto vertCode = readFile(vertFilepath);
-    auto fragCode = readFile(fragFilepath);
-
-    createShaderModule(vertCode, &vertShaderModule);
-    createShaderModule(fragCode, &fragShaderModule);
+    // modules are shared with every other pipeline using the same shaders
+    VkShaderModule vertShaderModule = cjhDevice.shaderModules().get(vertFilepath);
+    VkShaderModule fragShaderModule = cjhDevice.shaderModules().get(fragFilepath);
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -118,7 +100,7 @@ namespace cjh
 
     if (vkCreateGraphicsPipelines(
             cjhDevice.device(),
-            VK_NULL_HANDLE,
+            cjhDevice.pipelineCache(),
             1,
             &pipelineInfo,
             nullptr,
@@ -128,22 +110,52 @@ namespace cjh
     }
   }
 
-  void CjhPipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule)
+  void CjhPipeline::bind(VkCommandBuffer commandBuffer)
+  {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+  }
+
+  CjhComputePipeline::CjhComputePipeline(
+      CjhDevice &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout)
+      : cjhDevice{device}
   {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    assert(
+        pipelineLayout != VK_NULL_HANDLE &&
+        "Cannot create compute pipeline: no pipelineLayout provided");
+
+    VkPipelineShaderStageCreateInfo shaderStage{};
+    shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStage.module = cjhDevice.shaderModules().get(compFilepath);
+    shaderStage.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shaderStage;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateShaderModule(cjhDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
+    if (vkCreateComputePipelines(
+            cjhDevice.device(),
+            cjhDevice.pipelineCache(),
+            1,
+            &pipelineInfo,
+            nullptr,
+            &computePipeline) != VK_SUCCESS)
     {
-      throw std::runtime_error("failed to create shader module");
+      throw std::runtime_error("failed to create compute pipeline");
     }
   }
 
-  void CjhPipeline::bind(VkCommandBuffer commandBuffer)
+  CjhComputePipeline::~CjhComputePipeline()
   {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    vkDestroyPipeline(cjhDevice.device(), computePipeline, nullptr);
+  }
+
+  void CjhComputePipeline::bind(VkCommandBuffer commandBuffer)
+  {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
   }
 
   void CjhPipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo)
@@ -235,4 +247,13 @@ namespace cjh
     configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
   }
 
+  void CjhPipeline::enableInstancing(PipelineConfigInfo &configInfo)
+  {
+    auto bindings = CjhModel::Instance::getBindingDescriptions();
+    auto attributes = CjhModel::Instance::getAttributeDescriptions();
+    configInfo.bindingDescriptions.insert(configInfo.bindingDescriptions.end(), bindings.begin(), bindings.end());
+    configInfo.attributeDescriptions.insert(
+        configInfo.attributeDescriptions.end(), attributes.begin(), attributes.end());
+  }
+
 } // namespace lve
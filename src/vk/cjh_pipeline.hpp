@@ -1,8 +1,11 @@
 #pragma once
 
 #include "cjh_device.hpp"
+#include "cjh_thread_pool.hpp"
 
 // std
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,24 +47,45 @@ namespace cjh
     CjhPipeline(const CjhPipeline &) = delete;
     CjhPipeline &operator=(const CjhPipeline &) = delete;
 
+    // Compiles the pipeline on a worker thread. The config is kept alive by the job; it is heap
+    // allocated because the create infos point into it.
+    static std::future<std::unique_ptr<CjhPipeline>> createAsync(
+        CjhDevice &device,
+        const std::string &vertFilepath,
+        const std::string &fragFilepath,
+        std::unique_ptr<PipelineConfigInfo> configInfo,
+        CjhThreadPool &pool = CjhThreadPool::shared());
+
     void bind(VkCommandBuffer commandBuffer);
 
     static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo);
     static void enableAlphaBlending(PipelineConfigInfo &configInfo);
+    // adds the per instance vertex binding of CjhModel::Instance
+    static void enableInstancing(PipelineConfigInfo &configInfo);
 
   private:
-    static std::vector<char> readFile(const std::string &filepath);
-
     void createGraphicsPipeline(
         const std::string &vertFilepath,
         const std::string &fragFilepath,
         const PipelineConfigInfo &configInfo);
 
-    void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
-
     CjhDevice &cjhDevice;
     VkPipeline graphicsPipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+  };
+
+  class CjhComputePipeline
+  {
+  public:
+    CjhComputePipeline(CjhDevice &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout);
+    ~CjhComputePipeline();
+
+    CjhComputePipeline(const CjhComputePipeline &) = delete;
+    CjhComputePipeline &operator=(const CjhComputePipeline &) = delete;
+
+    void bind(VkCommandBuffer commandBuffer);
+
+  private:
+    CjhDevice &cjhDevice;
+    VkPipeline computePipeline;
   };
 } // namespace lve
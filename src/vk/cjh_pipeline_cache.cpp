@@ -0,0 +1,114 @@
+#include "cjh_pipeline_cache.hpp"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cjh
+{
+  namespace
+  {
+    // VkPipelineCacheHeaderVersionOne without the struct padding
+    constexpr size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+    uint32_t readU32(const char *data)
+    {
+      uint32_t value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+  } // namespace
+
+  CjhPipelineCache::CjhPipelineCache(
+      VkDevice device,
+      const VkPhysicalDeviceProperties &properties,
+      std::string path)
+      : device{device}, properties{properties}, path{std::move(path)}
+  {
+    std::string data;
+    std::ifstream file{this->path, std::ios::binary};
+    if (file)
+    {
+      data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    warm = isCompatible(data);
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = warm ? data.size() : 0;
+    createInfo.pInitialData = warm ? data.data() : nullptr;
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
+
+  CjhPipelineCache::~CjhPipelineCache()
+  {
+    try
+    {
+      save();
+    }
+    catch (const std::exception &e)
+    {
+      // losing the cache only costs the next startup some compile time
+      std::cerr << e.what() << '\n';
+    }
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+  }
+
+  void CjhPipelineCache::save()
+  {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+    {
+      return;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to read pipeline cache data!");
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+      std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+      file.write(data.data(), static_cast<std::streamsize>(size));
+      if (!file)
+      {
+        throw std::runtime_error("failed to write pipeline cache: " + temporary);
+      }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+      std::filesystem::remove(temporary, error);
+      throw std::runtime_error("failed to replace pipeline cache: " + path);
+    }
+  }
+
+  bool CjhPipelineCache::isCompatible(const std::string &data) const
+  {
+    if (data.size() < HEADER_SIZE)
+    {
+      return false;
+    }
+    uint32_t headerSize = readU32(data.data());
+    uint32_t headerVersion = readU32(data.data() + 4);
+    uint32_t vendorID = readU32(data.data() + 8);
+    uint32_t deviceID = readU32(data.data() + 12);
+    return headerSize >= HEADER_SIZE && headerSize <= data.size() &&
+           headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           vendorID == properties.vendorID &&
+           deviceID == properties.deviceID &&
+           memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+  }
+
+} // namespace cjh
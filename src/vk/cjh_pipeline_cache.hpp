@@ -0,0 +1,45 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <string>
+
+namespace cjh
+{
+  // VkPipelineCache that survives restarts. The blob on disk is only used when its header
+  // matches this device (vendor, device id and pipeline cache UUID, which changes with the
+  // driver), otherwise the cache starts empty. save() writes to a temporary file and renames it,
+  // so a crash never leaves a torn cache behind. Pipeline caches are internally synchronized.
+  class CjhPipelineCache
+  {
+  public:
+    static constexpr const char *DEFAULT_PATH = "pipeline_cache.bin";
+
+    CjhPipelineCache(
+        VkDevice device,
+        const VkPhysicalDeviceProperties &properties,
+        std::string path = DEFAULT_PATH);
+    // saves the cache
+    ~CjhPipelineCache();
+
+    CjhPipelineCache(const CjhPipelineCache &) = delete;
+    CjhPipelineCache &operator=(const CjhPipelineCache &) = delete;
+
+    VkPipelineCache handle() const { return pipelineCache; }
+    // true when the cache was seeded from disk
+    bool isWarm() const { return warm; }
+
+    void save();
+
+  private:
+    bool isCompatible(const std::string &data) const;
+
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::string path;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    bool warm = false;
+  };
+} // namespace cjh
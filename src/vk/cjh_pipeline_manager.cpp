@@ -0,0 +1,133 @@
+#include "cjh_pipeline_manager.hpp"
+
+#include "cjh_swap_chain.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+
+namespace cjh
+{
+
+  CjhPipelineManager::CjhPipelineManager(CjhDevice &device) : cjhDevice{device} {}
+
+  CjhPipelineManager::~CjhPipelineManager()
+  {
+    // compile jobs reference their layouts and the device
+    for (auto &entry : entries)
+    {
+      if (entry.pending.valid())
+      {
+        entry.pending.wait();
+      }
+    }
+  }
+
+  CjhPipelineManager::Id CjhPipelineManager::request(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      std::unique_ptr<PipelineConfigInfo> configInfo,
+      Id fallback)
+  {
+    assert((fallback == NO_PIPELINE || fallback < entries.size()) && "Unknown fallback pipeline");
+    Entry entry{};
+    entry.pending = CjhPipeline::createAsync(cjhDevice, vertFilepath, fragFilepath, std::move(configInfo));
+    entry.fallback = fallback;
+    entries.push_back(std::move(entry));
+    return static_cast<Id>(entries.size() - 1);
+  }
+
+  void CjhPipelineManager::release(Id id)
+  {
+    Entry &entry = entries.at(id);
+    if (entry.pending.valid())
+    {
+      entry.pending.wait();
+      swapIn(entry);
+    }
+    retire(std::move(entry.pipeline));
+  }
+
+  CjhPipeline *CjhPipelineManager::get(Id id)
+  {
+    // follow the fallback chain to the first pipeline that is ready
+    while (id != NO_PIPELINE)
+    {
+      Entry &entry = entries.at(id);
+      if (entry.pipeline)
+      {
+        return entry.pipeline.get();
+      }
+      id = entry.fallback;
+    }
+    return nullptr;
+  }
+
+  bool CjhPipelineManager::isReady(Id id) const
+  {
+    return entries.at(id).pipeline != nullptr;
+  }
+
+  void CjhPipelineManager::beginFrame()
+  {
+    frameCounter++;
+    for (auto &entry : entries)
+    {
+      if (entry.pending.valid() &&
+          entry.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+      {
+        swapIn(entry);
+      }
+    }
+
+    // frames recorded more than MAX_FRAMES_IN_FLIGHT frames ago have finished on the GPU
+    for (auto it = retired.begin(); it != retired.end();)
+    {
+      if (frameCounter - it->frame <= CjhSwapChain::MAX_FRAMES_IN_FLIGHT)
+      {
+        ++it;
+        continue;
+      }
+      it = retired.erase(it);
+    }
+  }
+
+  void CjhPipelineManager::finish()
+  {
+    for (auto &entry : entries)
+    {
+      if (entry.pending.valid())
+      {
+        entry.pending.wait();
+        swapIn(entry);
+      }
+    }
+  }
+
+  uint32_t CjhPipelineManager::pendingCount() const
+  {
+    uint32_t count = 0;
+    for (const auto &entry : entries)
+    {
+      count += entry.pending.valid() ? 1 : 0;
+    }
+    return count;
+  }
+
+  void CjhPipelineManager::swapIn(Entry &entry)
+  {
+    // a failed compile rethrows here, on the render thread
+    std::unique_ptr<CjhPipeline> ready = entry.pending.get();
+    retire(std::move(entry.pipeline));
+    entry.pipeline = std::move(ready);
+  }
+
+  void CjhPipelineManager::retire(std::unique_ptr<CjhPipeline> pipeline)
+  {
+    if (pipeline)
+    {
+      retired.push_back({std::move(pipeline), frameCounter});
+    }
+  }
+
+} // namespace cjh
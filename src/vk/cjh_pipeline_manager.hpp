@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cjh_pipeline.hpp"
+
+// std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  // Compiles pipelines in the background so creating one never blocks a frame. Until a pipeline
+  // is ready get() hands out its fallback (a cheap pipeline that must be compatible with the same
+  // pipeline layout and render pass) or nullptr, in which case the caller skips its draws.
+  // Finished compiles are swapped in by beginFrame(), so a frame always records with one
+  // pipeline per id. Replaced pipelines are destroyed once no frame in flight can use them.
+  // Render thread only.
+  class CjhPipelineManager
+  {
+  public:
+    using Id = uint32_t;
+    static constexpr Id NO_PIPELINE = UINT32_MAX;
+
+    explicit CjhPipelineManager(CjhDevice &device);
+    ~CjhPipelineManager();
+
+    CjhPipelineManager(const CjhPipelineManager &) = delete;
+    CjhPipelineManager &operator=(const CjhPipelineManager &) = delete;
+
+    Id request(
+        const std::string &vertFilepath,
+        const std::string &fragFilepath,
+        std::unique_ptr<PipelineConfigInfo> configInfo,
+        Id fallback = NO_PIPELINE);
+    // waits for a running compile, the pipeline is destroyed after the frames in flight
+    void release(Id id);
+
+    CjhPipeline *get(Id id);
+    bool isReady(Id id) const;
+
+    // call once per frame after the frame fence was waited on
+    void beginFrame();
+    // blocks until every requested pipeline finished compiling and swaps them in
+    void finish();
+
+    uint32_t pendingCount() const;
+
+  private:
+    struct Entry
+    {
+      std::unique_ptr<CjhPipeline> pipeline;
+      std::future<std::unique_ptr<CjhPipeline>> pending;
+      Id fallback = NO_PIPELINE;
+    };
+
+    struct RetiredPipeline
+    {
+      std::unique_ptr<CjhPipeline> pipeline;
+      uint64_t frame;
+    };
+
+    void swapIn(Entry &entry);
+    void retire(std::unique_ptr<CjhPipeline> pipeline);
+
+    CjhDevice &cjhDevice;
+    std::vector<Entry> entries;
+    std::vector<RetiredPipeline> retired;
+    uint64_t frameCounter = 0;
+  };
+} // namespace cjh
@@ -0,0 +1,116 @@
+#include "cjh_render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace cjh
+{
+  uint64_t CjhRenderQueue::makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+  {
+    // the bits of a non negative float order like the float, the top ones are enough to sort by
+    float distance = depth > 0.f ? depth : 0.f;
+    uint32_t depthBits;
+    memcpy(&depthBits, &distance, sizeof(depthBits));
+    depthBits >>= 31 - DEPTH_BITS;
+
+    uint64_t key = static_cast<uint64_t>(pipeline & ((1u << PIPELINE_BITS) - 1));
+    key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+    key = (key << MESH_BITS) | (mesh & ((1u << MESH_BITS) - 1));
+    key = (key << DEPTH_BITS) | (depthBits & ((1u << DEPTH_BITS) - 1));
+    return key;
+  }
+
+  namespace
+  {
+    uint64_t objectKey(const CjhGameObject &obj, const glm::mat4 &view)
+    {
+      float depth = (view * glm::vec4(obj.transform.translation, 1.f)).z;
+      // one material per render system for now
+      return CjhRenderQueue::makeKey(
+          static_cast<uint32_t>(obj.renderSystem), 0, obj.model->getMeshId(), depth);
+    }
+  } // namespace
+
+  void CjhRenderQueue::submitObjects(CjhGameObject::Map &gameObjects, const CjhCamera &camera)
+  {
+    const glm::mat4 &view = camera.getView();
+    packets.reserve(packets.size() + gameObjects.size());
+    for (auto &kv : gameObjects)
+    {
+      auto &obj = kv.second;
+      if (obj.model == nullptr)
+        continue;
+      submit(objectKey(obj, view), obj);
+    }
+  }
+
+  void CjhRenderQueue::submitObjects(const std::vector<CjhGameObject *> &objects, const CjhCamera &camera)
+  {
+    const glm::mat4 &view = camera.getView();
+    packets.reserve(packets.size() + objects.size());
+    for (CjhGameObject *obj : objects)
+    {
+      submit(objectKey(*obj, view), *obj);
+    }
+  }
+
+  // LSD radix sort over the eight key bytes, stable, so equal keys keep their submission order
+  void CjhRenderQueue::sort()
+  {
+    size_t count = packets.size();
+    if (count < 2)
+    {
+      return;
+    }
+
+    // all histograms in one pass over the keys
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (const auto &packet : packets)
+    {
+      for (uint32_t digit = 0; digit < 8; digit++)
+      {
+        histograms[digit][(packet.key >> (digit * 8)) & 0xff]++;
+      }
+    }
+
+    scratch.resize(count);
+    for (uint32_t digit = 0; digit < 8; digit++)
+    {
+      uint32_t shift = digit * 8;
+      auto &histogram = histograms[digit];
+      // a byte every key shares does not reorder anything, e.g. the unused material bits
+      if (histogram[(packets[0].key >> shift) & 0xff] == count)
+      {
+        continue;
+      }
+      uint32_t offset = 0;
+      for (auto &bucket : histogram)
+      {
+        uint32_t size = bucket;
+        bucket = offset;
+        offset += size;
+      }
+      for (const auto &packet : packets)
+      {
+        scratch[histogram[(packet.key >> shift) & 0xff]++] = packet;
+      }
+      packets.swap(scratch);
+    }
+  }
+
+  CjhRenderQueue::Range CjhRenderQueue::range(uint32_t pipeline) const
+  {
+    uint64_t first = static_cast<uint64_t>(pipeline) << (64 - PIPELINE_BITS);
+    auto lower = std::lower_bound(packets.begin(), packets.end(), first, [](const Packet &packet, uint64_t key)
+                                  { return packet.key < key; });
+    auto upper = std::partition_point(lower, packets.end(), [pipeline](const Packet &packet)
+                                      { return pipelineOf(packet.key) == pipeline; });
+    Range result;
+    result.first = packets.data() + (lower - packets.begin());
+    result.last = packets.data() + (upper - packets.begin());
+    return result;
+  }
+
+} // namespace cjh
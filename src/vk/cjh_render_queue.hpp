@@ -0,0 +1,68 @@
+#pragma once
+
+#include "cjh_camera.hpp"
+#include "cjh_game_object.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cjh
+{
+  // Draw packets of the objects drawn this frame. Every packet carries a 64 bit sort key, from the
+  // most significant bits down: pipeline (the render system), material, mesh and view depth. The
+  // queue is radix sorted once per frame, after which each render system draws one contiguous
+  // range and only rebinds when the part of the key that selects the binding changes. Render
+  // thread only.
+  class CjhRenderQueue
+  {
+  public:
+    static constexpr uint32_t PIPELINE_BITS = 8;
+    static constexpr uint32_t MATERIAL_BITS = 16;
+    static constexpr uint32_t MESH_BITS = 20;
+    static constexpr uint32_t DEPTH_BITS = 20;
+
+    struct Packet
+    {
+      uint64_t key;
+      CjhGameObject *object;
+    };
+
+    struct Range
+    {
+      const Packet *first = nullptr;
+      const Packet *last = nullptr;
+
+      const Packet *begin() const { return first; }
+      const Packet *end() const { return last; }
+      bool empty() const { return first == last; }
+      size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    // depth is the view space distance, closer sorts first; the other fields are truncated
+    static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+    static uint32_t pipelineOf(uint64_t key) { return static_cast<uint32_t>(key >> (64 - PIPELINE_BITS)); }
+    static uint32_t materialOf(uint64_t key)
+    {
+      return static_cast<uint32_t>(key >> (MESH_BITS + DEPTH_BITS)) & ((1u << MATERIAL_BITS) - 1);
+    }
+    static uint32_t meshOf(uint64_t key) { return static_cast<uint32_t>(key >> DEPTH_BITS) & ((1u << MESH_BITS) - 1); }
+
+    void clear() { packets.clear(); }
+    void submit(uint64_t key, CjhGameObject &object) { packets.push_back({key, &object}); }
+    // submits a packet for every object with a model
+    void submitObjects(CjhGameObject::Map &gameObjects, const CjhCamera &camera);
+    // the same for a list that was already filtered, e.g. the visible objects of a CjhFrustumCuller
+    void submitObjects(const std::vector<CjhGameObject *> &objects, const CjhCamera &camera);
+    void sort();
+
+    // packets of one pipeline, valid until the next clear()
+    Range range(uint32_t pipeline) const;
+    size_t size() const { return packets.size(); }
+
+  private:
+    std::vector<Packet> packets;
+    std::vector<Packet> scratch;
+  };
+} // namespace cjh
@@ -124,7 +124,7 @@ namespace cjh
     currentFrameIndex = (currentFrameIndex + 1) % CjhSwapChain::MAX_FRAMES_IN_FLIGHT;
   }
 
-  void CjhRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+  void CjhRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, CjhSwapChain::PassPart part)
   {
     assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
     assert(
@@ -133,7 +133,7 @@ namespace cjh
 
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = cjhSwapChain->getRenderPass();
+    renderPassInfo.renderPass = cjhSwapChain->getRenderPass(part);
     renderPassInfo.framebuffer = cjhSwapChain->getFrameBuffer(currentImageIndex);
 
     renderPassInfo.renderArea.offset = {0, 0};
@@ -22,6 +22,8 @@ namespace cjh
 
     VkRenderPass getSwapChainRenderPass() const { return cjhSwapChain->getRenderPass(); }
     float getAspectRatio() const { return cjhSwapChain->extentAspectRatio(); }
+    VkExtent2D getSwapChainExtent() const { return cjhSwapChain->getSwapChainExtent(); }
+    bool isDepthSampleable() const { return cjhSwapChain->isDepthSampleable(); }
     bool isFrameInProgress() const { return isFrameStarted; }
 
     VkCommandBuffer beginSingleTimeCommands();
@@ -33,6 +35,13 @@ namespace cjh
       return commandBuffers[currentFrameIndex];
     }
 
+    // depth attachment of the image being drawn
+    VkImageView getDepthImageView() const
+    {
+      assert(isFrameStarted && "Cannot get depth image view when frame not in progress");
+      return cjhSwapChain->getDepthImageView(currentImageIndex);
+    }
+
     int getFrameIndex() const
     {
       assert(isFrameStarted && "Cannot get frame index when frame not in progress");
@@ -41,7 +50,8 @@ namespace cjh
 
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    void beginSwapChainRenderPass(
+        VkCommandBuffer commandBuffer, CjhSwapChain::PassPart part = CjhSwapChain::PassPart::Whole);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
   private:
@@ -0,0 +1,250 @@
+#include "cjh_scene.hpp"
+
+#include "cjh_vfs.hpp"
+
+// std
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace cjh
+{
+  using namespace scene_format;
+
+  namespace
+  {
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void storeVec3(float (&out)[3], const glm::vec3 &value)
+    {
+      out[0] = value.x;
+      out[1] = value.y;
+      out[2] = value.z;
+    }
+
+    glm::vec3 loadVec3(const float (&in)[3])
+    {
+      return {in[0], in[1], in[2]};
+    }
+
+    bool isFinite(const float (&in)[3])
+    {
+      return std::isfinite(in[0]) && std::isfinite(in[1]) && std::isfinite(in[2]);
+    }
+
+    bool isValid(const Entity &entity, uint32_t assetCount)
+    {
+      return (entity.asset == NO_ASSET || entity.asset < assetCount) && isFinite(entity.translation) &&
+             isFinite(entity.rotation) && isFinite(entity.scale) && isFinite(entity.color) &&
+             std::isfinite(entity.lightIntensity);
+    }
+
+    CjhModel::RenderSystem toModelRenderSystem(RenderSystem renderSystem)
+    {
+      return renderSystem == RenderSystem::Texture ? CjhModel::RenderSystem::Texture : CjhModel::RenderSystem::Simple;
+    }
+  } // namespace
+
+  uint32_t CjhScene::Writer::addModel(const std::string &path, RenderSystem renderSystem)
+  {
+    for (uint32_t i = 0; i < assets.size(); i++)
+    {
+      if (assets[i].renderSystem == renderSystem &&
+          paths.compare(assets[i].pathOffset, assets[i].pathLength, path) == 0)
+      {
+        return i;
+      }
+    }
+
+    Asset asset{};
+    CjhVfs::File file = CjhVfs::shared().tryOpen(path);
+    asset.contentHash = file ? contentHash(file.data(), file.size()) : 0;
+    asset.pathOffset = static_cast<uint32_t>(paths.size());
+    asset.pathLength = static_cast<uint32_t>(path.size());
+    asset.renderSystem = renderSystem;
+    paths += path;
+    assets.push_back(asset);
+    return static_cast<uint32_t>(assets.size() - 1);
+  }
+
+  void CjhScene::Writer::addObject(
+      uint32_t model, const TransformComponent &transform, bool isVulkanModel, glm::vec3 color)
+  {
+    if (model >= assets.size())
+    {
+      throw std::runtime_error("scene object references an unknown model");
+    }
+    Entity entity{};
+    storeVec3(entity.translation, transform.translation);
+    storeVec3(entity.rotation, transform.rotation);
+    storeVec3(entity.scale, transform.scale);
+    storeVec3(entity.color, color);
+    entity.asset = model;
+    entity.flags = isVulkanModel ? static_cast<uint32_t>(FLAG_VULKAN_MODEL) : 0;
+    entities.push_back(entity);
+  }
+
+  void CjhScene::Writer::addPointLight(glm::vec3 position, float intensity, float radius, glm::vec3 color)
+  {
+    Entity entity{};
+    storeVec3(entity.translation, position);
+    storeVec3(entity.scale, {radius, 1.f, 1.f});
+    storeVec3(entity.color, color);
+    entity.asset = NO_ASSET;
+    entity.flags = FLAG_POINT_LIGHT;
+    entity.lightIntensity = intensity;
+    entities.push_back(entity);
+  }
+
+  void CjhScene::Writer::save(const std::string &diskPath) const
+  {
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.assetCount = static_cast<uint32_t>(assets.size());
+    header.entityCount = static_cast<uint32_t>(entities.size());
+    header.assetsOffset = sizeof(Header);
+    header.entitiesOffset = alignUp(header.assetsOffset + assets.size() * sizeof(Asset), alignof(Entity));
+    header.pathsOffset = header.entitiesOffset + entities.size() * sizeof(Entity);
+    header.pathsSize = paths.size();
+
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(diskPath).parent_path();
+    if (!parent.empty())
+    {
+      std::filesystem::create_directories(parent, ec);
+    }
+
+    // written next to the target and renamed, so a running engine never sees half a file
+    std::string temporary = diskPath + ".tmp";
+    {
+      std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+      const char padding[alignof(Entity)] = {};
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char *>(assets.data()), assets.size() * sizeof(Asset));
+      out.write(padding, header.entitiesOffset - header.assetsOffset - assets.size() * sizeof(Asset));
+      out.write(reinterpret_cast<const char *>(entities.data()), entities.size() * sizeof(Entity));
+      out.write(paths.data(), paths.size());
+      if (!out)
+      {
+        throw std::runtime_error("failed to write scene: " + diskPath);
+      }
+    }
+    std::filesystem::rename(temporary, diskPath, ec);
+    if (ec)
+    {
+      std::filesystem::remove(temporary, ec);
+      throw std::runtime_error("failed to write scene: " + diskPath);
+    }
+  }
+
+  CjhScene::LoadStats CjhScene::load(
+      const std::string &path, CjhGameObject::Map &gameObjects, CjhAssetManager &assetManager)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    LoadStats stats{};
+
+    CjhVfs::File file = CjhVfs::shared().open(path);
+    const uint8_t *data = file.data();
+    Header header;
+    if (file.size() < sizeof(Header))
+    {
+      throw std::runtime_error("invalid scene: " + path);
+    }
+    memcpy(&header, data, sizeof(Header));
+    uint64_t assetsEnd = header.assetsOffset + static_cast<uint64_t>(header.assetCount) * sizeof(Asset);
+    uint64_t entitiesEnd = header.entitiesOffset + static_cast<uint64_t>(header.entityCount) * sizeof(Entity);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.assetsOffset % alignof(Asset) != 0 || header.entitiesOffset % alignof(Entity) != 0 ||
+        assetsEnd > file.size() || entitiesEnd > file.size() ||
+        header.pathsOffset + header.pathsSize > file.size())
+    {
+      throw std::runtime_error("invalid scene: " + path);
+    }
+    const Asset *assets = reinterpret_cast<const Asset *>(data + header.assetsOffset);
+    const Entity *entities = reinterpret_cast<const Entity *>(data + header.entitiesOffset);
+    const char *paths = reinterpret_cast<const char *>(data + header.pathsOffset);
+    stats.assetCount = header.assetCount;
+
+    // the asset manager loads each distinct file once, in parallel, and shares models that are
+    // already resident; assets that could not be hashed when the scene was written go by path
+    std::vector<CjhAssetManager::ModelRequest> requests(header.assetCount);
+    for (uint32_t i = 0; i < header.assetCount; i++)
+    {
+      const Asset &asset = assets[i];
+      if (static_cast<uint64_t>(asset.pathOffset) + asset.pathLength > header.pathsSize)
+      {
+        throw std::runtime_error("invalid scene: " + path);
+      }
+      requests[i].path.assign(paths + asset.pathOffset, asset.pathLength);
+      requests[i].contentHash = asset.contentHash;
+    }
+    // every record is checked before anything is loaded, a bad scene must not leave half of it behind
+    for (uint32_t i = 0; i < header.entityCount; i++)
+    {
+      if (!isValid(entities[i], header.assetCount))
+      {
+        throw std::runtime_error("invalid scene: " + path);
+      }
+    }
+    std::vector<std::string> errors;
+    std::vector<std::shared_ptr<CjhModel>> models = assetManager.loadModels(requests, &errors);
+    std::unordered_set<const CjhModel *> distinct;
+    for (uint32_t i = 0; i < header.assetCount; i++)
+    {
+      if (!models[i])
+      {
+        std::cerr << "scene " << path << ": " << errors[i] << std::endl;
+        continue;
+      }
+      distinct.insert(models[i].get());
+    }
+    stats.modelCount = static_cast<uint32_t>(distinct.size());
+
+    // reserved once, so instantiating never rehashes the map
+    gameObjects.reserve(gameObjects.size() + header.entityCount);
+    for (uint32_t i = 0; i < header.entityCount; i++)
+    {
+      const Entity &entity = entities[i];
+      std::shared_ptr<CjhModel> model;
+      RenderSystem renderSystem = RenderSystem::Simple;
+      if (entity.asset != NO_ASSET)
+      {
+        model = models[entity.asset];
+        renderSystem = assets[entity.asset].renderSystem;
+        if (!model)
+        {
+          stats.skippedCount++;
+          continue;
+        }
+      }
+
+      auto object = CjhGameObject::createGameObject();
+      object.transform.translation = loadVec3(entity.translation);
+      object.transform.rotation = loadVec3(entity.rotation);
+      object.transform.scale = loadVec3(entity.scale);
+      object.transform.setIsVulkanModel((entity.flags & FLAG_VULKAN_MODEL) != 0);
+      object.color = loadVec3(entity.color);
+      object.model = std::move(model);
+      object.renderSystem = toModelRenderSystem(renderSystem);
+      if (entity.flags & FLAG_POINT_LIGHT)
+      {
+        object.pointLight = std::make_unique<PointLightComponent>();
+        object.pointLight->lightIntensity = entity.lightIntensity;
+      }
+      gameObjects.emplace(object.getId(), std::move(object));
+      stats.objectCount++;
+    }
+
+    stats.seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    return stats;
+  }
+
+} // namespace cjh
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "cjh_asset_manager.hpp"
+#include "cjh_game_object.hpp"
+#include "cjh_scene_format.hpp"
+
+// std
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  // Binary scenes (see cjh_scene_format.hpp). Loading maps the file, resolves every distinct asset
+  // once through the asset manager, and then instantiates the entities straight out of the
+  // mapping into a game object map that was reserved up front.
+  class CjhScene
+  {
+  public:
+    struct LoadStats
+    {
+      uint32_t objectCount = 0;  // game objects created
+      uint32_t skippedCount = 0; // entities dropped because their asset failed to load
+      uint32_t assetCount = 0;   // entries of the asset table
+      uint32_t modelCount = 0;   // distinct models the scene uses
+      float seconds = 0.f;
+    };
+
+    // Collects a scene in memory and writes it as a .cscene file. Model files are hashed through
+    // the VFS when they are added.
+    class Writer
+    {
+    public:
+      // returns the asset index to pass to addObject(), adding the same model twice is free
+      uint32_t addModel(const std::string &path, scene_format::RenderSystem renderSystem);
+      void addObject(
+          uint32_t model, const TransformComponent &transform, bool isVulkanModel = false, glm::vec3 color = {});
+      void addPointLight(
+          glm::vec3 position, float intensity, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
+
+      // diskPath is a real path, missing directories are created; throws when writing fails
+      void save(const std::string &diskPath) const;
+
+    private:
+      std::vector<scene_format::Asset> assets;
+      std::vector<scene_format::Entity> entities;
+      std::string paths;
+    };
+
+    // Adds every entity of the scene at the VFS path to gameObjects. Throws if the scene is missing
+    // or invalid; an asset that fails to load only drops the entities using it.
+    static LoadStats load(const std::string &path, CjhGameObject::Map &gameObjects, CjhAssetManager &assetManager);
+  };
+} // namespace cjh
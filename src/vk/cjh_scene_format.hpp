@@ -0,0 +1,93 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace cjh
+{
+  // Layout of the .cscene files written by CjhScene::Writer. The file is a Header, the asset
+  // table, the entity array and the path block. Everything is little endian. Entities are fixed
+  // size records that reference assets by table index, so a loader can walk a mapped file in
+  // place and only has to resolve each asset once.
+  namespace scene_format
+  {
+    constexpr char MAGIC[4] = {'C', 'S', 'C', 'N'};
+    constexpr uint32_t VERSION = 1;
+    constexpr const char *EXTENSION = ".cscene";
+    // Entity::asset of entities without a model, e.g. lights
+    constexpr uint32_t NO_ASSET = ~0u;
+
+    enum class RenderSystem : uint32_t
+    {
+      Simple = 0,
+      Texture = 1,
+    };
+
+    enum EntityFlags : uint32_t
+    {
+      // the model uses the Vulkan (y down) convention, see TransformComponent::setIsVulkanModel
+      FLAG_VULKAN_MODEL = 1u << 0,
+      FLAG_POINT_LIGHT = 1u << 1,
+    };
+
+    struct Header
+    {
+      char magic[4];
+      uint32_t version;
+      uint32_t assetCount;
+      uint32_t entityCount;
+      uint64_t assetsOffset; // from the start of the file
+      uint64_t entitiesOffset;
+      uint64_t pathsOffset;
+      uint64_t pathsSize;
+    };
+
+    // Assets are identified by the hash of their file contents, the path only says where to find
+    // them. Two paths with the same contents are loaded once.
+    struct Asset
+    {
+      uint64_t contentHash; // 0 when the file could not be read while writing
+      uint32_t pathOffset;  // from the start of the path block, paths are not null terminated
+      uint32_t pathLength;
+      RenderSystem renderSystem;
+      uint32_t reserved;
+    };
+
+    struct Entity
+    {
+      float translation[3];
+      float rotation[3];
+      float scale[3]; // scale.x is the radius of point lights
+      float color[3];
+      uint32_t asset; // index into the asset table or NO_ASSET
+      uint32_t flags;
+      float lightIntensity; // only used with FLAG_POINT_LIGHT
+      uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 48, "Header layout is part of the file format");
+    static_assert(sizeof(Asset) == 24, "Asset layout is part of the file format");
+    static_assert(sizeof(Entity) == 64, "Entity layout is part of the file format");
+
+    // word at a time FNV-1a variant; never returns 0, which marks unknown contents
+    inline uint64_t contentHash(const uint8_t *data, size_t size)
+    {
+      uint64_t hash = 0xcbf29ce484222325ull ^ size;
+      size_t i = 0;
+      for (; i + 8 <= size; i += 8)
+      {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+      }
+      for (; i < size; i++)
+      {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+      }
+      return hash != 0 ? hash : 1;
+    }
+  } // namespace scene_format
+} // namespace cjh
@@ -0,0 +1,76 @@
+#include "cjh_shader_module_cache.hpp"
+
+#include "cjh_vfs.hpp"
+
+// std
+#include <stdexcept>
+
+namespace cjh
+{
+
+  CjhShaderModuleCache::CjhShaderModuleCache(VkDevice device) : device{device} {}
+
+  CjhShaderModuleCache::~CjhShaderModuleCache()
+  {
+    for (auto &kv : modules)
+    {
+      vkDestroyShaderModule(device, kv.second.get(), nullptr);
+    }
+  }
+
+  VkShaderModule CjhShaderModuleCache::get(const std::string &filepath)
+  {
+    std::promise<VkShaderModule> promise;
+    std::shared_future<VkShaderModule> existing;
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      auto it = modules.find(filepath);
+      if (it != modules.end())
+      {
+        existing = it->second;
+      }
+      else
+      {
+        modules.emplace(filepath, promise.get_future().share());
+      }
+    }
+    if (existing.valid())
+    {
+      return existing.get();
+    }
+
+    // read and create outside the lock, other paths are not held up by this one
+    try
+    {
+      // SPIR-V is handed to the driver straight out of the mapping, which keeps it word aligned
+      CjhVfs::File code = CjhVfs::shared().open(filepath);
+      VkShaderModule module = createShaderModule(code.data(), code.size());
+      promise.set_value(module);
+      return module;
+    }
+    catch (...)
+    {
+      // current waiters see the error, later calls try again
+      promise.set_exception(std::current_exception());
+      std::lock_guard<std::mutex> lock{mutex};
+      modules.erase(filepath);
+      throw;
+    }
+  }
+
+  VkShaderModule CjhShaderModuleCache::createShaderModule(const uint8_t *code, size_t size)
+  {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = reinterpret_cast<const uint32_t *>(code);
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to create shader module");
+    }
+    return shaderModule;
+  }
+
+} // namespace cjh
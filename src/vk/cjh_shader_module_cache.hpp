@@ -0,0 +1,38 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace cjh
+{
+  // Shader modules by SPIR-V path, so pipelines sharing a shader read and create it once. When
+  // several threads ask for the same path at the same time, one of them builds the module and the
+  // others wait for it. Modules live until the cache is destroyed. Thread safe.
+  class CjhShaderModuleCache
+  {
+  public:
+    explicit CjhShaderModuleCache(VkDevice device);
+    ~CjhShaderModuleCache();
+
+    CjhShaderModuleCache(const CjhShaderModuleCache &) = delete;
+    CjhShaderModuleCache &operator=(const CjhShaderModuleCache &) = delete;
+
+    // filepath goes through CjhVfs, so it is relative to the engine root like every other asset path
+    VkShaderModule get(const std::string &filepath);
+
+  private:
+    VkShaderModule createShaderModule(const uint8_t *code, size_t size);
+
+    VkDevice device;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<VkShaderModule>> modules;
+  };
+} // namespace cjh
@@ -0,0 +1,766 @@
+#include "cjh_staging_ring.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace cjh
+{
+  namespace
+  {
+    // everything an uploaded vertex/index buffer or texture is read by
+    constexpr VkPipelineStageFlags CONSUMER_STAGES =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    constexpr VkAccessFlags CONSUMER_ACCESS =
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    // plus the mip blits recorded behind the acquire
+    constexpr VkPipelineStageFlags ACQUIRE_STAGES = CONSUMER_STAGES | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } // namespace
+
+  CjhStagingRing::CjhStagingRing(CjhDevice &device, VkDeviceSize capacity)
+      : cjhDevice{device}, capacity{capacity}
+  {
+    QueueFamilyIndices indices = cjhDevice.findPhysicalQueueFamilies();
+    dedicatedTransfer = cjhDevice.hasDedicatedTransferQueue();
+    graphicsFamily = indices.graphicsFamily;
+    transferFamily = dedicatedTransfer ? indices.transferFamily : indices.graphicsFamily;
+
+    ringBuffer = std::make_unique<CjhBuffer>(
+        cjhDevice,
+        capacity,
+        1,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (ringBuffer->map() != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to map staging ring!");
+    }
+    // the allocator keeps the block mapped and registered with CjhAsyncIo, so reads may target it
+    ringData = static_cast<char *>(ringBuffer->getMappedMemory());
+  }
+
+  CjhStagingRing::~CjhStagingRing()
+  {
+    flush();
+    while (!inFlight.empty())
+    {
+      retireOldest();
+    }
+    for (auto &submission : idle)
+    {
+      vkDestroyFence(cjhDevice.device(), submission.fence, nullptr);
+      vkFreeCommandBuffers(cjhDevice.device(), cjhDevice.getTransferCommandPool(), 1, &submission.commandBuffer);
+      if (submission.transferSemaphore != VK_NULL_HANDLE)
+      {
+        vkDestroySemaphore(cjhDevice.device(), submission.transferSemaphore, nullptr);
+      }
+      if (submission.acquireCommandBuffer != VK_NULL_HANDLE)
+      {
+        vkDestroyFence(cjhDevice.device(), submission.acquireFence, nullptr);
+        vkFreeCommandBuffers(cjhDevice.device(), cjhDevice.getCommandPool(), 1, &submission.acquireCommandBuffer);
+      }
+    }
+  }
+
+  void CjhStagingRing::uploadBuffer(const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+  {
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset;
+    void *staged = reserve(size, 4, srcBuffer, srcOffset);
+    memcpy(staged, data, static_cast<size_t>(size));
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(recordingCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+    if (dedicatedTransfer)
+    {
+      recording.bufferTransfers.push_back({dstBuffer, dstOffset, size});
+    }
+  }
+
+  void CjhStagingRing::copyBuffer(
+      std::unique_ptr<CjhBuffer> stagingBuffer,
+      VkBuffer dstBuffer,
+      VkDeviceSize size,
+      VkDeviceSize dstOffset)
+  {
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(recordingCommandBuffer(), stagingBuffer->getBuffer(), dstBuffer, 1, &copyRegion);
+    recording.stagingBuffers.push_back(std::move(stagingBuffer));
+    if (dedicatedTransfer)
+    {
+      recording.bufferTransfers.push_back({dstBuffer, dstOffset, size});
+    }
+  }
+
+  CjhStagingRing::ImageUploadBuilder::ImageUploadBuilder(CjhStagingRing &stagingRing, VkImage image)
+      : stagingRing{stagingRing}, image{image} {}
+
+  CjhStagingRing::ImageUploadBuilder &CjhStagingRing::ImageUploadBuilder::setSubresourceCount(
+      uint32_t mipLevels,
+      uint32_t arrayLayers)
+  {
+    this->mipLevels = mipLevels;
+    this->arrayLayers = arrayLayers;
+    return *this;
+  }
+
+  CjhStagingRing::ImageUploadBuilder &CjhStagingRing::ImageUploadBuilder::generateMipmaps()
+  {
+    generateMips = true;
+    return *this;
+  }
+
+  CjhStagingRing::ImageUploadBuilder &CjhStagingRing::ImageUploadBuilder::addRegion(
+      uint32_t mipLevel,
+      uint32_t arrayLayer,
+      uint32_t width,
+      uint32_t height,
+      const void *data,
+      VkDeviceSize size)
+  {
+    assert(mipLevel < mipLevels && arrayLayer < arrayLayers && "Region outside of the image");
+    assert((!generateMips || mipLevel == 0) && "Generated levels are not uploaded");
+    regions.push_back({mipLevel, arrayLayer, width, height, data, size});
+    return *this;
+  }
+
+  CjhStagingRing::ImageUploadBuilder &CjhStagingRing::ImageUploadBuilder::setPackedData(const void *data, VkDeviceSize size)
+  {
+    assert(regions.empty() && "Set the packed data before adding regions");
+    packedData = data;
+    packedSize = size;
+    return *this;
+  }
+
+  CjhStagingRing::ImageUploadBuilder &CjhStagingRing::ImageUploadBuilder::addPackedRegion(
+      uint32_t mipLevel,
+      uint32_t arrayLayer,
+      uint32_t width,
+      uint32_t height,
+      VkDeviceSize offset)
+  {
+    assert(packedData != nullptr && "Packed regions need packed data");
+    assert(offset % 16 == 0 && offset < packedSize && "Packed region outside of the data");
+    assert(mipLevel < mipLevels && arrayLayer < arrayLayers && "Region outside of the image");
+    regions.push_back({mipLevel, arrayLayer, width, height, nullptr, offset});
+    return *this;
+  }
+
+  void CjhStagingRing::ImageUploadBuilder::record()
+  {
+    // buffer offsets of image copies must be a multiple of 4 and of the texel or block size
+    auto alignUp = [](VkDeviceSize value)
+    { return (value + 15) & ~VkDeviceSize{15}; };
+
+    VkDeviceSize totalSize = packedSize;
+    for (const auto &region : regions)
+    {
+      if (region.data != nullptr)
+      {
+        totalSize = alignUp(totalSize) + region.size;
+      }
+    }
+
+    // a single reservation, so a flush forced by a full ring cannot split the image
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset;
+    char *staged = static_cast<char *>(stagingRing.reserve(totalSize, 16, srcBuffer, srcOffset));
+
+    ImageTransfer transfer{image, mipLevels, arrayLayers, generateMips, 0, 0, srcBuffer, {}};
+    if (!regions.empty())
+    {
+      transfer.width = regions[0].width;
+      transfer.height = regions[0].height;
+    }
+    transfer.copies.reserve(regions.size());
+    if (packedData != nullptr)
+    {
+      memcpy(staged, packedData, static_cast<size_t>(packedSize));
+    }
+    VkDeviceSize offset = packedSize;
+    for (const auto &region : regions)
+    {
+      VkDeviceSize regionOffset = region.size;
+      if (region.data != nullptr)
+      {
+        offset = alignUp(offset);
+        memcpy(staged + offset, region.data, static_cast<size_t>(region.size));
+        regionOffset = offset;
+        offset += region.size;
+      }
+
+      VkBufferImageCopy copy{};
+      copy.bufferOffset = srcOffset + regionOffset;
+      copy.bufferRowLength = 0;
+      copy.bufferImageHeight = 0;
+      copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      copy.imageSubresource.mipLevel = region.mipLevel;
+      copy.imageSubresource.baseArrayLayer = region.arrayLayer;
+      copy.imageSubresource.layerCount = 1;
+      copy.imageOffset = {0, 0, 0};
+      copy.imageExtent = {region.width, region.height, 1};
+      transfer.copies.push_back(copy);
+    }
+    stagingRing.recording.imageTransfers.push_back(std::move(transfer));
+    regions.clear();
+    packedData = nullptr;
+    packedSize = 0;
+  }
+
+  uint64_t CjhStagingRing::flush()
+  {
+    acquireCompleted();
+    if (!isRecording)
+    {
+      return 0;
+    }
+
+    recordImageCopies(recording);
+    if (dedicatedTransfer)
+    {
+      recordOwnershipTransfer(recording, recording.commandBuffer, true);
+    }
+    else
+    {
+      // make the copies visible to every later submission on this queue
+      VkMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = CONSUMER_ACCESS;
+      vkCmdPipelineBarrier(
+          recording.commandBuffer,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          CONSUMER_STAGES,
+          0,
+          1, &barrier,
+          0, nullptr,
+          0, nullptr);
+    }
+    vkEndCommandBuffer(recording.commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &recording.commandBuffer;
+    if (dedicatedTransfer)
+    {
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &recording.transferSemaphore;
+    }
+    if (vkQueueSubmit(cjhDevice.transferQueue(), 1, &submitInfo, recording.fence) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to submit staging ring uploads!");
+    }
+
+    recording.id = nextSubmission++;
+    uint64_t id = recording.id;
+    if (!dedicatedTransfer)
+    {
+      // same queue as the frames, submission order already makes it available
+      recording.acquired = true;
+      acquiredSubmission = id;
+    }
+    inFlight.push_back(std::move(recording));
+    recording = Submission{};
+    isRecording = false;
+
+    retireCompleted();
+    return id;
+  }
+
+  bool CjhStagingRing::isComplete(uint64_t submission)
+  {
+    acquireCompleted();
+    retireCompleted();
+    return submission <= acquiredSubmission;
+  }
+
+  void CjhStagingRing::wait(uint64_t submission)
+  {
+    if (submission >= nextSubmission)
+    {
+      flush();
+    }
+    for (auto &pending : inFlight)
+    {
+      if (acquiredSubmission >= submission)
+      {
+        break;
+      }
+      if (!pending.acquired)
+      {
+        vkWaitForFences(cjhDevice.device(), 1, &pending.fence, VK_TRUE, UINT64_MAX);
+        acquire(pending);
+      }
+    }
+  }
+
+  void *CjhStagingRing::reserve(VkDeviceSize size, VkDeviceSize alignment, VkBuffer &buffer, VkDeviceSize &offset)
+  {
+    if (size > capacity)
+    {
+      auto stagingBuffer = std::make_unique<CjhBuffer>(
+          cjhDevice,
+          size,
+          1,
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+      stagingBuffer->map();
+      buffer = stagingBuffer->getBuffer();
+      offset = 0;
+      void *mapped = stagingBuffer->getMappedMemory();
+      recordingCommandBuffer();
+      recording.stagingBuffers.push_back(std::move(stagingBuffer));
+      return mapped;
+    }
+
+    while (!tryReserve(size, alignment, offset))
+    {
+      // the space is held by uploads that were never submitted, hand them to the GPU first
+      if (inFlight.empty())
+      {
+        flush();
+      }
+      retireOldest();
+    }
+    buffer = ringBuffer->getBuffer();
+    return ringData + offset;
+  }
+
+  bool CjhStagingRing::tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+  {
+    if (usedBytes == 0)
+    {
+      head = 0;
+    }
+
+    VkDeviceSize start = (head + alignment - 1) & ~(alignment - 1);
+    VkDeviceSize consumed;
+    if (start + size <= capacity)
+    {
+      consumed = start - head + size;
+    }
+    else
+    {
+      // wrap around, the tail of the ring stays unused until this upload retires
+      start = 0;
+      consumed = capacity - head + size;
+    }
+    if (usedBytes + consumed > capacity)
+    {
+      return false;
+    }
+
+    recordingCommandBuffer();
+    offset = start;
+    head = start + size;
+    usedBytes += consumed;
+    recording.ringBytes += consumed;
+    return true;
+  }
+
+  VkCommandBuffer CjhStagingRing::recordingCommandBuffer()
+  {
+    if (isRecording)
+    {
+      return recording.commandBuffer;
+    }
+
+    if (!idle.empty())
+    {
+      recording = std::move(idle.back());
+      idle.pop_back();
+      vkResetFences(cjhDevice.device(), 1, &recording.fence);
+    }
+    else
+    {
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandPool = cjhDevice.getTransferCommandPool();
+      allocInfo.commandBufferCount = 1;
+      if (vkAllocateCommandBuffers(cjhDevice.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to allocate staging command buffer!");
+      }
+
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      if (vkCreateFence(cjhDevice.device(), &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create staging fence!");
+      }
+
+      if (dedicatedTransfer)
+      {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(cjhDevice.device(), &semaphoreInfo, nullptr, &recording.transferSemaphore) != VK_SUCCESS)
+        {
+          throw std::runtime_error("failed to create staging semaphore!");
+        }
+      }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+    isRecording = true;
+    return recording.commandBuffer;
+  }
+
+  void CjhStagingRing::recordImageCopies(Submission &submission)
+  {
+    if (submission.imageTransfers.empty())
+    {
+      return;
+    }
+
+    auto makeBarrier = [](const ImageTransfer &transfer)
+    {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = transfer.image;
+      barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      barrier.subresourceRange.baseMipLevel = 0;
+      barrier.subresourceRange.levelCount = transfer.mipLevels;
+      barrier.subresourceRange.baseArrayLayer = 0;
+      barrier.subresourceRange.layerCount = transfer.arrayLayers;
+      return barrier;
+    };
+
+    // one barrier for every image recorded since the last flush, then all copies
+    std::vector<VkImageMemoryBarrier> barriers;
+    barriers.reserve(submission.imageTransfers.size());
+    for (const auto &transfer : submission.imageTransfers)
+    {
+      VkImageMemoryBarrier barrier = makeBarrier(transfer);
+      barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barriers.push_back(barrier);
+    }
+    vkCmdPipelineBarrier(
+        submission.commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    for (const auto &transfer : submission.imageTransfers)
+    {
+      vkCmdCopyBufferToImage(
+          submission.commandBuffer,
+          transfer.srcBuffer,
+          transfer.image,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          static_cast<uint32_t>(transfer.copies.size()),
+          transfer.copies.data());
+    }
+
+    if (dedicatedTransfer)
+    {
+      // the layout change to shader read happens as part of the ownership transfer
+      return;
+    }
+
+    barriers.clear();
+    for (const auto &transfer : submission.imageTransfers)
+    {
+      if (transfer.generateMips)
+      {
+        recordMipBlits(submission.commandBuffer, transfer);
+        continue;
+      }
+      VkImageMemoryBarrier barrier = makeBarrier(transfer);
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      barriers.push_back(barrier);
+    }
+    vkCmdPipelineBarrier(
+        submission.commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+  }
+
+  void CjhStagingRing::recordMipBlits(VkCommandBuffer commandBuffer, const ImageTransfer &transfer)
+  {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = transfer.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = transfer.arrayLayers;
+
+    int32_t mipWidth = static_cast<int32_t>(transfer.width);
+    int32_t mipHeight = static_cast<int32_t>(transfer.height);
+    for (uint32_t level = 1; level < transfer.mipLevels; level++)
+    {
+      // the previous level is complete, read it for the blit
+      barrier.subresourceRange.baseMipLevel = level - 1;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      vkCmdPipelineBarrier(
+          commandBuffer,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          0,
+          0, nullptr,
+          0, nullptr,
+          1, &barrier);
+
+      int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+      int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+      VkImageBlit blit{};
+      blit.srcOffsets[0] = {0, 0, 0};
+      blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel = level - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount = transfer.arrayLayers;
+      blit.dstOffsets[0] = {0, 0, 0};
+      blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel = level;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount = transfer.arrayLayers;
+      vkCmdBlitImage(
+          commandBuffer,
+          transfer.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          transfer.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          1, &blit,
+          VK_FILTER_LINEAR);
+
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(
+          commandBuffer,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          0,
+          0, nullptr,
+          0, nullptr,
+          1, &barrier);
+
+      mipWidth = nextWidth;
+      mipHeight = nextHeight;
+    }
+
+    barrier.subresourceRange.baseMipLevel = transfer.mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+  }
+
+  void CjhStagingRing::recordOwnershipTransfer(Submission &submission, VkCommandBuffer commandBuffer, bool release)
+  {
+    // release and acquire must describe the same ranges, layouts and families
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    bufferBarriers.reserve(submission.bufferTransfers.size());
+    for (const auto &transfer : submission.bufferTransfers)
+    {
+      VkBufferMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+      barrier.dstAccessMask = release ? 0 : CONSUMER_ACCESS;
+      barrier.srcQueueFamilyIndex = transferFamily;
+      barrier.dstQueueFamilyIndex = graphicsFamily;
+      barrier.buffer = transfer.buffer;
+      barrier.offset = transfer.offset;
+      barrier.size = transfer.size;
+      bufferBarriers.push_back(barrier);
+    }
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(submission.imageTransfers.size());
+    for (const auto &transfer : submission.imageTransfers)
+    {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      // images with generated mips stay in TRANSFER_DST, the blits run after the acquire
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = transfer.generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+      barrier.dstAccessMask = release                ? 0
+                              : transfer.generateMips ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+                                                      : VK_ACCESS_SHADER_READ_BIT;
+      barrier.srcQueueFamilyIndex = transferFamily;
+      barrier.dstQueueFamilyIndex = graphicsFamily;
+      barrier.image = transfer.image;
+      barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      barrier.subresourceRange.baseMipLevel = 0;
+      barrier.subresourceRange.levelCount = transfer.mipLevels;
+      barrier.subresourceRange.baseArrayLayer = 0;
+      barrier.subresourceRange.layerCount = transfer.arrayLayers;
+      imageBarriers.push_back(barrier);
+    }
+
+    if (bufferBarriers.empty() && imageBarriers.empty())
+    {
+      return;
+    }
+    // the acquire waits on the transfer semaphore at the acquire stages, so it uses them as its
+    // source scope as well
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        release ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TRANSFER_BIT) : ACQUIRE_STAGES,
+        release ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT) : ACQUIRE_STAGES,
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+  }
+
+  void CjhStagingRing::acquire(Submission &submission)
+  {
+    assert(dedicatedTransfer && !submission.acquired && "Only transfer queue submissions need an acquire");
+
+    if (submission.acquireCommandBuffer == VK_NULL_HANDLE)
+    {
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandPool = cjhDevice.getCommandPool();
+      allocInfo.commandBufferCount = 1;
+      if (vkAllocateCommandBuffers(cjhDevice.device(), &allocInfo, &submission.acquireCommandBuffer) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to allocate acquire command buffer!");
+      }
+
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      if (vkCreateFence(cjhDevice.device(), &fenceInfo, nullptr, &submission.acquireFence) != VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to create acquire fence!");
+      }
+    }
+    else
+    {
+      vkResetFences(cjhDevice.device(), 1, &submission.acquireFence);
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(submission.acquireCommandBuffer, &beginInfo);
+    recordOwnershipTransfer(submission, submission.acquireCommandBuffer, false);
+    // blits need a graphics capable queue
+    for (const auto &transfer : submission.imageTransfers)
+    {
+      if (transfer.generateMips)
+      {
+        recordMipBlits(submission.acquireCommandBuffer, transfer);
+      }
+    }
+    vkEndCommandBuffer(submission.acquireCommandBuffer);
+
+    VkPipelineStageFlags waitStage = ACQUIRE_STAGES;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &submission.transferSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &submission.acquireCommandBuffer;
+    if (vkQueueSubmit(cjhDevice.graphicsQueue(), 1, &submitInfo, submission.acquireFence) != VK_SUCCESS)
+    {
+      throw std::runtime_error("failed to submit upload acquire!");
+    }
+
+    submission.acquired = true;
+    acquiredSubmission = submission.id;
+  }
+
+  void CjhStagingRing::acquireCompleted()
+  {
+    for (auto &pending : inFlight)
+    {
+      if (pending.acquired)
+      {
+        continue;
+      }
+      // acquires go out in flush order, a later transfer never overtakes an earlier one
+      if (vkGetFenceStatus(cjhDevice.device(), pending.fence) != VK_SUCCESS)
+      {
+        break;
+      }
+      acquire(pending);
+    }
+  }
+
+  bool CjhStagingRing::isRetirable(Submission &submission)
+  {
+    if (!submission.acquired || vkGetFenceStatus(cjhDevice.device(), submission.fence) != VK_SUCCESS)
+    {
+      return false;
+    }
+    return !dedicatedTransfer || vkGetFenceStatus(cjhDevice.device(), submission.acquireFence) == VK_SUCCESS;
+  }
+
+  void CjhStagingRing::retireCompleted()
+  {
+    while (!inFlight.empty() && isRetirable(inFlight.front()))
+    {
+      retireOldest();
+    }
+  }
+
+  void CjhStagingRing::retireOldest()
+  {
+    Submission &oldest = inFlight.front();
+    vkWaitForFences(cjhDevice.device(), 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+    if (dedicatedTransfer)
+    {
+      if (!oldest.acquired)
+      {
+        acquire(oldest);
+      }
+      vkWaitForFences(cjhDevice.device(), 1, &oldest.acquireFence, VK_TRUE, UINT64_MAX);
+    }
+
+    usedBytes -= oldest.ringBytes;
+    oldest.ringBytes = 0;
+    oldest.acquired = false;
+    oldest.stagingBuffers.clear();
+    oldest.bufferTransfers.clear();
+    oldest.imageTransfers.clear();
+    idle.push_back(std::move(oldest));
+    inFlight.pop_front();
+  }
+
+} // namespace cjh
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "cjh_buffer.hpp"
+#include "cjh_device.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace cjh
+{
+  // One persistently mapped staging buffer used as a ring. Uploads are copied into it and
+  // recorded into a shared transfer command buffer; flush() submits everything recorded so far
+  // with a single fence, and ring space is reclaimed once that fence signalled. Nothing here waits
+  // for the queue to go idle.
+  //
+  // With a dedicated transfer queue the copies run there and the resources are released to the
+  // graphics family. The matching acquire is only submitted to the graphics queue (waiting on the
+  // transfer semaphore) once the transfer finished, so streaming never stalls frame rendering.
+  // Without one everything runs on the graphics queue and is ready as soon as it was flushed.
+  // Render thread only.
+  class CjhStagingRing
+  {
+  public:
+    static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull * 1024 * 1024;
+
+    // Collects the tightly packed data of every mip level / array layer of one color image. All
+    // images recorded until the next flush share one barrier into TRANSFER_DST, their copies and
+    // one barrier (or ownership release) into SHADER_READ_ONLY. With generateMipmaps() only level
+    // 0 is uploaded and the other levels are blitted from it on the graphics queue; the format
+    // must support linear filtered blits and the image TRANSFER_SRC usage.
+    class ImageUploadBuilder
+    {
+    public:
+      ImageUploadBuilder(CjhStagingRing &stagingRing, VkImage image);
+
+      ImageUploadBuilder &setSubresourceCount(uint32_t mipLevels, uint32_t arrayLayers);
+      ImageUploadBuilder &generateMipmaps();
+      ImageUploadBuilder &addRegion(
+          uint32_t mipLevel,
+          uint32_t arrayLayer,
+          uint32_t width,
+          uint32_t height,
+          const void *data,
+          VkDeviceSize size);
+      // For data that is already laid out for staging (e.g. a baked texture): the whole blob is
+      // staged with one memcpy and packed regions point into it. Offsets must be multiples of 16.
+      ImageUploadBuilder &setPackedData(const void *data, VkDeviceSize size);
+      ImageUploadBuilder &addPackedRegion(
+          uint32_t mipLevel,
+          uint32_t arrayLayer,
+          uint32_t width,
+          uint32_t height,
+          VkDeviceSize offset);
+      // stages the data; the copies go out with the ring's next flush
+      void record();
+
+    private:
+      struct Region
+      {
+        uint32_t mipLevel;
+        uint32_t arrayLayer;
+        uint32_t width;
+        uint32_t height;
+        const void *data; // nullptr for packed regions
+        VkDeviceSize size; // offset into the packed data for packed regions
+      };
+
+      CjhStagingRing &stagingRing;
+      VkImage image;
+      uint32_t mipLevels = 1;
+      uint32_t arrayLayers = 1;
+      bool generateMips = false;
+      const void *packedData = nullptr;
+      VkDeviceSize packedSize = 0;
+      std::vector<Region> regions{};
+    };
+
+    CjhStagingRing(CjhDevice &device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+    ~CjhStagingRing();
+
+    CjhStagingRing(const CjhStagingRing &) = delete;
+    CjhStagingRing &operator=(const CjhStagingRing &) = delete;
+
+    void uploadBuffer(const void *data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+    // for data that was already staged elsewhere (e.g. on a worker thread); the staging buffer is
+    // released together with the submission that copies it
+    void copyBuffer(
+        std::unique_ptr<CjhBuffer> stagingBuffer,
+        VkBuffer dstBuffer,
+        VkDeviceSize size,
+        VkDeviceSize dstOffset = 0);
+
+    // id the uploads recorded right now will be flushed under (or an earlier one)
+    uint64_t pendingSubmission() const { return nextSubmission; }
+
+    // Call once per frame before the frame is submitted: hands finished transfers over to the
+    // graphics queue and submits the uploads recorded so far. Returns their submission id, 0 when
+    // nothing was recorded.
+    uint64_t flush();
+    // true once graphics submissions made from now on may use the uploads of that submission
+    bool isComplete(uint64_t submission);
+    // blocks until isComplete(submission), flushing first if needed
+    void wait(uint64_t submission);
+    void finish() { wait(pendingSubmission()); }
+
+    VkDeviceSize getCapacity() const { return capacity; }
+    VkDeviceSize getUsedBytes() const { return usedBytes; }
+
+  private:
+    struct BufferTransfer
+    {
+      VkBuffer buffer;
+      VkDeviceSize offset;
+      VkDeviceSize size;
+    };
+
+    struct ImageTransfer
+    {
+      VkImage image;
+      uint32_t mipLevels;
+      uint32_t arrayLayers;
+      // level 0 extent, the remaining levels are blitted from it
+      bool generateMips;
+      uint32_t width;
+      uint32_t height;
+      VkBuffer srcBuffer;
+      std::vector<VkBufferImageCopy> copies;
+    };
+
+    struct Submission
+    {
+      uint64_t id = 0;
+      VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+      VkFence fence = VK_NULL_HANDLE;
+      // only used with a dedicated transfer queue
+      VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+      VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+      VkFence acquireFence = VK_NULL_HANDLE;
+      bool acquired = false;
+
+      VkDeviceSize ringBytes = 0;
+      std::vector<std::unique_ptr<CjhBuffer>> stagingBuffers;
+      std::vector<BufferTransfer> bufferTransfers;
+      std::vector<ImageTransfer> imageTransfers;
+    };
+
+    // returns a mapped pointer into the ring, flushing and waiting for old submissions when full;
+    // requests larger than the ring get a one off staging buffer instead
+    void *reserve(VkDeviceSize size, VkDeviceSize alignment, VkBuffer &buffer, VkDeviceSize &offset);
+    bool tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+    VkCommandBuffer recordingCommandBuffer();
+    void recordImageCopies(Submission &submission);
+    // expects every level in TRANSFER_DST with level 0 written, leaves them all shader readable
+    void recordMipBlits(VkCommandBuffer commandBuffer, const ImageTransfer &transfer);
+    void recordOwnershipTransfer(Submission &submission, VkCommandBuffer commandBuffer, bool release);
+    void acquire(Submission &submission);
+    // acquires every submission whose transfer finished, in order
+    void acquireCompleted();
+    void retireCompleted();
+    void retireOldest();
+    bool isRetirable(Submission &submission);
+
+    CjhDevice &cjhDevice;
+    VkDeviceSize capacity;
+    std::unique_ptr<CjhBuffer> ringBuffer;
+    char *ringData = nullptr;
+
+    bool dedicatedTransfer;
+    uint32_t transferFamily;
+    uint32_t graphicsFamily;
+
+    // next write position and bytes between the oldest unretired upload and head, including
+    // padding and the skipped tail when wrapping
+    VkDeviceSize head = 0;
+    VkDeviceSize usedBytes = 0;
+
+    Submission recording{};
+    bool isRecording = false;
+    std::deque<Submission> inFlight;
+    std::vector<Submission> idle;
+    uint64_t nextSubmission = 1;
+    uint64_t acquiredSubmission = 0;
+  };
+} // namespace cjh
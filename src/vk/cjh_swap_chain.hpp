@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -18,6 +19,16 @@ namespace cjh
   public:
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+    // A frame is drawn in one render pass, or in two around work that reads the depth attachment:
+    // the first part keeps color and leaves depth readable by shaders, the second resumes on top
+    // of both and presents. All three are compatible with the same framebuffers and pipelines.
+    enum class PassPart
+    {
+      Whole,
+      BeforeDepthRead,
+      AfterDepthRead
+    };
+
     CjhSwapChain(CjhDevice &deviceRef, VkExtent2D windowExtent);
     CjhSwapChain(
         CjhDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<CjhSwapChain> previous);
@@ -28,7 +39,10 @@ namespace cjh
     CjhSwapChain &operator=(const CjhSwapChain &) = delete;
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-    VkRenderPass getRenderPass() { return renderPass; }
+    VkRenderPass getRenderPass(PassPart part = PassPart::Whole) { return renderPasses[static_cast<size_t>(part)]; }
+    // in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL between the two parts of a split frame
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+    bool isDepthSampleable() const { return depthSampleable; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
@@ -57,6 +71,7 @@ namespace cjh
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    VkRenderPass createRenderPass(PassPart part);
     void createFramebuffers();
     void createSyncObjects();
 
@@ -72,11 +87,12 @@ namespace cjh
     VkExtent2D swapChainExtent;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
+    std::array<VkRenderPass, 3> renderPasses{};
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<CjhAllocation> depthImageAllocations;
     std::vector<VkImageView> depthImageViews;
+    bool depthSampleable = false;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
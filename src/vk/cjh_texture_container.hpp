@@ -0,0 +1,83 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace cjh
+{
+  // Layout of the .ctex files written by the texture baker (tools/texture_baker). The file is a
+  // Header, one LevelEntry per mip level and array layer (level major), then the texel data of
+  // every level back to back. Everything is little endian. The data block is laid out exactly
+  // as it is copied into a staging buffer, so loading it is a single memcpy.
+  namespace texture_container
+  {
+    constexpr char MAGIC[4] = {'C', 'T', 'E', 'X'};
+    constexpr uint32_t VERSION = 1;
+    // start of the data block and of every level inside it, enough for any texel / block size
+    constexpr uint64_t DATA_ALIGNMENT = 16;
+    constexpr const char *EXTENSION = ".ctex";
+
+    enum class Encoding : uint32_t
+    {
+      Rgba8 = 0,
+      Bc1 = 1, // opaque, 8 bytes per 4x4 block
+      Bc3 = 2, // with alpha, 16 bytes per 4x4 block
+    };
+
+    enum Flags : uint32_t
+    {
+      FLAG_SRGB = 1u << 0,
+    };
+
+    struct Header
+    {
+      char magic[4];
+      uint32_t version;
+      Encoding encoding;
+      uint32_t flags;
+      uint32_t width;
+      uint32_t height;
+      uint32_t mipLevels;
+      uint32_t arrayLayers;
+      uint64_t dataOffset; // from the start of the file
+      uint64_t dataSize;
+    };
+
+    struct LevelEntry
+    {
+      uint64_t offset; // from the start of the data block
+      uint64_t size;
+      uint32_t width;
+      uint32_t height;
+      uint32_t mipLevel;
+      uint32_t arrayLayer;
+    };
+
+    static_assert(sizeof(Header) == 48, "Header layout is part of the file format");
+    static_assert(sizeof(LevelEntry) == 32, "LevelEntry layout is part of the file format");
+
+    // bytes of one mip level, block compressed levels are padded to whole 4x4 blocks
+    inline uint64_t levelSize(Encoding encoding, uint32_t width, uint32_t height)
+    {
+      if (encoding == Encoding::Rgba8)
+      {
+        return static_cast<uint64_t>(width) * height * 4;
+      }
+      uint64_t blocks = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4);
+      return blocks * (encoding == Encoding::Bc1 ? 8 : 16);
+    }
+
+    // "textures/wood.png" -> "textures/wood.ctex"
+    inline std::string bakedPath(const std::string &sourcePath)
+    {
+      size_t slash = sourcePath.find_last_of("/\\");
+      size_t dot = sourcePath.find_last_of('.');
+      if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      {
+        return sourcePath + EXTENSION;
+      }
+      return sourcePath.substr(0, dot) + EXTENSION;
+    }
+  } // namespace texture_container
+} // namespace cjh
@@ -0,0 +1,143 @@
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace cjh
+{
+
+  CjhThreadPool::CjhThreadPool(uint32_t threadCount)
+  {
+    if (threadCount == 0)
+    {
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+      workers.emplace_back([this]()
+                           { workerLoop(); });
+    }
+  }
+
+  CjhThreadPool::~CjhThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  CjhThreadPool &CjhThreadPool::shared()
+  {
+    static CjhThreadPool pool{};
+    return pool;
+  }
+
+  void CjhThreadPool::enqueue(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      tasks.emplace_back(std::move(task));
+    }
+    condition.notify_one();
+  }
+
+  void CjhThreadPool::workerLoop()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{mutex};
+        condition.wait(lock, [this]()
+                       { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty())
+        {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  void CjhThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &body)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+    if (count == 1)
+    {
+      body(0);
+      return;
+    }
+
+    // helpers may only get scheduled after the caller already drained the range, so everything
+    // they touch lives in a shared block instead of on this stack frame
+    struct Range
+    {
+      std::function<void(uint32_t)> body;
+      uint32_t count;
+      std::atomic<uint32_t> next{0};
+      std::atomic<uint32_t> done{0};
+      std::mutex mutex;
+      std::condition_variable finished;
+      std::exception_ptr error;
+    };
+    auto range = std::make_shared<Range>();
+    range->body = body;
+    range->count = count;
+
+    auto drain = [](Range &r)
+    {
+      uint32_t i;
+      while ((i = r.next.fetch_add(1)) < r.count)
+      {
+        try
+        {
+          r.body(i);
+        }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock{r.mutex};
+          if (!r.error)
+          {
+            r.error = std::current_exception();
+          }
+        }
+        if (r.done.fetch_add(1) + 1 == r.count)
+        {
+          std::lock_guard<std::mutex> lock{r.mutex};
+          r.finished.notify_all();
+        }
+      }
+    };
+
+    uint32_t helpers = std::min(count - 1, threadCount());
+    for (uint32_t i = 0; i < helpers; i++)
+    {
+      enqueue([range, drain]()
+              { drain(*range); });
+    }
+    drain(*range);
+
+    std::unique_lock<std::mutex> lock{range->mutex};
+    range->finished.wait(lock, [&]()
+                         { return range->done.load() == range->count; });
+    if (range->error)
+    {
+      std::rethrow_exception(range->error);
+    }
+  }
+
+} // namespace cjh
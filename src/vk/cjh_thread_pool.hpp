@@ -0,0 +1,57 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cjh
+{
+  class CjhThreadPool
+  {
+  public:
+    // threadCount 0 picks one worker per hardware thread
+    explicit CjhThreadPool(uint32_t threadCount = 0);
+    ~CjhThreadPool();
+
+    CjhThreadPool(const CjhThreadPool &) = delete;
+    CjhThreadPool &operator=(const CjhThreadPool &) = delete;
+
+    // process wide pool for short CPU bound jobs (parsing, welding, ...)
+    static CjhThreadPool &shared();
+
+    template <typename Task>
+    auto submit(Task &&task) -> std::future<std::invoke_result_t<std::decay_t<Task>>>
+    {
+      using Result = std::invoke_result_t<std::decay_t<Task>>;
+      auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+      std::future<Result> result = packaged->get_future();
+      enqueue([packaged]()
+              { (*packaged)(); });
+      return result;
+    }
+
+    // Runs body(i) for every i in [0, count) and returns once all of them finished.
+    // The calling thread works on the range as well, so this is safe to call from a worker.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)> &body);
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+  private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+  };
+} // namespace cjh
@@ -55,7 +55,7 @@ namespace cjh
         init_info.Device = m_pDevice->device();
         init_info.QueueFamily = m_pDevice->findPhysicalQueueFamilies().graphicsFamily;
         init_info.Queue = m_pDevice->graphicsQueue();
-        init_info.PipelineCache = VK_NULL_HANDLE;
+        init_info.PipelineCache = m_pDevice->pipelineCache();
         init_info.DescriptorPool = m_UIdescriptorPool;
         init_info.Subpass = 0;
         init_info.MinImageCount = 3;
@@ -0,0 +1,274 @@
+#include "cjh_vertex_weld.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace cjh
+{
+  namespace
+  {
+    constexpr uint32_t VERTEX_WORDS = sizeof(CjhModel::Vertex) / sizeof(uint32_t);
+    static_assert(sizeof(CjhModel::Vertex) == 44, "vertex is expected to be 11 tightly packed floats");
+
+    inline uint64_t mix(uint64_t hash)
+    {
+      hash ^= hash >> 31;
+      hash *= 0xbf58476d1ce4e5b9ull;
+      hash ^= hash >> 29;
+      return hash;
+    }
+
+    // Hashes the raw float bits two words at a time. -0.0 is folded onto 0.0 so that vertices
+    // which compare equal also hash equal.
+    uint32_t hashVertex(const CjhModel::Vertex &vertex)
+    {
+      uint32_t words[VERTEX_WORDS];
+      std::memcpy(words, &vertex, sizeof(words));
+      uint64_t hash = 0x9e3779b97f4a7c15ull;
+      uint32_t i = 0;
+      for (; i + 1 < VERTEX_WORDS; i += 2)
+      {
+        uint64_t low = (words[i] & 0x7fffffffu) ? words[i] : 0u;
+        uint64_t high = (words[i + 1] & 0x7fffffffu) ? words[i + 1] : 0u;
+        hash = mix(hash ^ (low | (high << 32)));
+      }
+      if (i < VERTEX_WORDS)
+      {
+        hash = mix(hash ^ ((words[i] & 0x7fffffffu) ? words[i] : 0u));
+      }
+      return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    uint32_t hashCell(int32_t x, int32_t y, int32_t z)
+    {
+      uint64_t hash = static_cast<uint32_t>(x) * 0x8da6b343ull;
+      hash ^= static_cast<uint32_t>(y) * 0xd8163841ull;
+      hash ^= static_cast<uint64_t>(static_cast<uint32_t>(z)) * 0xcb1ab31full;
+      hash = mix(hash);
+      return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    // the cell of a scaled coordinate; far out (and NaN) positions share the outermost cells, where
+    // the distance test still tells them apart
+    int32_t cellCoordinate(float scaled)
+    {
+      double cell = std::floor(static_cast<double>(scaled));
+      if (!(cell > static_cast<double>(INT32_MIN)))
+      {
+        return INT32_MIN;
+      }
+      if (cell >= static_cast<double>(INT32_MAX))
+      {
+        return INT32_MAX;
+      }
+      return static_cast<int32_t>(cell);
+    }
+
+    size_t tableCapacityFor(size_t count)
+    {
+      size_t capacity = 64;
+      while (capacity < count * 2)
+      {
+        capacity *= 2;
+      }
+      return capacity;
+    }
+  } // namespace
+
+  CjhVertexWeldTable::CjhVertexWeldTable(
+      std::vector<CjhModel::Vertex> &vertices, size_t expectedVertexCount, float epsilon)
+      : vertices{vertices},
+        epsilon{epsilon},
+        inverseCellSize{epsilon > 0.0f ? 0.5f / epsilon : 0.0f}
+  {
+    size_t capacity = tableCapacityFor(expectedVertexCount);
+    mask = static_cast<uint32_t>(capacity - 1);
+    if (epsilon > 0.0f)
+    {
+      cells.assign(capacity, Cell{0, 0, 0, EMPTY});
+      nextInCell.reserve(vertices.size() + expectedVertexCount);
+      nextInCell.resize(vertices.size(), EMPTY);
+    }
+    else
+    {
+      slots.assign(capacity, Slot{0, EMPTY});
+    }
+    vertices.reserve(vertices.size() + expectedVertexCount);
+  }
+
+  uint32_t CjhVertexWeldTable::findOrInsert(const CjhModel::Vertex &vertex)
+  {
+    return epsilon > 0.0f ? findOrInsertNear(vertex) : findOrInsertExact(vertex);
+  }
+
+  uint32_t CjhVertexWeldTable::findOrInsertExact(const CjhModel::Vertex &vertex)
+  {
+    if ((size + 1) * 4 > slots.size() * 3)
+    {
+      growSlots();
+    }
+
+    uint32_t hash = hashVertex(vertex);
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+    {
+      Slot &slot = slots[i];
+      if (slot.index == EMPTY)
+      {
+        slot = {hash, static_cast<uint32_t>(vertices.size())};
+        vertices.push_back(vertex);
+        size++;
+        return slot.index;
+      }
+      if (slot.hash == hash && vertices[slot.index] == vertex)
+      {
+        return slot.index;
+      }
+    }
+  }
+
+  void CjhVertexWeldTable::growSlots()
+  {
+    std::vector<Slot> oldSlots(slots.size() * 2, Slot{0, EMPTY});
+    oldSlots.swap(slots);
+    mask = static_cast<uint32_t>(slots.size() - 1);
+    for (const auto &slot : oldSlots)
+    {
+      if (slot.index == EMPTY)
+      {
+        continue;
+      }
+      uint32_t i = slot.hash & mask;
+      while (slots[i].index != EMPTY)
+      {
+        i = (i + 1) & mask;
+      }
+      slots[i] = slot;
+    }
+  }
+
+  bool CjhVertexWeldTable::isNear(const CjhModel::Vertex &a, const CjhModel::Vertex &b) const
+  {
+    float lhs[VERTEX_WORDS];
+    float rhs[VERTEX_WORDS];
+    std::memcpy(lhs, &a, sizeof(lhs));
+    std::memcpy(rhs, &b, sizeof(rhs));
+    for (uint32_t i = 0; i < VERTEX_WORDS; i++)
+    {
+      if (!(std::fabs(lhs[i] - rhs[i]) <= epsilon))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint32_t *CjhVertexWeldTable::findCell(int32_t x, int32_t y, int32_t z)
+  {
+    for (uint32_t i = hashCell(x, y, z) & mask;; i = (i + 1) & mask)
+    {
+      Cell &cell = cells[i];
+      if (cell.head == EMPTY)
+      {
+        return nullptr;
+      }
+      if (cell.x == x && cell.y == y && cell.z == z)
+      {
+        return &cell.head;
+      }
+    }
+  }
+
+  uint32_t &CjhVertexWeldTable::cellHead(int32_t x, int32_t y, int32_t z)
+  {
+    if ((cellCount + 1) * 4 > cells.size() * 3)
+    {
+      growCells();
+    }
+    for (uint32_t i = hashCell(x, y, z) & mask;; i = (i + 1) & mask)
+    {
+      Cell &cell = cells[i];
+      if (cell.head == EMPTY)
+      {
+        cell = {x, y, z, EMPTY};
+        cellCount++;
+        return cell.head;
+      }
+      if (cell.x == x && cell.y == y && cell.z == z)
+      {
+        return cell.head;
+      }
+    }
+  }
+
+  void CjhVertexWeldTable::growCells()
+  {
+    std::vector<Cell> oldCells(cells.size() * 2, Cell{0, 0, 0, EMPTY});
+    oldCells.swap(cells);
+    mask = static_cast<uint32_t>(cells.size() - 1);
+    for (const auto &cell : oldCells)
+    {
+      if (cell.head == EMPTY)
+      {
+        continue;
+      }
+      uint32_t i = hashCell(cell.x, cell.y, cell.z) & mask;
+      while (cells[i].head != EMPTY)
+      {
+        i = (i + 1) & mask;
+      }
+      cells[i] = cell;
+    }
+  }
+
+  uint32_t CjhVertexWeldTable::findOrInsertNear(const CjhModel::Vertex &vertex)
+  {
+    // cells are two epsilon wide, so the epsilon box around the position overlaps at most two
+    // cells per axis; take the oldest match so the result does not depend on traversal order
+    const glm::vec3 &position = vertex.position;
+    int32_t minX = cellCoordinate((position.x - epsilon) * inverseCellSize);
+    int32_t minY = cellCoordinate((position.y - epsilon) * inverseCellSize);
+    int32_t minZ = cellCoordinate((position.z - epsilon) * inverseCellSize);
+    int32_t maxX = cellCoordinate((position.x + epsilon) * inverseCellSize);
+    int32_t maxY = cellCoordinate((position.y + epsilon) * inverseCellSize);
+    int32_t maxZ = cellCoordinate((position.z + epsilon) * inverseCellSize);
+
+    // 64 bit counters, the last cell may be INT32_MAX
+    uint32_t match = EMPTY;
+    for (int64_t z = minZ; z <= maxZ; z++)
+    {
+      for (int64_t y = minY; y <= maxY; y++)
+      {
+        for (int64_t x = minX; x <= maxX; x++)
+        {
+          uint32_t *head = findCell(static_cast<int32_t>(x), static_cast<int32_t>(y), static_cast<int32_t>(z));
+          for (uint32_t candidate = head ? *head : EMPTY; candidate != EMPTY; candidate = nextInCell[candidate])
+          {
+            if (candidate < match && isNear(vertices[candidate], vertex))
+            {
+              match = candidate;
+            }
+          }
+        }
+      }
+    }
+    if (match != EMPTY)
+    {
+      return match;
+    }
+
+    uint32_t &head = cellHead(
+        cellCoordinate(position.x * inverseCellSize),
+        cellCoordinate(position.y * inverseCellSize),
+        cellCoordinate(position.z * inverseCellSize));
+    uint32_t index = static_cast<uint32_t>(vertices.size());
+    vertices.push_back(vertex);
+    nextInCell.push_back(head);
+    head = index;
+    size++;
+    return index;
+  }
+
+} // namespace cjh
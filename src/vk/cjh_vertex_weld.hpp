@@ -0,0 +1,65 @@
+#pragma once
+
+#include "cjh_model.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace cjh
+{
+  // Deduplicates vertices into an output array and hands back their index.
+  //
+  // With epsilon == 0 vertices are welded when they compare equal, using a flat open addressing
+  // table (linear probing, no per entry allocation). With epsilon > 0 a vertex is welded onto an
+  // earlier one when every attribute lies within epsilon of it; candidates are found through a
+  // spatial hash of the position quantized to cells two epsilon wide.
+  class CjhVertexWeldTable
+  {
+  public:
+    CjhVertexWeldTable(std::vector<CjhModel::Vertex> &vertices, size_t expectedVertexCount, float epsilon = 0.0f);
+
+    CjhVertexWeldTable(const CjhVertexWeldTable &) = delete;
+    CjhVertexWeldTable &operator=(const CjhVertexWeldTable &) = delete;
+
+    uint32_t findOrInsert(const CjhModel::Vertex &vertex);
+
+  private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot
+    {
+      uint32_t hash;
+      uint32_t index;
+    };
+
+    struct Cell
+    {
+      int32_t x, y, z;
+      uint32_t head;
+    };
+
+    uint32_t findOrInsertExact(const CjhModel::Vertex &vertex);
+    uint32_t findOrInsertNear(const CjhModel::Vertex &vertex);
+    uint32_t &cellHead(int32_t x, int32_t y, int32_t z);
+    uint32_t *findCell(int32_t x, int32_t y, int32_t z);
+    bool isNear(const CjhModel::Vertex &a, const CjhModel::Vertex &b) const;
+    void growSlots();
+    void growCells();
+
+    std::vector<CjhModel::Vertex> &vertices;
+    float epsilon;
+    float inverseCellSize;
+
+    // exact mode
+    std::vector<Slot> slots;
+
+    // epsilon mode: cells chain their vertices through nextInCell
+    std::vector<Cell> cells;
+    size_t cellCount = 0;
+    std::vector<uint32_t> nextInCell;
+
+    uint32_t mask = 0;
+    size_t size = 0;
+  };
+} // namespace cjh
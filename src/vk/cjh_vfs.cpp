@@ -0,0 +1,339 @@
+#include "cjh_vfs.hpp"
+
+#include "cjh_async_io.hpp"
+#include "cjh_mapped_file.hpp"
+#include "cjh_pak_format.hpp"
+
+// libs
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#ifndef ENGINE_PATH
+#define ENGINE_PATH "../"
+#endif
+
+namespace cjh
+{
+  using namespace pak_format;
+
+  struct CjhVfs::Archive
+  {
+    std::string path;
+    std::unique_ptr<CjhMappedFile> file;
+    const Entry *entries = nullptr;
+    uint32_t entryCount = 0;
+    const char *names = nullptr;
+
+    const Entry *find(const std::string &name) const
+    {
+      auto compare = [this](const Entry &entry, const std::string &key)
+      {
+        size_t length = std::min<size_t>(entry.nameLength, key.size());
+        int order = memcmp(names + entry.nameOffset, key.data(), length);
+        return order < 0 || (order == 0 && entry.nameLength < key.size());
+      };
+      const Entry *end = entries + entryCount;
+      const Entry *it = std::lower_bound(entries, end, name, compare);
+      if (it == end || it->nameLength != name.size() ||
+          memcmp(names + it->nameOffset, name.data(), name.size()) != 0)
+      {
+        return nullptr;
+      }
+      return it;
+    }
+  };
+
+  namespace
+  {
+    bool isAbsolute(const std::string &path)
+    {
+      return std::filesystem::path(path).is_absolute();
+    }
+
+    // chunks are independent zlib streams, so they decode in parallel straight into place
+    std::shared_ptr<std::vector<uint8_t>> inflateEntry(
+        const Entry &entry, const uint8_t *stored, const std::string &name, CjhThreadPool &pool)
+    {
+      auto decoded = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(entry.originalSize));
+      std::vector<uint64_t> chunkOffsets(entry.chunkCount + 1);
+      chunkOffsets[0] = chunkTableSize(entry.chunkCount);
+      for (uint32_t i = 0; i < entry.chunkCount; i++)
+      {
+        uint32_t chunkSize;
+        memcpy(&chunkSize, stored + i * sizeof(uint32_t), sizeof(chunkSize));
+        chunkOffsets[i + 1] = chunkOffsets[i] + chunkSize;
+      }
+      if (chunkOffsets.back() > entry.size)
+      {
+        throw std::runtime_error("corrupt archive entry: " + name);
+      }
+      pool.parallelFor(
+          entry.chunkCount,
+          [&](uint32_t i)
+          {
+            uint64_t begin = i * CHUNK_SIZE;
+            int expected = static_cast<int>(std::min(CHUNK_SIZE, entry.originalSize - begin));
+            int written = stbi_zlib_decode_buffer(
+                reinterpret_cast<char *>(decoded->data() + begin),
+                expected,
+                reinterpret_cast<const char *>(stored + chunkOffsets[i]),
+                static_cast<int>(chunkOffsets[i + 1] - chunkOffsets[i]));
+            if (written != expected)
+            {
+              throw std::runtime_error("corrupt archive entry: " + name);
+            }
+          });
+      return decoded;
+    }
+  } // namespace
+
+  CjhVfs::CjhVfs(std::string looseRoot) : looseRoot{std::move(looseRoot)} {}
+
+  CjhVfs::~CjhVfs() = default;
+
+  CjhVfs &CjhVfs::shared()
+  {
+    static CjhVfs *vfs = []()
+    {
+      auto *instance = new CjhVfs{ENGINE_PATH};
+      std::string archive = std::string{ENGINE_PATH} + "assets" + EXTENSION;
+      std::error_code ec;
+      if (std::filesystem::exists(archive, ec))
+      {
+        instance->mount(archive);
+      }
+      return instance;
+    }();
+    return *vfs;
+  }
+
+  void CjhVfs::mount(const std::string &archivePath)
+  {
+    auto archive = std::make_shared<Archive>();
+    archive->path = archivePath;
+    archive->file = std::make_unique<CjhMappedFile>(archivePath);
+    const uint8_t *data = archive->file->data();
+    size_t size = archive->file->size();
+
+    Header header;
+    if (size < sizeof(Header))
+    {
+      throw std::runtime_error("invalid archive: " + archivePath);
+    }
+    memcpy(&header, data, sizeof(Header));
+    uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(Entry);
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.tocOffset % alignof(Entry) != 0 || header.tocOffset + tocSize > size ||
+        header.namesOffset + header.namesSize > size)
+    {
+      throw std::runtime_error("invalid archive: " + archivePath);
+    }
+    archive->entries = reinterpret_cast<const Entry *>(data + header.tocOffset);
+    archive->entryCount = header.entryCount;
+    archive->names = reinterpret_cast<const char *>(data + header.namesOffset);
+
+    // validate once here so lookups can trust the table
+    for (uint32_t i = 0; i < archive->entryCount; i++)
+    {
+      const Entry &entry = archive->entries[i];
+      bool stored = entry.compression == Compression::None && entry.size == entry.originalSize;
+      bool deflated = entry.compression == Compression::Deflate &&
+                      entry.chunkCount == chunkCount(entry.originalSize) &&
+                      entry.size >= chunkTableSize(entry.chunkCount);
+      if ((!stored && !deflated) || entry.offset % ENTRY_ALIGNMENT != 0 || entry.offset + entry.size > size ||
+          static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header.namesSize)
+      {
+        throw std::runtime_error("invalid archive entry in " + archivePath);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    archives.push_back(std::move(archive));
+  }
+
+  CjhVfs::File CjhVfs::open(const std::string &path, CjhThreadPool &pool) const
+  {
+    File file = tryOpen(path, pool);
+    if (!file)
+    {
+      throw std::runtime_error("failed to open file: " + path);
+    }
+    return file;
+  }
+
+  CjhVfs::File CjhVfs::tryOpen(const std::string &path, CjhThreadPool &pool) const
+  {
+    std::string loose = loosePath(path);
+    if (!loose.empty())
+    {
+      auto mapping = std::make_shared<CjhMappedFile>(loose);
+      return File{mapping->data(), mapping->size(), mapping};
+    }
+    if (isAbsolute(path))
+    {
+      return File{};
+    }
+
+    std::string name = normalizePath(path);
+    auto mounted = mountedArchives();
+    for (auto it = mounted.rbegin(); it != mounted.rend(); ++it)
+    {
+      const Entry *entry = (*it)->find(name);
+      if (!entry)
+      {
+        continue;
+      }
+      const uint8_t *stored = (*it)->file->data() + entry->offset;
+      if (entry->compression == Compression::None)
+      {
+        return File{stored, static_cast<size_t>(entry->size), *it};
+      }
+
+      auto decoded = inflateEntry(*entry, stored, name, pool);
+      return File{decoded->data(), decoded->size(), decoded};
+    }
+    return File{};
+  }
+
+  void CjhVfs::openAsync(const std::string &path, CjhAsyncIo &io, std::function<void(File)> callback) const
+  {
+    Location location;
+    std::shared_ptr<const Archive> archive;
+    const Entry *entry = nullptr;
+    if (!locate(path, location, archive, entry))
+    {
+      callback(File{});
+      return;
+    }
+
+    uint64_t size = location.size;
+    auto buffer = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(size));
+    auto onRead = [buffer, size, entry, archive, path, callback](const CjhAsyncIo::Result &result)
+    {
+      if (result.error != 0 || result.bytesRead != size)
+      {
+        callback(File{});
+        return;
+      }
+      if (!entry || entry->compression == Compression::None)
+      {
+        callback(File{buffer->data(), buffer->size(), buffer});
+        return;
+      }
+      // I/O threads must not block, decoding happens on the pool
+      CjhThreadPool::shared().submit([buffer, entry, archive, path, callback]()
+                                     {
+        File decoded{};
+        try
+        {
+          auto inflated = inflateEntry(*entry, buffer->data(), path, CjhThreadPool::shared());
+          decoded = File{inflated->data(), inflated->size(), inflated};
+        }
+        catch (const std::exception &)
+        {
+        }
+        callback(std::move(decoded)); });
+    };
+    try
+    {
+      io.read(location.diskPath, location.offset, size, buffer->data(), std::move(onRead));
+    }
+    catch (const std::exception &)
+    {
+      callback(File{});
+    }
+  }
+
+  bool CjhVfs::locate(const std::string &path, Location &location) const
+  {
+    std::shared_ptr<const Archive> archive;
+    const Entry *entry = nullptr;
+    return locate(path, location, archive, entry);
+  }
+
+  bool CjhVfs::locate(
+      const std::string &path,
+      Location &location,
+      std::shared_ptr<const Archive> &archive,
+      const Entry *&entry) const
+  {
+    location = {};
+    std::string diskPath = loosePath(path);
+    if (!diskPath.empty())
+    {
+      std::error_code ec;
+      location.size = std::filesystem::file_size(diskPath, ec);
+      location.diskPath = std::move(diskPath);
+      return !ec;
+    }
+    if (isAbsolute(path))
+    {
+      return false;
+    }
+
+    std::string name = normalizePath(path);
+    auto mounted = mountedArchives();
+    for (auto it = mounted.rbegin(); it != mounted.rend(); ++it)
+    {
+      entry = (*it)->find(name);
+      if (entry)
+      {
+        archive = *it;
+        location.diskPath = archive->path;
+        location.offset = entry->offset;
+        location.size = entry->size;
+        location.compressed = entry->compression != Compression::None;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool CjhVfs::exists(const std::string &path) const
+  {
+    if (!loosePath(path).empty())
+    {
+      return true;
+    }
+    if (isAbsolute(path))
+    {
+      return false;
+    }
+    std::string name = normalizePath(path);
+    for (const auto &archive : mountedArchives())
+    {
+      if (archive->find(name))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string CjhVfs::loosePath(const std::string &path) const
+  {
+    std::error_code ec;
+    if (isAbsolute(path))
+    {
+      return std::filesystem::is_regular_file(path, ec) ? path : std::string{};
+    }
+    if (!looseOverrides)
+    {
+      return {};
+    }
+    std::string diskPath = looseRoot + path;
+    return std::filesystem::is_regular_file(diskPath, ec) ? diskPath : std::string{};
+  }
+
+  std::vector<std::shared_ptr<const CjhVfs::Archive>> CjhVfs::mountedArchives() const
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    return archives;
+  }
+
+} // namespace cjh
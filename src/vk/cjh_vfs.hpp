@@ -0,0 +1,106 @@
+#pragma once
+
+#include "cjh_thread_pool.hpp"
+
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  class CjhAsyncIo;
+
+  namespace pak_format
+  {
+    struct Entry;
+  }
+
+  // Read-only virtual filesystem every asset loader goes through. Paths are relative to the
+  // engine root and resolve to a loose file under that root when one exists (so edited assets
+  // show up without rebuilding the archive), otherwise to the newest mounted .pak archive that
+  // has them. Absolute paths, e.g. dropped files, always go to disk. Thread safe.
+  class CjhVfs
+  {
+  public:
+    // Zero-copy view of a file. Loose files and stored archive entries point straight into a
+    // mapping, compressed entries into their decoded copy. The view keeps its backing alive.
+    class File
+    {
+    public:
+      File() = default;
+      File(const uint8_t *data, size_t size, std::shared_ptr<const void> owner)
+          : bytes{data}, byteCount{size}, owner{std::move(owner)} {}
+
+      const uint8_t *data() const { return bytes; }
+      size_t size() const { return byteCount; }
+      explicit operator bool() const { return owner != nullptr; }
+
+    private:
+      const uint8_t *bytes = nullptr;
+      size_t byteCount = 0;
+      std::shared_ptr<const void> owner;
+    };
+
+    // where the stored bytes of a path live on disk: a whole loose file or a slice of an archive
+    struct Location
+    {
+      std::string diskPath;
+      uint64_t offset = 0;
+      uint64_t size = 0;
+      bool compressed = false; // the stored bytes are not the file contents
+    };
+
+    explicit CjhVfs(std::string looseRoot);
+    ~CjhVfs();
+
+    CjhVfs(const CjhVfs &) = delete;
+    CjhVfs &operator=(const CjhVfs &) = delete;
+
+    // process wide instance rooted at the engine root, assets.pak is mounted when present
+    static CjhVfs &shared();
+
+    // entries of later archives shadow those of earlier ones; throws if the archive is invalid
+    void mount(const std::string &archivePath);
+    // loose files are on by default, shipping builds can turn them off to only read archives
+    void setLooseOverrides(bool enabled) { looseOverrides = enabled; }
+
+    // throws when the path exists nowhere; compressed entries are decoded on the pool
+    File open(const std::string &path, CjhThreadPool &pool = CjhThreadPool::shared()) const;
+    // same as open(), but returns an empty File for a missing path
+    File tryOpen(const std::string &path, CjhThreadPool &pool = CjhThreadPool::shared()) const;
+    // Reads the file into a new buffer through the async I/O backend instead of faulting in a
+    // mapping, compressed entries are decoded on the shared pool afterwards. The callback gets an
+    // empty File when the path does not exist or the read failed; it runs on an I/O or pool
+    // thread, or right away when the path is unknown. Queued reads go out with io.flush().
+    void openAsync(const std::string &path, CjhAsyncIo &io, std::function<void(File)> callback) const;
+    // for readers that want the bytes somewhere specific, e.g. straight in staging memory
+    bool locate(const std::string &path, Location &location) const;
+    bool exists(const std::string &path) const;
+    // disk path of the loose file a path resolves to, empty when it only exists in an archive
+    std::string loosePath(const std::string &path) const;
+    // where new loose files go, e.g. generated assets; ends with a separator
+    const std::string &getLooseRoot() const { return looseRoot; }
+
+  private:
+    struct Archive;
+
+    std::vector<std::shared_ptr<const Archive>> mountedArchives() const;
+    // also hands out the entry of archived paths, archive keeps it alive
+    bool locate(
+        const std::string &path,
+        Location &location,
+        std::shared_ptr<const Archive> &archive,
+        const pak_format::Entry *&entry) const;
+
+    std::string looseRoot;
+    std::atomic<bool> looseOverrides{true};
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<const Archive>> archives;
+  };
+} // namespace cjh
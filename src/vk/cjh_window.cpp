@@ -49,10 +49,10 @@ namespace cjh
 
   void CjhWindow::dropCallback(GLFWwindow *window, int count, const char **paths)
   {
-    int i;
-    for (i = 0; i < count; i++)
+    auto cjhWindow = reinterpret_cast<CjhWindow *>(glfwGetWindowUserPointer(window));
+    for (int i = 0; i < count; i++)
     {
-      // std::cout << (std::string(paths[i])) << std::endl;
+      cjhWindow->droppedPaths.emplace_back(paths[i]);
     }
   }
 
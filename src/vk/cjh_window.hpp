@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 
 #include <string>
+#include <utility>
+#include <vector>
 namespace cjh
 {
 
@@ -21,6 +23,8 @@ namespace cjh
     bool wasWindowResized() { return framebufferResized; }
     void resetWindowResizedFlag() { framebufferResized = false; }
     GLFWwindow *getGLFWwindow() const { return window; }
+    // paths dropped onto the window since the last call
+    std::vector<std::string> takeDroppedPaths() { return std::exchange(droppedPaths, {}); }
 
     void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
 
@@ -35,6 +39,7 @@ namespace cjh
     int width;
     int height;
     bool framebufferResized = false;
+    std::vector<std::string> droppedPaths;
 
     std::string windowName;
     GLFWwindow *window;
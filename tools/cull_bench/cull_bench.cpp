@@ -0,0 +1,127 @@
+// Frustum culling benchmark: fills a CjhFrustumCuller with random world boxes around a camera and
+// times the plane tests with the SIMD path and with the scalar loop. Needs no window or device.
+//
+//   CullBench [count] [iterations]
+//
+// count defaults to 100000 boxes, iterations to 100 culls per path; the reported ns/object is the
+// average over the iterations.
+
+#include "vk/cjh_camera.hpp"
+#include "vk/cjh_frustum_culler.hpp"
+
+// std
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace cjh
+{
+  namespace
+  {
+    struct Options
+    {
+      uint32_t count = 100000;
+      uint32_t iterations = 100;
+    };
+
+    struct Result
+    {
+      uint32_t testedCount = 0;
+      uint32_t visibleCount = 0;
+      float nanosecondsPerObject = 0.f;
+    };
+
+    Options parseOptions(int argc, char **argv)
+    {
+      Options options{};
+      if (argc > 3)
+      {
+        throw std::runtime_error("usage: CullBench [count] [iterations]");
+      }
+      if (argc > 1)
+      {
+        options.count = static_cast<uint32_t>(std::stoul(argv[1]));
+      }
+      if (argc > 2)
+      {
+        options.iterations = static_cast<uint32_t>(std::stoul(argv[2]));
+      }
+      if (options.iterations == 0)
+      {
+        throw std::runtime_error("iterations must be at least 1");
+      }
+      return options;
+    }
+
+    Result run(CjhFrustumCuller &culler, const std::array<glm::vec4, 6> &planes, uint32_t iterations, bool useSimd)
+    {
+      Result result{};
+      for (uint32_t i = 0; i < iterations; i++)
+      {
+        culler.cull(planes, useSimd);
+        result.nanosecondsPerObject += culler.stats().nanosecondsPerObject;
+      }
+      result.testedCount = culler.stats().testedCount;
+      result.visibleCount = culler.stats().visibleCount;
+      result.nanosecondsPerObject /= static_cast<float>(iterations);
+      return result;
+    }
+
+    void print(const std::string &name, const Result &result)
+    {
+      std::cout << name << ": " << result.testedCount << " tested, " << result.visibleCount << " visible, "
+                << result.nanosecondsPerObject << " ns/object\n";
+    }
+
+    void benchmark(const Options &options)
+    {
+      // a fixed seed keeps runs comparable
+      std::mt19937 random{1234};
+      std::uniform_real_distribution<float> position{-100.f, 100.f};
+      std::uniform_real_distribution<float> halfSize{0.1f, 2.f};
+
+      CjhFrustumCuller culler;
+      for (uint32_t i = 0; i < options.count; i++)
+      {
+        glm::vec3 center{position(random), position(random), position(random)};
+        glm::vec3 extent{halfSize(random), halfSize(random), halfSize(random)};
+        culler.add(center, extent, nullptr);
+      }
+
+      CjhCamera camera{};
+      camera.setViewDirection(glm::vec3{0.f}, glm::vec3{0.f, 0.f, 1.f});
+      camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, 100.f);
+      const auto planes = camera.getFrustumPlanes();
+
+      Result simd = run(culler, planes, options.iterations, true);
+      Result scalar = run(culler, planes, options.iterations, false);
+      print("simd (" + std::to_string(CjhFrustumCuller::laneCount()) + " lanes)", simd);
+      print("scalar", scalar);
+      if (simd.visibleCount != scalar.visibleCount)
+      {
+        throw std::runtime_error("the SIMD and scalar paths disagree on the visible count");
+      }
+      if (simd.nanosecondsPerObject > 0.f)
+      {
+        std::cout << "speedup: " << scalar.nanosecondsPerObject / simd.nanosecondsPerObject << "x\n";
+      }
+    }
+  } // namespace
+} // namespace cjh
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    cjh::benchmark(cjh::parseOptions(argc, argv));
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
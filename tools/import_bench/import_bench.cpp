@@ -0,0 +1,160 @@
+// Model import benchmark: imports the same models through CjhModelImporter twice, first without
+// mesh caches so the sources are parsed (and the caches written), then through the warm caches
+// that are read straight into staging memory. Prints how many bytes each path copies per MiB it
+// stages, and how long it took. Both passes run on copies of the models in a scratch directory,
+// the mesh caches next to the originals are left alone.
+//
+//   ImportBench [model]...
+//
+// Models are CjhVfs paths of loose .obj files and default to the vases and the colored cube. A
+// Vulkan device is needed for the staging buffers, its window is hidden right away.
+
+#include "vk/cjh_device.hpp"
+#include "vk/cjh_model_importer.hpp"
+#include "vk/cjh_staging_ring.hpp"
+#include "vk/cjh_vfs.hpp"
+#include "vk/cjh_window.hpp"
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cjh
+{
+  namespace
+  {
+    struct Result
+    {
+      CjhModelImporter::Stats stats{};
+      double milliseconds = 0.0;
+    };
+
+    std::vector<std::string> parseModels(int argc, char **argv)
+    {
+      std::vector<std::string> models{argv + 1, argv + argc};
+      if (models.empty())
+      {
+        models = {"models/smooth_vase.obj", "models/flat_vase.obj", "models/colored_cube.obj"};
+      }
+      for (const auto &model : models)
+      {
+        if (CjhVfs::shared().loosePath(model).empty())
+        {
+          throw std::runtime_error("not a loose file: " + model + "\nusage: ImportBench [model]...");
+        }
+      }
+      return models;
+    }
+
+    // copies of the models without mesh caches, removed again with the directory
+    class ScratchCopies
+    {
+    public:
+      explicit ScratchCopies(const std::vector<std::string> &models)
+          : directory{std::filesystem::temp_directory_path() /
+                      ("ImportBench-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))}
+      {
+        std::filesystem::create_directories(directory);
+        for (size_t i = 0; i < models.size(); i++)
+        {
+          std::filesystem::path source = CjhVfs::shared().loosePath(models[i]);
+          // the index keeps models of the same name in different directories apart
+          std::filesystem::path copy = directory / (std::to_string(i) + "_" + source.filename().string());
+          std::filesystem::copy_file(source, copy);
+          copies.push_back(copy.string());
+        }
+      }
+
+      ~ScratchCopies()
+      {
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+      }
+
+      ScratchCopies(const ScratchCopies &) = delete;
+      ScratchCopies &operator=(const ScratchCopies &) = delete;
+
+      // absolute, so CjhVfs reads them from disk
+      const std::vector<std::string> &paths() const { return copies; }
+
+    private:
+      std::filesystem::path directory;
+      std::vector<std::string> copies;
+    };
+
+    // requests every model and drives the importer the way the render loop does until all are in
+    Result importAll(CjhDevice &device, const std::vector<std::string> &models)
+    {
+      CjhModelImporter importer{device};
+      auto start = std::chrono::steady_clock::now();
+      for (const auto &model : models)
+      {
+        importer.request(model);
+      }
+      size_t importedCount = 0;
+      while (importer.pendingCount() > 0)
+      {
+        device.stagingRing().flush();
+        importedCount += importer.poll().size();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (importedCount != models.size())
+      {
+        throw std::runtime_error("some models failed to import");
+      }
+
+      Result result{};
+      result.milliseconds =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      result.stats = importer.stats();
+      return result;
+    }
+
+    void print(const std::string &name, const Result &result)
+    {
+      constexpr double MIB = 1024.0 * 1024.0;
+      double stagedMiB = result.stats.stagedBytes / MIB;
+      double copiedPerStagedMiB = stagedMiB > 0.0 ? result.stats.copiedBytes / stagedMiB : 0.0;
+      std::cout << name << ": " << stagedMiB << " MiB staged, " << result.stats.copiedBytes / MIB
+                << " MiB copied, " << static_cast<uint64_t>(copiedPerStagedMiB) << " bytes copied per staged MiB, "
+                << result.milliseconds << " ms\n";
+    }
+
+    void benchmark(const std::vector<std::string> &models)
+    {
+      CjhWindow window{64, 64, "ImportBench"};
+      glfwHideWindow(window.getGLFWwindow());
+      CjhDevice device{window};
+
+      ScratchCopies copies{models};
+      Result parsed = importAll(device, copies.paths());
+      Result cached = importAll(device, copies.paths());
+      device.stagingRing().finish();
+
+      std::cout << models.size() << " models\n";
+      print("parse", parsed);
+      print("warm cache", cached);
+    }
+  } // namespace
+} // namespace cjh
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    cjh::benchmark(cjh::parseModels(argc, argv));
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,330 @@
+// Asset archive builder: packs files below the engine root into a .pak archive (see
+// src/vk/cjh_pak_format.hpp) that CjhVfs maps and reads in place.
+//
+//   PakBuilder <output> <root> <path>... [--store]
+//
+// Paths are relative to root, directories are packed recursively. Entries are deflated in
+// parallel chunks when that saves at least an eighth of their size, --store disables compression.
+// Mesh cache sidecars are only packed while they are fresh for their source.
+
+#include "vk/cjh_pak_format.hpp"
+#include "vk/cjh_thread_pool.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  namespace
+  {
+    using namespace pak_format;
+    namespace fs = std::filesystem;
+
+    constexpr const char *MESH_CACHE_EXTENSION = ".cjhmesh";
+    // already compressed formats are not worth a deflate pass
+    constexpr const char *STORED_EXTENSIONS[] = {".jpg", ".jpeg", ".png", ".pak"};
+
+    struct Options
+    {
+      std::string output;
+      fs::path root;
+      std::vector<std::string> paths;
+      bool compress = true;
+    };
+
+    struct PackedFile
+    {
+      std::string name;
+      Entry entry;
+      std::vector<uint8_t> data; // what goes into the archive, chunk table included
+    };
+
+    uint64_t alignUp(uint64_t value)
+    {
+      return (value + ENTRY_ALIGNMENT - 1) & ~(ENTRY_ALIGNMENT - 1);
+    }
+
+    bool hasExtension(const fs::path &path, const char *extension)
+    {
+      std::string actual = path.extension().string();
+      std::transform(actual.begin(), actual.end(), actual.begin(), [](unsigned char c)
+                     { return static_cast<char>(std::tolower(c)); });
+      return actual == extension;
+    }
+
+    // same fast check CjhMeshCache::open does: the header records the size and mtime of the
+    // source it was built from, right after magic, version and the two strides
+    bool isFreshMeshCache(const fs::path &cachePath)
+    {
+      fs::path sourcePath = cachePath;
+      sourcePath.replace_extension();
+      std::error_code ec;
+      uint64_t sourceSize = fs::file_size(sourcePath, ec);
+      if (ec)
+      {
+        return false;
+      }
+      int64_t sourceTime = static_cast<int64_t>(fs::last_write_time(sourcePath, ec).time_since_epoch().count());
+      if (ec)
+      {
+        return false;
+      }
+
+      std::ifstream file{cachePath, std::ios::binary};
+      uint64_t recordedSize = 0;
+      int64_t recordedTime = 0;
+      file.seekg(16);
+      file.read(reinterpret_cast<char *>(&recordedSize), sizeof(recordedSize));
+      file.read(reinterpret_cast<char *>(&recordedTime), sizeof(recordedTime));
+      return file && recordedSize == sourceSize && recordedTime == sourceTime;
+    }
+
+    std::vector<fs::path> collectFiles(const Options &options)
+    {
+      std::vector<fs::path> files;
+      for (const auto &path : options.paths)
+      {
+        fs::path full = options.root / path;
+        if (fs::is_directory(full))
+        {
+          for (const auto &item : fs::recursive_directory_iterator(full))
+          {
+            if (item.is_regular_file())
+            {
+              files.push_back(item.path());
+            }
+          }
+        }
+        else if (fs::is_regular_file(full))
+        {
+          files.push_back(full);
+        }
+        else
+        {
+          throw std::runtime_error("not found: " + full.string());
+        }
+      }
+
+      files.erase(std::remove_if(files.begin(), files.end(), [](const fs::path &file)
+                                 { return hasExtension(file, ".tmp") ||
+                                          (hasExtension(file, MESH_CACHE_EXTENSION) && !isFreshMeshCache(file)); }),
+                  files.end());
+      return files;
+    }
+
+    std::vector<uint8_t> readFile(const fs::path &path)
+    {
+      std::ifstream file{path, std::ios::binary};
+      if (!file)
+      {
+        throw std::runtime_error("failed to open " + path.string());
+      }
+      return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // chunk table followed by one zlib stream per chunk, or false when it does not pay off
+    bool deflate(PackedFile &packed, CjhThreadPool &pool)
+    {
+      const std::vector<uint8_t> &original = packed.data;
+      uint32_t chunks = chunkCount(original.size());
+      std::vector<std::vector<uint8_t>> streams(chunks);
+      pool.parallelFor(chunks, [&](uint32_t i)
+                       {
+        uint64_t begin = i * CHUNK_SIZE;
+        int length = static_cast<int>(std::min<uint64_t>(CHUNK_SIZE, original.size() - begin));
+        int compressedLength = 0;
+        unsigned char *compressed = stbi_zlib_compress(
+            const_cast<unsigned char *>(original.data() + begin), length, &compressedLength, 8);
+        if (!compressed)
+        {
+          throw std::runtime_error("failed to compress " + packed.name);
+        }
+        streams[i].assign(compressed, compressed + compressedLength);
+        free(compressed); });
+
+      uint64_t size = chunkTableSize(chunks);
+      for (const auto &stream : streams)
+      {
+        size += stream.size();
+      }
+      if (size > original.size() - original.size() / 8)
+      {
+        return false;
+      }
+
+      std::vector<uint8_t> data(chunkTableSize(chunks), 0);
+      for (uint32_t i = 0; i < chunks; i++)
+      {
+        uint32_t streamSize = static_cast<uint32_t>(streams[i].size());
+        memcpy(data.data() + i * sizeof(uint32_t), &streamSize, sizeof(streamSize));
+      }
+      for (const auto &stream : streams)
+      {
+        data.insert(data.end(), stream.begin(), stream.end());
+      }
+      packed.entry.compression = Compression::Deflate;
+      packed.entry.chunkCount = chunks;
+      packed.data = std::move(data);
+      return true;
+    }
+
+    PackedFile packFile(const Options &options, const fs::path &file, CjhThreadPool &pool)
+    {
+      PackedFile packed{};
+      packed.name = normalizePath(fs::relative(file, options.root).generic_string());
+      packed.data = readFile(file);
+      packed.entry.originalSize = packed.data.size();
+      packed.entry.compression = Compression::None;
+
+      bool compressible = options.compress && !packed.data.empty() &&
+                          std::none_of(std::begin(STORED_EXTENSIONS), std::end(STORED_EXTENSIONS),
+                                       [&](const char *extension)
+                                       { return hasExtension(file, extension); });
+      if (compressible)
+      {
+        deflate(packed, pool);
+      }
+      packed.entry.size = packed.data.size();
+      return packed;
+    }
+
+    Options parseOptions(int argc, char **argv)
+    {
+      Options options{};
+      std::vector<std::string> positional;
+      for (int i = 1; i < argc; i++)
+      {
+        std::string arg = argv[i];
+        if (arg == "--store")
+        {
+          options.compress = false;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+          throw std::runtime_error("unexpected argument " + arg);
+        }
+        else
+        {
+          positional.push_back(arg);
+        }
+      }
+      if (positional.size() < 3)
+      {
+        throw std::runtime_error("usage: PakBuilder <output> <root> <path>... [--store]");
+      }
+      options.output = positional[0];
+      options.root = positional[1];
+      options.paths.assign(positional.begin() + 2, positional.end());
+      return options;
+    }
+
+    void build(const Options &options)
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+
+      CjhThreadPool pool;
+      std::vector<PackedFile> files;
+      uint64_t originalSize = 0;
+      for (const auto &file : collectFiles(options))
+      {
+        files.push_back(packFile(options, file, pool));
+        originalSize += files.back().entry.originalSize;
+      }
+
+      // lookups binary search the table by name
+      std::sort(files.begin(), files.end(), [](const PackedFile &a, const PackedFile &b)
+                { return a.name < b.name; });
+      for (size_t i = 1; i < files.size(); i++)
+      {
+        if (files[i].name == files[i - 1].name)
+        {
+          throw std::runtime_error("duplicate entry " + files[i].name);
+        }
+      }
+
+      Header header{};
+      memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version = VERSION;
+      header.entryCount = static_cast<uint32_t>(files.size());
+
+      std::string names;
+      uint64_t offset = alignUp(sizeof(Header));
+      for (auto &file : files)
+      {
+        file.entry.offset = offset;
+        file.entry.nameOffset = static_cast<uint32_t>(names.size());
+        file.entry.nameLength = static_cast<uint32_t>(file.name.size());
+        names += file.name;
+        offset = alignUp(offset + file.entry.size);
+      }
+      header.tocOffset = offset;
+      header.namesOffset = header.tocOffset + files.size() * sizeof(Entry);
+      header.namesSize = names.size();
+
+      // written next to the target and renamed, so a running engine never sees half a file
+      std::string temporary = options.output + ".tmp";
+      {
+        std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+        if (!out)
+        {
+          throw std::runtime_error("failed to open " + temporary);
+        }
+        const char padding[ENTRY_ALIGNMENT] = {};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(padding, alignUp(sizeof(Header)) - sizeof(Header));
+        for (const auto &file : files)
+        {
+          out.write(reinterpret_cast<const char *>(file.data.data()), file.data.size());
+          out.write(padding, alignUp(file.entry.size) - file.entry.size);
+        }
+        for (const auto &file : files)
+        {
+          out.write(reinterpret_cast<const char *>(&file.entry), sizeof(Entry));
+        }
+        out.write(names.data(), names.size());
+        if (!out)
+        {
+          throw std::runtime_error("failed to write " + temporary);
+        }
+      }
+      std::remove(options.output.c_str());
+      if (std::rename(temporary.c_str(), options.output.c_str()) != 0)
+      {
+        throw std::runtime_error("failed to replace " + options.output);
+      }
+
+      float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+      std::cout << options.output << ": " << files.size() << " entries, " << originalSize / 1024 << " KiB -> "
+                << (header.namesOffset + header.namesSize) / 1024 << " KiB (" << seconds << " s)" << std::endl;
+    }
+  } // namespace
+} // namespace cjh
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    cjh::build(cjh::parseOptions(argc, argv));
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
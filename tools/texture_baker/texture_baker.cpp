@@ -0,0 +1,268 @@
+// Offline texture baker: decodes an image, builds its mip chain and block compresses every level
+// into a .ctex container (see src/vk/cjh_texture_container.hpp) that CjhImage uploads as is.
+//
+//   TextureBaker <input> [output] [--bc1 | --bc3 | --rgba8] [--linear]
+//
+// Without a format option BC3 is picked when the image has any non opaque texel, BC1 otherwise.
+// Data is treated as sRGB unless --linear is given.
+
+#include "vk/cjh_texture_container.hpp"
+#include "vk/cjh_thread_pool.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cjh
+{
+  namespace
+  {
+    using namespace texture_container;
+
+    struct Options
+    {
+      std::string input;
+      std::string output;
+      bool autoEncoding = true;
+      Encoding encoding = Encoding::Bc1;
+      bool srgb = true;
+    };
+
+    struct Level
+    {
+      uint32_t width;
+      uint32_t height;
+      std::vector<uint8_t> rgba;
+      std::vector<uint8_t> encoded;
+    };
+
+    uint64_t alignUp(uint64_t value)
+    {
+      return (value + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+    }
+
+    bool hasTranslucentTexels(const std::vector<uint8_t> &rgba)
+    {
+      for (size_t i = 3; i < rgba.size(); i += 4)
+      {
+        if (rgba[i] != 255)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    std::vector<Level> buildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, bool srgb)
+    {
+      std::vector<Level> levels;
+      levels.push_back({width, height, std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(width) * height * 4), {}});
+      while (levels.back().width > 1 || levels.back().height > 1)
+      {
+        const Level &previous = levels.back();
+        Level next{std::max(previous.width / 2, 1u), std::max(previous.height / 2, 1u), {}, {}};
+        next.rgba.resize(static_cast<size_t>(next.width) * next.height * 4);
+        int result = srgb
+                         ? stbir_resize_uint8_srgb(
+                               previous.rgba.data(), previous.width, previous.height, 0,
+                               next.rgba.data(), next.width, next.height, 0,
+                               4, 3, 0)
+                         : stbir_resize_uint8(
+                               previous.rgba.data(), previous.width, previous.height, 0,
+                               next.rgba.data(), next.width, next.height, 0,
+                               4);
+        if (!result)
+        {
+          throw std::runtime_error("failed to resize mip level!");
+        }
+        levels.push_back(std::move(next));
+      }
+      return levels;
+    }
+
+    void encodeLevel(Level &level, Encoding encoding, CjhThreadPool &pool)
+    {
+      level.encoded.resize(static_cast<size_t>(levelSize(encoding, level.width, level.height)));
+      if (encoding == Encoding::Rgba8)
+      {
+        memcpy(level.encoded.data(), level.rgba.data(), level.rgba.size());
+        return;
+      }
+
+      const uint32_t blocksWide = (level.width + 3) / 4;
+      const uint32_t blocksHigh = (level.height + 3) / 4;
+      const size_t blockBytes = encoding == Encoding::Bc1 ? 8 : 16;
+      // one job per row of blocks, edge blocks repeat the last row / column
+      pool.parallelFor(blocksHigh, [&](uint32_t by)
+                       {
+        uint8_t block[16 * 4];
+        for (uint32_t bx = 0; bx < blocksWide; bx++)
+        {
+          for (uint32_t y = 0; y < 4; y++)
+          {
+            uint32_t sy = std::min(by * 4 + y, level.height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+              uint32_t sx = std::min(bx * 4 + x, level.width - 1);
+              memcpy(block + (y * 4 + x) * 4, level.rgba.data() + (static_cast<size_t>(sy) * level.width + sx) * 4, 4);
+            }
+          }
+          uint8_t *dst = level.encoded.data() + (static_cast<size_t>(by) * blocksWide + bx) * blockBytes;
+          stb_compress_dxt_block(dst, block, encoding == Encoding::Bc3 ? 1 : 0, STB_DXT_HIGHQUAL);
+        } });
+    }
+
+    void writeContainer(const Options &options, uint32_t width, uint32_t height, const std::vector<Level> &levels)
+    {
+      Header header{};
+      memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version = VERSION;
+      header.encoding = options.encoding;
+      header.flags = options.srgb ? static_cast<uint32_t>(FLAG_SRGB) : 0;
+      header.width = width;
+      header.height = height;
+      header.mipLevels = static_cast<uint32_t>(levels.size());
+      header.arrayLayers = 1;
+      header.dataOffset = alignUp(sizeof(Header) + levels.size() * sizeof(LevelEntry));
+
+      std::vector<LevelEntry> entries;
+      uint64_t offset = 0;
+      for (uint32_t i = 0; i < levels.size(); i++)
+      {
+        offset = alignUp(offset);
+        entries.push_back({offset, levels[i].encoded.size(), levels[i].width, levels[i].height, i, 0});
+        offset += levels[i].encoded.size();
+      }
+      header.dataSize = offset;
+
+      // written next to the target and renamed, so a running engine never sees half a file
+      std::string temporary = options.output + ".tmp";
+      {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        if (!file)
+        {
+          throw std::runtime_error("failed to open " + temporary);
+        }
+        const char padding[DATA_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(LevelEntry));
+        file.write(padding, header.dataOffset - sizeof(Header) - entries.size() * sizeof(LevelEntry));
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+          uint64_t end = i + 1 < entries.size() ? entries[i + 1].offset : header.dataSize;
+          file.write(reinterpret_cast<const char *>(levels[i].encoded.data()), levels[i].encoded.size());
+          file.write(padding, end - entries[i].offset - entries[i].size);
+        }
+        if (!file)
+        {
+          throw std::runtime_error("failed to write " + temporary);
+        }
+      }
+      std::remove(options.output.c_str());
+      if (std::rename(temporary.c_str(), options.output.c_str()) != 0)
+      {
+        throw std::runtime_error("failed to move " + temporary + " to " + options.output);
+      }
+    }
+
+    Options parseOptions(int argc, char **argv)
+    {
+      Options options;
+      for (int i = 1; i < argc; i++)
+      {
+        std::string arg = argv[i];
+        if (arg == "--bc1" || arg == "--bc3" || arg == "--rgba8")
+        {
+          options.autoEncoding = false;
+          options.encoding = arg == "--bc1" ? Encoding::Bc1 : arg == "--bc3" ? Encoding::Bc3
+                                                                             : Encoding::Rgba8;
+        }
+        else if (arg == "--linear")
+        {
+          options.srgb = false;
+        }
+        else if (options.input.empty())
+        {
+          options.input = arg;
+        }
+        else if (options.output.empty())
+        {
+          options.output = arg;
+        }
+        else
+        {
+          throw std::runtime_error("unexpected argument " + arg);
+        }
+      }
+      if (options.input.empty())
+      {
+        throw std::runtime_error("usage: TextureBaker <input> [output] [--bc1 | --bc3 | --rgba8] [--linear]");
+      }
+      if (options.output.empty())
+      {
+        options.output = bakedPath(options.input);
+      }
+      return options;
+    }
+
+    void bake(Options options)
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+
+      int width, height, channels;
+      stbi_uc *pixels = stbi_load(options.input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+      if (!pixels)
+      {
+        throw std::runtime_error("failed to load " + options.input);
+      }
+      std::vector<Level> levels = buildMipChain(pixels, width, height, options.srgb);
+      stbi_image_free(pixels);
+
+      if (options.autoEncoding)
+      {
+        options.encoding = hasTranslucentTexels(levels[0].rgba) ? Encoding::Bc3 : Encoding::Bc1;
+      }
+      CjhThreadPool pool;
+      uint64_t encodedSize = 0;
+      for (auto &level : levels)
+      {
+        encodeLevel(level, options.encoding, pool);
+        encodedSize += level.encoded.size();
+      }
+      writeContainer(options, width, height, levels);
+
+      float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+      std::cout << options.output << ": " << width << "x" << height << ", " << levels.size() << " levels, "
+                << encodedSize / 1024 << " KiB (" << seconds << " s)" << std::endl;
+    }
+  } // namespace
+} // namespace cjh
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    cjh::bake(cjh::parseOptions(argc, argv));
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
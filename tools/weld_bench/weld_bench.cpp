@@ -0,0 +1,246 @@
+// Vertex welding benchmark: parses an OBJ once, then welds its face corners with
+// CjhVertexWeldTable and with the std::unordered_map<Vertex, uint32_t> the model loader used
+// before it, and reports the time and heap allocations of each. Needs no window or device.
+//
+//   WeldBench [model] [iterations]
+//
+// model is relative to the engine root like every asset path and defaults to models/dragon.obj,
+// each weld runs iterations times (default 5) and the fastest run is reported.
+
+#include "vk/cjh_obj_parser.hpp"
+#include "vk/cjh_utils.hpp"
+#include "vk/cjh_vertex_weld.hpp"
+
+// libs
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+  std::atomic<uint64_t> allocationCount{0};
+  std::atomic<uint64_t> allocatedBytes{0};
+} // namespace
+
+// every heap allocation of the process goes through here, the welds are timed single threaded
+void *operator new(std::size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size == 0 ? 1 : size))
+  {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+namespace std
+{
+  template <>
+  struct hash<cjh::CjhModel::Vertex>
+  {
+    size_t operator()(cjh::CjhModel::Vertex const &vertex) const
+    {
+      size_t seed = 0;
+      cjh::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+      return seed;
+    }
+  };
+} // namespace std
+
+namespace cjh
+{
+  namespace
+  {
+    using Vertex = CjhModel::Vertex;
+
+    struct Options
+    {
+      std::string model = "models/dragon.obj";
+      uint32_t iterations = 5;
+    };
+
+    struct Result
+    {
+      std::vector<Vertex> vertices;
+      std::vector<uint32_t> indices;
+      double milliseconds = 0.0;
+      uint64_t allocations = 0;
+      uint64_t bytes = 0;
+    };
+
+    Options parseOptions(int argc, char **argv)
+    {
+      Options options{};
+      if (argc > 3)
+      {
+        throw std::runtime_error("usage: WeldBench [model] [iterations]");
+      }
+      if (argc > 1)
+      {
+        options.model = argv[1];
+      }
+      if (argc > 2)
+      {
+        options.iterations = static_cast<uint32_t>(std::stoul(argv[2]));
+      }
+      if (options.iterations == 0)
+      {
+        throw std::runtime_error("iterations must be at least 1");
+      }
+      return options;
+    }
+
+    // the face corners as CjhModel::Builder assembles them, before welding
+    std::vector<Vertex> assembleCorners(const CjhObjParser::Result &attrib)
+    {
+      std::vector<Vertex> corners;
+      corners.reserve(attrib.indices.size());
+      for (const auto &index : attrib.indices)
+      {
+        Vertex vertex{};
+        if (index.vertex >= 0)
+        {
+          vertex.position = {
+              attrib.positions[3 * index.vertex + 0],
+              attrib.positions[3 * index.vertex + 1],
+              attrib.positions[3 * index.vertex + 2],
+          };
+          vertex.color = {
+              attrib.colors[3 * index.vertex + 0],
+              attrib.colors[3 * index.vertex + 1],
+              attrib.colors[3 * index.vertex + 2],
+          };
+        }
+        if (index.normal >= 0)
+        {
+          vertex.normal = {
+              attrib.normals[3 * index.normal + 0],
+              attrib.normals[3 * index.normal + 1],
+              attrib.normals[3 * index.normal + 2],
+          };
+        }
+        if (index.texcoord >= 0)
+        {
+          vertex.uv = {
+              attrib.texcoords[2 * index.texcoord + 0],
+              attrib.texcoords[2 * index.texcoord + 1],
+          };
+        }
+        corners.push_back(vertex);
+      }
+      return corners;
+    }
+
+    // runs weld iterations times and keeps the fastest run, output vectors are part of the cost
+    template <typename Weld>
+    Result measure(uint32_t iterations, Weld weld)
+    {
+      Result best{};
+      for (uint32_t i = 0; i < iterations; i++)
+      {
+        Result result{};
+        uint64_t allocationsBefore = allocationCount.load();
+        uint64_t bytesBefore = allocatedBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        weld(result.vertices, result.indices);
+        result.milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.allocations = allocationCount.load() - allocationsBefore;
+        result.bytes = allocatedBytes.load() - bytesBefore;
+        if (i == 0 || result.milliseconds < best.milliseconds)
+        {
+          best = std::move(result);
+        }
+      }
+      return best;
+    }
+
+    void print(const std::string &name, const Result &result)
+    {
+      std::cout << name << ": " << result.vertices.size() << " vertices, " << result.milliseconds << " ms, "
+                << result.allocations << " allocations, " << result.bytes / 1024 << " KiB allocated\n";
+    }
+
+    void benchmark(const Options &options)
+    {
+      CjhObjParser::Result attrib = CjhObjParser::parseFile(options.model);
+      const std::vector<Vertex> corners = assembleCorners(attrib);
+      const size_t expectedVertexCount = attrib.positions.size() / 3;
+      std::cout << options.model << ": " << corners.size() << " face corners, " << expectedVertexCount
+                << " positions\n";
+
+      Result table = measure(options.iterations, [&](std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+                             {
+        indices.reserve(corners.size());
+        CjhVertexWeldTable uniqueVertices{vertices, expectedVertexCount};
+        for (const auto &vertex : corners)
+        {
+          indices.push_back(uniqueVertices.findOrInsert(vertex));
+        } });
+
+      // the loop CjhModel::Builder::loadModel had before the weld table, unchanged
+      Result map = measure(options.iterations, [&](std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+                           {
+        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        for (auto vertex : corners)
+        {
+          if (uniqueVertices.count(vertex) == 0)
+          {
+            uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+            vertices.emplace_back(std::move(vertex));
+          }
+          indices.emplace_back(std::move(uniqueVertices[vertex]));
+        } });
+
+      print("CjhVertexWeldTable", table);
+      print("std::unordered_map", map);
+      if (table.vertices != map.vertices || table.indices != map.indices)
+      {
+        throw std::runtime_error("the two welds disagree");
+      }
+      if (table.milliseconds > 0.0)
+      {
+        std::cout << "speedup: " << map.milliseconds / table.milliseconds << "x\n";
+      }
+    }
+  } // namespace
+} // namespace cjh
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    cjh::benchmark(cjh::parseOptions(argc, argv));
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}